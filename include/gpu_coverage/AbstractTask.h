@@ -32,6 +32,7 @@
 #define INCLUDE_ARTICULATION_ABSTRACTTASK_H_
 
 #include <pthread.h>
+#include <stddef.h>
 
 namespace gpu_coverage {
 
@@ -44,6 +45,11 @@ struct SharedData {
     pthread_barrier_t barrier;
     pthread_mutex_t mutex;
     size_t numThreads;
+    size_t nextFrame;                  ///< Next animation frame handed out by AbstractTask::nextFrameChunk().
+    size_t endFrame;                   ///< End of the animation frame range (exclusive).
+    double frameTime;                  ///< Moving average of the measured time per frame in seconds.
+    double frameChunkTime;             ///< Target duration of a frame chunk in seconds, 0 for one chunk per thread.
+    double deadline;                   ///< Time (see AbstractTask::getTime()) by which the search tasks return their best plan, 0 for none.
 };
 
 /**
@@ -99,13 +105,53 @@ public:
         this->seed = seed;
     }
 
+    /**
+     * @brief Returns the time of the monotonic clock, which is the same for all threads and processes.
+     * @return Time in seconds.
+     */
+    static double getTime();
+
 protected:
+    /**
+     * @brief Takes the next chunk of animation frames from the shared frame queue.
+     * @param[out] begin First frame of the chunk.
+     * @param[out] end End of the chunk (exclusive).
+     * @return False if all frames have been handed out.
+     *
+     * The time since the previous call is used to update the average time per frame,
+     * from which the chunk size is chosen such that a chunk takes about
+     * SharedData::frameChunkTime seconds. Towards the end of the frame range the
+     * chunks get smaller so that all threads finish at about the same time.
+     * If SharedData::frameChunkTime is 0, the frames are split into one chunk
+     * per thread.
+     */
+    bool nextFrameChunk(size_t& begin, size_t& end);
+
+    /**
+     * @brief Returns true if a deadline has been set in SharedData::deadline.
+     * @return True if the task has a time budget.
+     */
+    inline bool hasDeadline() const {
+        return sharedData->deadline > 0.;
+    }
+
+    /**
+     * @brief Splits the time until the deadline into equal slices and returns the end of the first slice.
+     * @param[in] numSlices Number of remaining slices, e.g. search iterations.
+     * @return End of the time slice, see getTime(). Without a deadline, the largest double value.
+     */
+    double getSliceEnd(const size_t numSlices) const;
+
     const size_t threadNr;             ///< Thread number.
     bool ready;                        ///< Set to true when renderer is ready, see isReady().
     SharedData * const sharedData;     ///< Task synchronization objects.
 
     unsigned int seed;                 ///< Random seed.
 
+private:
+    double chunkStartTime;             ///< Time when the current frame chunk was handed out, see nextFrameChunk().
+    size_t chunkFrames;                ///< Number of frames in the current frame chunk, see nextFrameChunk().
+
 };
 
 } /* namespace gpu_coverage */
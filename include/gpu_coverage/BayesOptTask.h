@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#ifndef INCLUDE_ARTICULATION_BAYESOPTTASK_H_
+#define INCLUDE_ARTICULATION_BAYESOPTTASK_H_
+
+#include <gpu_coverage/CmaEsTask.h>
+#include <gpu_coverage/GaussianProcess.h>
+#include <cstdlib>
+#include <vector>
+
+namespace gpu_coverage {
+
+/**
+ * @brief Next-best-view search with Bayesian optimization over the articulation vector and the camera pose.
+ *
+ * Uses the same candidate vectors and iterations as CmaEsTask, but spends the renders of an iteration
+ * on candidates proposed by a Gaussian process surrogate (see GaussianProcess) of the evaluation.
+ * Every iteration starts with one round of uniformly random candidates. In the following rounds,
+ * each worker proposes a batch by maximizing the expected improvement over random candidates,
+ * adding every proposal to a copy of the surrogate with its predicted value (kriging believer) so that
+ * the batch does not collapse to one point. The workers draw different random candidates and
+ * propose in parallel. After each round, the evaluated candidates of all workers are exchanged
+ * through shared memory and every worker adds them to its surrogate in the same order.
+ *
+ * The following parameters are used:
+ * | Parameter           | Description |
+ * | ------------------- | ----------- |
+ * | bayesOptBatchSize   | Number of candidates per worker and round |
+ * | bayesOptCandidates  | Number of random candidates scored by the expected improvement per proposal |
+ * | bayesOptLengthScale | Kernel length scale in the normalized search space |
+ * | bayesOptRounds      | Number of rounds per iteration, including the random first round |
+ */
+class BayesOptTask: public CmaEsTask {
+public:
+    BayesOptTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData, const size_t numIterations);
+    virtual ~BayesOptTask();
+
+    static void allocateSharedData(const size_t numThreads);
+    static void freeSharedData();
+
+protected:
+    const size_t numRounds, batchSize, numCandidates;
+    const double lengthScale;
+    GaussianProcess surrogate;
+
+    virtual size_t search(RobotSceneConfiguration& bestConfiguration, float& bestEval);
+
+    /**
+     * @brief Proposes the candidates of a round by expected improvement.
+     * @param[out] proposals Receives batchSize candidate vectors.
+     * @param[in] bestX Best candidate vector observed so far.
+     * @param[in] best Evaluation of bestX.
+     */
+    void propose(std::vector<std::vector<double> >& proposals, const std::vector<double>& bestX, const double best);
+
+    /**
+     * @brief Returns a uniformly random value in [0, 1).
+     */
+    inline double uniform() {
+        return rand_r(&seed) / (static_cast<double>(RAND_MAX) + 1.);
+    }
+
+    static double *observations;          ///< Candidate vectors and evaluations of all workers and rounds
+    static size_t observationsSize;       ///< Size of the shared memory mapping of observations
+};
+
+} /* namespace gpu_coverage */
+
+#endif /* INCLUDE_ARTICULATION_BAYESOPTTASK_H_ */
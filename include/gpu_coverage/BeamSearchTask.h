@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#ifndef INCLUDE_ARTICULATION_BEAMSEARCHTASK_H_
+#define INCLUDE_ARTICULATION_BEAMSEARCHTASK_H_
+
+#include <gpu_coverage/AbstractTask.h>
+#include <gpu_coverage/Scene.h>
+#include <gpu_coverage/RobotSceneConfiguration.h>
+#include <gpu_coverage/RobotSceneConfigurationPool.h>
+#include <gpu_coverage/CandidateBatch.h>
+#include <vector>
+
+namespace gpu_coverage {
+
+class VisibilityRenderer;
+class CostMapRenderer;
+class BellmanFordXfbRenderer;
+
+/**
+ * @brief Plans a sequence of views with beam search instead of choosing one view at a time.
+ *
+ * The task keeps the beamWidth best partial view sequences (beams). In every step, the same
+ * random candidate views are sampled in all workers and every beam is expanded with every
+ * candidate. A sequence is scored with the sum of the evaluations of its views, i.e., the
+ * gain of its cumulative coverage minus the travel costs, where the distance between two
+ * views is the path length in the Bellman-Ford distance map of the previous view.
+ *
+ * The articulation batches of the candidates are split across the workers. Each worker keeps
+ * the coverage textures of all beams and renders the candidates of a batch for one beam
+ * at a time. Unreachable candidates are not rendered, and neither are candidates whose score
+ * cannot exceed the beamWidth best expansions of the worker even if they observed all remaining
+ * pixels. The first worker selects the best expansions as the new beams.
+ */
+class BeamSearchTask: public AbstractTask {
+public:
+    BeamSearchTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData,
+            const size_t numSteps, const size_t numArticulationConfigs, const size_t numCameraPoses);
+    virtual ~BeamSearchTask();
+
+    virtual void run();
+    static void allocateSharedData(const size_t numCandidates);
+    static void freeSharedData();
+
+protected:
+    Scene * const scene;
+    const size_t numSteps, numArticulationConfigs, numCameraPoses, numCandidates, numArticulations;
+    const size_t beamWidth;             ///< Maximum number of partial view sequences kept in every step
+
+    Node * cameraNode;
+    CostMapRenderer * costmapRenderer;
+    BellmanFordXfbRenderer * bellmanFordRenderer;
+    VisibilityRenderer * visibilityRenderer;
+
+    GLuint targetTexture[20];
+    size_t numTargetTextures;
+    std::vector<glm::vec3> targetPoints;
+    std::vector<GLuint> beamTextures;   ///< Coverage of every beam, two sets of beamWidth * numTargetTextures
+    float cellSize;                     ///< Edge length of a distance map cell in world units
+    RobotSceneConfigurationPool candidatePool;
+    RobotSceneConfigurationPool planPool;
+    CandidateBatch candidateBatch;      ///< Candidates of one articulation batch, for their travel costs
+
+    /**
+     * @brief View of a partial sequence, the sequences form a tree rooted at the initial configuration.
+     */
+    struct BeamNode {
+        RobotSceneConfiguration * configuration;  ///< View with the coverage count of the whole sequence
+        size_t parent;                            ///< Index of the previous view
+        size_t step;                              ///< Length of the sequence
+        float cost;                               ///< Travel cost from the previous view
+        float score;                              ///< Sum of the evaluations of the sequence
+        BeamNode(RobotSceneConfiguration * const configuration, const size_t parent, const size_t step,
+                const float cost, const float score)
+                : configuration(configuration), parent(parent), step(step), cost(cost), score(score) {}
+    };
+
+    /**
+     * @brief Expansion of a beam chosen as a new beam.
+     */
+    struct Selection {
+        size_t beam;        ///< Index of the expanded beam
+        size_t candidate;   ///< Index of the candidate appended to the beam
+        float cost;         ///< Travel cost from the last view of the beam
+        float score;        ///< Score of the expanded sequence
+    };
+
+    /**
+     * @brief Returns the index of the texture holding the coverage of a beam.
+     */
+    inline size_t getBeamTexture(const size_t set, const size_t beam, const size_t target) const {
+        return (set * beamWidth + beam) * numTargetTextures + target;
+    }
+
+    /**
+     * @brief Copies coverage textures of the same size.
+     */
+    void copyTextures(const GLuint * const source, GLuint * const destination) const;
+
+    /**
+     * @brief Returns the distance map cell below the camera of a configuration.
+     * @return False if the camera is outside the distance map.
+     */
+    bool getCell(const RobotSceneConfiguration& configuration, size_t& cell) const;
+
+    struct TaskSharedData {
+        // shared across processes, no pointers or dynamic memory here!
+        unsigned int candidateSeed;   ///< Seed for sampling the same candidates in all workers
+        size_t numSelected;           ///< Number of beams selected in the current step
+        bool finished;
+    };
+    static TaskSharedData *taskSharedData;
+    static Selection *selections;     ///< Beams of the next step, stored behind taskSharedData
+    static GLuint *expansionCounts;   ///< Coverage count of every expansion, notEvaluated if it has not been rendered
+    static float *expansionCosts;     ///< Travel cost of every expansion
+    static size_t sharedDataSize;     ///< Size of the shared memory mapping
+
+    static const GLuint notEvaluated = 0xffffffffu;   ///< Count of unreachable and pruned expansions
+};
+
+} /* namespace gpu_coverage */
+
+#endif /* INCLUDE_ARTICULATION_BEAMSEARCHTASK_H_ */
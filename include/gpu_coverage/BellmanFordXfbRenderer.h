@@ -34,6 +34,7 @@
 #include <gpu_coverage/AbstractRenderer.h>
 #include <gpu_coverage/CostMapRenderer.h>
 #include <gpu_coverage/Programs.h>
+#include <vector>
 
 namespace gpu_coverage {
 
@@ -56,10 +57,49 @@ public:
         return height;
     }
 
+    /**
+     * @brief Reads the distance map rendered by the last call to display() back from the GPU.
+     * @param[out] distances Receives width * height distances from the robot position, row by row.
+     *
+     * Cells that cannot be reached from the robot position keep unreachableDistance.
+     */
+    void getDistances(std::vector<GLint>& distances) const;
+
+    /**
+     * @brief Reads the nearest start position of every cell back from the GPU.
+     * @param[out] sources Receives width * height indices into the start positions, see setSourcePositions().
+     *
+     * The index of a cell is the start position from which its distance in getDistances() was propagated,
+     * 0 if the distance map starts at the robot camera and -1 for unreachable cells. The step shader keeps
+     * the distance and the index in one word and updates it with a single atomic minimum, so the index
+     * always belongs to the smallest distance. Of equally distant start positions, the one with the smaller
+     * index is returned. Distances beyond maxSourceDistance are not told apart for this.
+     */
+    void getSources(std::vector<GLint>& sources) const;
+
+    static const GLint unreachableDistance = 10000000;   ///< Initial distance of all cells
+    static const GLint distancePerCell = 100;            ///< Distance between horizontal neighbors without costs
+    static const GLint sourceBits = 8;                   ///< Bits of the start position index in a source texel
+    static const GLint maxSources = (1 << sourceBits) - 1;                 ///< Maximum number of start positions
+    static const GLint maxSourceDistance = (1 << (31 - sourceBits)) - 1;   ///< Largest distance in a source texel
+
     inline void setRobotPosition(const glm::mat4x4& worldTransform) {
         robotWorldTransform = worldTransform;
     }
 
+    /**
+     * @brief Sets several start positions for a multi-source distance map.
+     * @param[in] positions Start positions in world coordinates, empty to start at the robot camera.
+     *
+     * Every cell receives the distance from the nearest start position, so one display() call
+     * replaces one distance map per robot when only the nearest robot matters. The index of the
+     * nearest start position is propagated along with the distances, see getSources(). Start
+     * positions beyond maxSources are ignored.
+     */
+    inline void setSourcePositions(const std::vector<glm::vec3>& positions) {
+        sourcePositions = positions;
+    }
+
 protected:
     const CostMapRenderer * const costmapRenderer;
     const bool renderToWindow;
@@ -85,14 +125,16 @@ protected:
 
     GLuint numPrimitivesQuery[3];
     size_t numQueries;
-    GLuint textures[3];
+    GLuint textures[4];
     enum TextureRole {
         QUEUED,
         OUTPUT,
-        VISUAL
+        VISUAL,
+        SOURCE
     };
 
     glm::mat4x4 robotWorldTransform;
+    std::vector<glm::vec3> sourcePositions;   ///< Start positions of the distance map, see setSourcePositions()
 };
 
 } /* namespace gpu_coverage */
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#ifndef INCLUDE_ARTICULATION_CANDIDATEBATCH_H_
+#define INCLUDE_ARTICULATION_CANDIDATEBATCH_H_
+
+#include <gpu_coverage/RobotSceneConfiguration.h>
+#include <vector>
+
+namespace gpu_coverage {
+
+/**
+ * @brief Candidate configurations stored as structure of arrays for evaluating them in bulk.
+ *
+ * The camera positions, coverage counts and articulation values of the candidates are kept
+ * in one contiguous array per component, the articulation values grouped by articulated object.
+ * evaluate() computes the costs, gains and evaluations of all candidates with branch-free loops
+ * over these arrays, which the compiler vectorizes for the target architecture
+ * (see -march=native and the flags of CandidateBatch.cpp in CMakeLists.txt) instead of calling
+ * RobotSceneConfiguration::getEvaluation() for every candidate.
+ *
+ * The results are the same as with RobotSceneConfiguration::getCost(), getGain() and
+ * getEvaluation() up to rounding.
+ */
+class CandidateBatch {
+public:
+    /**
+     * @brief Constructor.
+     * @param[in] capacity Maximum number of candidates.
+     *
+     * RobotSceneConfiguration::loadCosts() must have been called before.
+     */
+    explicit CandidateBatch(const size_t capacity);
+
+    /**
+     * @brief Destructor.
+     */
+    virtual ~CandidateBatch();
+
+    /**
+     * @brief Removes all candidates.
+     */
+    inline void clear() {
+        numCandidates = 0;
+        hasPathLengths = false;
+    }
+
+    /**
+     * @brief Appends a candidate.
+     * @param[in] configuration Candidate, its count must have been set if the gains are used.
+     * @param[in] cell Index of the distance map cell below the camera, see lookupPathLengths().
+     * @return Index of the candidate, or size() if the batch is full.
+     */
+    size_t add(const RobotSceneConfiguration& configuration, const size_t cell = 0);
+
+    /**
+     * @brief Sets the coverage count of a candidate.
+     * @param[in] index Index of the candidate.
+     * @param[in] count Number of observed pixels.
+     */
+    inline void setCount(const size_t index, const GLuint count) {
+        counts[index] = static_cast<int>(count);
+    }
+
+    /**
+     * @brief Gathers the path lengths of all candidates from a distance map.
+     * @param[in] distances Distance map from the previous camera position, see BellmanFordXfbRenderer::getDistances().
+     * @param[in] scale Path length per distance unit.
+     *
+     * The next call to evaluate() uses the path lengths instead of the Euclidean distances.
+     */
+    void lookupPathLengths(const std::vector<GLint>& distances, const float scale);
+
+    /**
+     * @brief Computes the costs, gains and evaluations of all candidates.
+     * @param[in] previousConfig The previous configuration.
+     */
+    void evaluate(const RobotSceneConfiguration& previousConfig);
+
+    /**
+     * @brief Returns the index of the candidate with the highest evaluation.
+     * @return The first candidate with the highest evaluation, or size() if the batch is empty.
+     */
+    size_t getBest() const;
+
+    inline size_t size() const {
+        return numCandidates;
+    }
+    inline float getCost(const size_t index) const {
+        return costs[index];
+    }
+    inline float getGain(const size_t index) const {
+        return gains[index];
+    }
+    inline float getEvaluation(const size_t index) const {
+        return evaluations[index];
+    }
+    /**
+     * @brief Returns the path length of a candidate gathered by lookupPathLengths().
+     */
+    inline float getPathLength(const size_t index) const {
+        return pathLengths[index];
+    }
+
+protected:
+    const size_t capacity;
+    size_t numCandidates;
+    bool hasPathLengths;                   ///< True if lookupPathLengths() has been called since clear()
+
+    std::vector<float> x, y, z;            ///< Camera positions in world coordinates
+    std::vector<float> articulations;      ///< Articulation values, object a of candidate i at a * capacity + i
+    std::vector<int> counts;               ///< Coverage counts
+    std::vector<size_t> cells;             ///< Distance map cells, see lookupPathLengths()
+    std::vector<float> pathLengths;        ///< Path lengths from the previous camera position
+    std::vector<float> costs, gains, evaluations;
+
+private:
+    /**
+     * @brief Not implemented.
+     */
+    CandidateBatch(const CandidateBatch& other);
+    /**
+     * @brief Not implemented.
+     */
+    CandidateBatch& operator=(const CandidateBatch& other);
+};
+
+} /* namespace gpu_coverage */
+
+#endif /* INCLUDE_ARTICULATION_CANDIDATEBATCH_H_ */
@@ -34,6 +34,7 @@
 #include <assimp/scene.h>
 #include <glm/detail/type_vec3.hpp>
 #include <glm/detail/type_mat4x4.hpp>
+#include <algorithm>
 #include <map>
 #if HAS_GTEST
 #include <gtest/gtest_prod.h>
@@ -73,6 +74,15 @@ public:
      */
     void setFrame(const size_t frame);
 
+    /**
+     * @brief Set the current position of the animation to a fractional frame.
+     * @param[in] frame Frame position, interpolated between the neighboring key frames.
+     *
+     * Same as setFrame() for whole frames. Continuous optimizers need fractional
+     * frames, as the pose would otherwise be piecewise constant in the articulation.
+     */
+    void setFramePosition(const float frame);
+
     /**
      * @brief Returns the scene graph node that this camera is attached to.
      * @return The scene graph node.
@@ -166,6 +176,34 @@ protected:
         return std::make_pair(a, b);
     }
 
+    /**
+     * Finds the key frames before and after a fractional frame position.
+     * @tparam M The keyframe map type
+     * @param[in] map Keyframe map
+     * @param[in] frame Frame position
+     * @param[out] low Last key frame at or before the frame position
+     * @param[out] high First key frame after the frame position, low if there is none
+     * @return Interpolation weight of high in [0, 1).
+     */
+    template<class M>
+    static float findFractionalInterval(const M& map, const float frame,
+            typename M::const_iterator& low, typename M::const_iterator& high) {
+        high = map.upper_bound(static_cast<typename M::key_type>(std::max(frame, 0.f)));
+        if (high == map.begin()) {
+            // before the first key frame
+            low = high;
+            return 0.f;
+        }
+        low = high;
+        --low;
+        if (high == map.end()) {
+            // after the last key frame
+            high = low;
+            return 0.f;
+        }
+        return (frame - static_cast<float>(low->first)) / static_cast<float>(high->first - low->first);
+    }
+
 #if HAS_GTEST
     FRIEND_TEST(Channel, findInterval);
 #endif
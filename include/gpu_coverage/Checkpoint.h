@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#ifndef INCLUDE_ARTICULATION_CHECKPOINT_H_
+#define INCLUDE_ARTICULATION_CHECKPOINT_H_
+
+#include <gpu_coverage/RobotSceneConfiguration.h>
+#include GL_INCLUDE
+#include <pthread.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace gpu_coverage {
+
+/**
+ * @brief Compact binary checkpoint of a search task for resuming an interrupted run.
+ *
+ * A checkpoint is assembled in memory with the put methods and handed to a
+ * background thread by commit(), which writes it to a temporary file and
+ * renames it over the previous checkpoint. An interrupted write therefore
+ * never destroys the previous checkpoint.
+ *
+ * Textures are read back asynchronously into pixel buffer objects. A
+ * checkpoint containing textures is completed and written by the first
+ * poll() after the transfer has finished, so that the render loop never
+ * waits for the GPU. The next commit() or flush() completes it at the latest.
+ *
+ * The file starts with a magic number, a format version and the name of the
+ * task, so that load() rejects checkpoints of other tasks. The rest of the
+ * file is task specific and read back with the get methods in the order in
+ * which it was written.
+ */
+class Checkpoint {
+public:
+    /**
+     * @brief Constructor.
+     * @param[in] filename Checkpoint file.
+     * @param[in] task Name of the task writing the checkpoint.
+     */
+    Checkpoint(const std::string& filename, const std::string& task);
+    /**
+     * @brief Destructor, writes a pending checkpoint and waits until it has been written.
+     */
+    virtual ~Checkpoint();
+
+    /**
+     * @brief Starts a new checkpoint.
+     */
+    void begin();
+    /**
+     * @brief Appends raw data to the checkpoint.
+     * @param[in] data Data to append.
+     * @param[in] size Size of the data in bytes.
+     */
+    void put(const void * const data, const size_t size);
+    /**
+     * @brief Appends a value of plain old data type to the checkpoint.
+     * @param[in] value Value to append.
+     */
+    template<typename T>
+    inline void put(const T& value) {
+        put(&value, sizeof(T));
+    }
+    /**
+     * @brief Appends the camera pose, articulation and pixel count of a configuration.
+     * @param[in] configuration Configuration to append.
+     */
+    void putConfiguration(const RobotSceneConfiguration& configuration);
+    /**
+     * @brief Starts reading an RGBA8 texture back from the GPU and reserves space for it in the checkpoint.
+     * @param[in] texture Texture object.
+     * @param[in] width Width of the texture.
+     * @param[in] height Height of the texture.
+     *
+     * The texture content is copied into the checkpoint by the next commit() or flush().
+     */
+    void putTexture(const GLuint texture, const int width, const int height);
+    /**
+     * @brief Writes the checkpoint in the background.
+     *
+     * Writes the previous checkpoint first if it waits for its textures. A checkpoint
+     * without textures is written immediately, one with textures by poll(), commit()
+     * or flush(). Must be called in the thread owning the OpenGL context.
+     */
+    void commit();
+    /**
+     * @brief Writes the last committed checkpoint if its texture read backs have finished, without waiting.
+     *
+     * Called once per iteration by the tasks. Must be called in the thread owning the OpenGL context.
+     */
+    void poll();
+    /**
+     * @brief Completes the texture read backs of the last commit() and writes that checkpoint.
+     *
+     * Called by the destructor. Must be called in the thread owning the OpenGL context.
+     */
+    void flush();
+
+    /**
+     * @brief Reads the checkpoint file.
+     * @return False if there is no checkpoint or it has not been written by this task.
+     */
+    bool load();
+    /**
+     * @brief Reads raw data from the loaded checkpoint.
+     * @param[out] data Receives the data.
+     * @param[in] size Size of the data in bytes.
+     * @return False if the checkpoint is too short.
+     */
+    bool get(void * const data, const size_t size);
+    /**
+     * @brief Reads a value of plain old data type from the loaded checkpoint.
+     * @param[out] value Receives the value.
+     * @return False if the checkpoint is too short.
+     */
+    template<typename T>
+    inline bool get(T& value) {
+        return get(&value, sizeof(T));
+    }
+    /**
+     * @brief Reads a configuration written by putConfiguration().
+     * @param[out] configuration Receives the configuration.
+     * @return False if the checkpoint is too short or has a different number of articulated objects.
+     */
+    bool getConfiguration(RobotSceneConfiguration& configuration);
+    /**
+     * @brief Reads a texture written by putTexture() and uploads it to the GPU.
+     * @param[in] texture Texture object to upload to.
+     * @param[in] width Width of the texture.
+     * @param[in] height Height of the texture.
+     * @return False if the checkpoint is too short or the texture has a different size.
+     */
+    bool getTexture(const GLuint texture, const int width, const int height);
+
+    /**
+     * @brief Reads a log of completed animation frames.
+     * @param[in] filename Log file written by appendFrame().
+     * @param[in] numFrames Number of animation frames.
+     * @param[out] done Receives numFrames flags, true for the completed frames.
+     * @return Number of completed frames.
+     */
+    static size_t loadFrames(const std::string& filename, const size_t numFrames, std::vector<bool>& done);
+    /**
+     * @brief Appends a completed animation frame to a log of completed frames.
+     * @param[in] filename Log file.
+     * @param[in] frame The completed frame.
+     *
+     * Frames are appended atomically, so several workers can share the log.
+     */
+    static void appendFrame(const std::string& filename, const size_t frame);
+
+protected:
+    /**
+     * @brief Texture being read back into a pixel buffer object.
+     */
+    struct Readback {
+        GLuint pbo;                   ///< Pixel buffer object receiving the texture
+        size_t offset;                ///< Position of the texture in the checkpoint
+        size_t size;                  ///< Size of the texture in bytes
+    };
+
+    const std::string filename;       ///< Checkpoint file
+    const std::string task;           ///< Name of the task writing the checkpoint
+    std::vector<char> buffer;         ///< Checkpoint being assembled, or the loaded checkpoint
+    std::vector<Readback> readbacks;  ///< Textures of the checkpoint being assembled
+    std::vector<char> pendingBuffer;  ///< Committed checkpoint waiting for its textures
+    std::vector<Readback> pendingReadbacks; ///< Textures of pendingBuffer
+    GLsync pendingFence;              ///< Signaled when the read backs of pendingReadbacks have finished
+    std::vector<char> writeBuffer;    ///< Checkpoint being written by the background thread
+    size_t readPosition;              ///< Position of the next get() in buffer
+    pthread_t writer;                 ///< Background thread writing writeBuffer
+    bool writing;                     ///< True while writer has not been joined
+
+    static const uint32_t magic = 0x4b435047;   ///< "GPCK"
+    static const uint32_t version = 2;          ///< Format version
+
+    /**
+     * @brief Waits until the background thread has written the previous checkpoint.
+     */
+    void wait();
+    /**
+     * @brief Hands a complete checkpoint to the background thread.
+     * @param[in,out] data The checkpoint, empty afterwards.
+     */
+    void startWriter(std::vector<char>& data);
+    static void * write(void * checkpoint);
+};
+
+} /* namespace gpu_coverage */
+
+#endif /* INCLUDE_ARTICULATION_CHECKPOINT_H_ */
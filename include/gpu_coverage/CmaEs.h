@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#ifndef INCLUDE_ARTICULATION_CMAES_H_
+#define INCLUDE_ARTICULATION_CMAES_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace gpu_coverage {
+
+/**
+ * @brief Covariance matrix adaptation evolution strategy (CMA-ES) for maximizing a function.
+ *
+ * Implements the (mu/mu_w, lambda)-CMA-ES with rank-one and rank-mu covariance
+ * updates and cumulative step size adaptation as described in N. Hansen,
+ * "The CMA Evolution Strategy: A Tutorial", 2016.
+ *
+ * The optimizer is driven in generations: samplePopulation() draws lambda
+ * candidates, the caller evaluates all of them (e.g. as one batch on the GPU)
+ * and passes the fitness values to update(). Higher fitness is better.
+ */
+class CmaEs {
+public:
+    /**
+     * @brief Constructor.
+     * @param[in] mean Initial mean of the search distribution, defines the dimension.
+     * @param[in] sigma Initial step size.
+     * @param[in] populationSize Number of candidates per generation, 0 for the default 4 + 3 ln(n).
+     *            Values below 2 are raised to 2, so that at least one candidate is selected.
+     */
+    CmaEs(const std::vector<double>& mean, const double sigma, const size_t populationSize = 0);
+
+    /**
+     * @brief Destructor.
+     */
+    virtual ~CmaEs();
+
+    /**
+     * @brief Samples a new generation of candidates from the current search distribution.
+     * @param[in,out] seed Random seed for rand_r().
+     */
+    void samplePopulation(unsigned int& seed);
+
+    /**
+     * @brief Updates the search distribution from the fitness of the current generation.
+     * @param[in] fitness One value per candidate of the last samplePopulation() call, higher is better.
+     */
+    void update(const std::vector<double>& fitness);
+
+    /**
+     * @brief Returns a candidate of the current generation.
+     * @param[in] i Index of the candidate, less than getPopulationSize().
+     * @return Candidate parameter vector.
+     */
+    inline const std::vector<double>& getCandidate(const size_t i) const {
+        return population[i];
+    }
+
+    /**
+     * @brief Returns the number of candidates per generation (lambda).
+     * @return Population size.
+     */
+    inline size_t getPopulationSize() const {
+        return lambda;
+    }
+
+    /**
+     * @brief Returns the mean of the search distribution.
+     * @return Mean vector.
+     */
+    inline const std::vector<double>& getMean() const {
+        return mean;
+    }
+
+    /**
+     * @brief Returns the current step size.
+     * @return Step size sigma.
+     */
+    inline double getSigma() const {
+        return sigma;
+    }
+
+protected:
+    typedef std::vector<double> Vector;
+    typedef std::vector<Vector> Matrix;
+
+    const size_t n;                      ///< Dimension of the search space
+    const size_t lambda;                 ///< Population size
+    const size_t mu;                     ///< Number of selected candidates
+    Vector weights;                      ///< Recombination weights of the mu best candidates
+    double mueff;                        ///< Variance effective selection mass
+    double cc, cs, c1, cmu, damps, chiN; ///< Strategy parameters, see Hansen's tutorial
+
+    Vector mean;                         ///< Mean of the search distribution
+    double sigma;                        ///< Step size
+    Vector pc;                           ///< Evolution path of the covariance matrix
+    Vector ps;                           ///< Evolution path of the step size
+    Matrix C;                            ///< Covariance matrix
+    Matrix B;                            ///< Eigenvectors of C, stored in columns
+    Vector D;                            ///< Square roots of the eigenvalues of C
+    size_t generation;                   ///< Number of update() calls
+
+    Matrix population;                   ///< Candidates of the current generation
+
+    /**
+     * @brief Returns a standard normally distributed random number (Box-Muller).
+     */
+    static double randomNormal(unsigned int& seed);
+
+    /**
+     * @brief Updates B and D from C with the cyclic Jacobi eigenvalue algorithm.
+     */
+    void decompose();
+};
+
+} /* namespace gpu_coverage */
+
+#endif /* INCLUDE_ARTICULATION_CMAES_H_ */
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#ifndef INCLUDE_ARTICULATION_CMAESTASK_H_
+#define INCLUDE_ARTICULATION_CMAESTASK_H_
+
+#include <gpu_coverage/AbstractTask.h>
+#include <gpu_coverage/Scene.h>
+#include <gpu_coverage/RobotSceneConfiguration.h>
+#include <gpu_coverage/RobotSceneConfigurationPool.h>
+#include <gpu_coverage/SharedBest.h>
+#include <vector>
+
+namespace gpu_coverage {
+
+class VisibilityRenderer;
+
+/**
+ * @brief Next-best-view search with CMA-ES over the articulation vector and the camera pose.
+ *
+ * In every iteration, each worker runs an independent CMA-ES (see CmaEs) starting at the
+ * current configuration. A candidate is encoded as a vector in [0, 1] with one entry per
+ * articulated object followed by camera x, y, height, yaw and pitch. Each generation is
+ * rendered as one batch by the VisibilityRenderer and scored with
+ * RobotSceneConfiguration::getEvaluation(). The best candidate of all workers becomes the
+ * next current configuration, as in RandomSearchTask.
+ *
+ * The following parameters are used:
+ * | Parameter        | Description |
+ * | ---------------- | ----------- |
+ * | cmaesGenerations | Number of generations per iteration |
+ * | cmaesPopulation  | Number of candidates per generation, 0 for the CMA-ES default |
+ * | cmaesSigma       | Initial step size in the normalized search space |
+ */
+class CmaEsTask: public AbstractTask {
+public:
+    CmaEsTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData, const size_t numIterations);
+    virtual ~CmaEsTask();
+
+    virtual void run();
+    static void allocateSharedData(const size_t numThreads);
+    static void freeSharedData();
+
+protected:
+    Scene * const scene;
+    const size_t numIterations, numArticulations;
+    const size_t numGenerations, populationSize;
+    const double initialSigma;
+    float minCameraHeight, maxCameraHeight;
+
+    Node * cameraNode;
+    VisibilityRenderer * visibilityRenderer;
+
+    GLuint targetTexture[20];
+    size_t numTargetTextures;
+
+    /**
+     * @brief Number of entries of a candidate vector.
+     * @param[in] numArticulations Number of articulated objects.
+     *
+     * Candidate vectors have one entry per articulated object followed by five camera pose entries.
+     * Static for sizing shared data in allocateSharedData(), before a task exists.
+     */
+    static inline size_t getDimension(const size_t numArticulations) {
+        return numArticulations + 5;
+    }
+    /**
+     * @brief Number of entries of a candidate vector of this scene.
+     */
+    inline size_t getDimension() const {
+        return getDimension(numArticulations);
+    }
+
+    /**
+     * @brief Searches the next configuration starting at the current configuration.
+     * @param[out] bestConfiguration Receives the best candidate evaluated by this worker.
+     * @param[in,out] bestEval Evaluation of bestConfiguration, unchanged if no candidate is better.
+     * @return Number of candidates rendered by this worker.
+     *
+     * Runs the CMA-ES generations of one iteration. Called by all workers in every iteration of run().
+     */
+    virtual size_t search(RobotSceneConfiguration& bestConfiguration, float& bestEval);
+
+    /**
+     * @brief Converts a configuration to a candidate vector.
+     */
+    void encode(const RobotSceneConfiguration& configuration, std::vector<double>& x) const;
+
+    /**
+     * @brief Converts a candidate vector to a configuration, entries outside [0, 1] are clamped.
+     */
+    void decode(const std::vector<double>& x, RobotSceneConfiguration& configuration) const;
+
+    struct TaskSharedData {
+        // shared across processes, no pointers or dynamic memory here!
+        RobotSceneConfiguration currentConfiguration;
+        RobotSceneConfiguration bestConfiguration;
+        float bestEval;
+        bool finished;
+        bool failed;                    ///< Set by a worker whose renders failed, all workers stop after the iteration
+    };
+    static TaskSharedData *taskSharedData;
+    static SharedBest *sharedBest;      ///< Lock-free reduction of the best candidate, stored behind taskSharedData
+    static size_t sharedDataSize;       ///< Size of the shared memory mapping
+
+    static size_t sharedBestOffset();
+};
+
+} /* namespace gpu_coverage */
+
+#endif /* INCLUDE_ARTICULATION_CMAESTASK_H_ */
@@ -60,6 +60,25 @@ public:
         return camera;
     }
 
+    /**
+     * @brief Reads the cost map rendered by the last call to display() back from the GPU.
+     * @param[out] costs Receives width * height cost values, row by row.
+     */
+    void getCosts(std::vector<GLint>& costs) const;
+
+    /**
+     * @brief Returns the cost map pixel below a position.
+     * @param[in] position Position in world coordinates.
+     * @param[out] index Receives the index of the pixel in the cost map, row by row.
+     * @return False if the position is outside the cost map.
+     *
+     * The Bellman-Ford renderers use the same camera and resolution, so the
+     * index applies to their distance maps as well.
+     */
+    bool getPixel(const glm::vec3& position, size_t& index) const;
+
+    static const GLint obstacleCost = 1000;   ///< Cells with this cost or more are obstacles, as in the Bellman-Ford shaders
+
 protected:
     const bool renderToWindow;
     const bool renderVisual;
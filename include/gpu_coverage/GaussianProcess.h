@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#ifndef INCLUDE_ARTICULATION_GAUSSIANPROCESS_H_
+#define INCLUDE_ARTICULATION_GAUSSIANPROCESS_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace gpu_coverage {
+
+/**
+ * @brief Gaussian process regression with a squared exponential kernel, updated one observation at a time.
+ *
+ * The Cholesky factor L of the kernel matrix and z = L^-1 y are extended by one row
+ * for every add(), which takes O(n^2) instead of refactoring the kernel matrix in O(n^3).
+ * The predictive mean of a point x is v^T z and its variance k(x, x) - v^T v with
+ * v = L^-1 k(X, x), so the weights K^-1 y are never needed.
+ *
+ * Observations are standardized with a prior mean and scale given by setPrior(),
+ * predictions are in the original units.
+ */
+class GaussianProcess {
+public:
+    /**
+     * @brief Constructor.
+     * @param[in] dimension Number of entries of an input vector.
+     * @param[in] lengthScale Length scale of the kernel, the same in all dimensions.
+     * @param[in] noise Observation noise variance relative to the kernel variance.
+     */
+    GaussianProcess(const size_t dimension, const double lengthScale, const double noise);
+
+    /**
+     * @brief Destructor.
+     */
+    virtual ~GaussianProcess();
+
+    /**
+     * @brief Removes all observations.
+     */
+    void clear();
+
+    /**
+     * @brief Sets the prior mean and the scale of the observations.
+     * @param[in] mean Prediction without observations.
+     * @param[in] scale Standard deviation of the observations, should be set before the first add().
+     */
+    void setPrior(const double mean, const double scale);
+
+    /**
+     * @brief Adds an observation.
+     * @param[in] x Input vector.
+     * @param[in] y Observed value.
+     * @return False if the kernel matrix would become singular, e.g., for a duplicate input; the observation is skipped.
+     */
+    bool add(const std::vector<double>& x, const double y);
+
+    /**
+     * @brief Predicts the value at a point.
+     * @param[in] x Input vector.
+     * @param[out] mean Predictive mean.
+     * @param[out] variance Predictive variance.
+     */
+    void predict(const std::vector<double>& x, double& mean, double& variance) const;
+
+    /**
+     * @brief Expected improvement of a point over a value when maximizing.
+     * @param[in] x Input vector.
+     * @param[in] best Best value observed so far.
+     * @return Expected improvement, 0 or more.
+     */
+    double expectedImprovement(const std::vector<double>& x, const double best) const;
+
+    /**
+     * @brief Returns the number of observations.
+     */
+    inline size_t size() const {
+        return values.size();
+    }
+
+protected:
+    const size_t dimension;
+    const double lengthScale;
+    const double noise;
+    double priorMean, priorScale;
+
+    std::vector<double> points;     ///< Input vectors of the observations, one after another
+    std::vector<double> values;     ///< Standardized observed values
+    std::vector<double> cholesky;   ///< Lower triangular Cholesky factor, packed row by row
+    std::vector<double> z;          ///< L^-1 of the standardized values
+    mutable std::vector<double> v;  ///< Temporary for predict()
+
+    double kernel(const double * const a, const double * const b) const;
+
+    /**
+     * @brief Solves L v = k(X, x) for the observations X.
+     */
+    void solve(const double * const x, std::vector<double>& result) const;
+};
+
+} /* namespace gpu_coverage */
+
+#endif /* INCLUDE_ARTICULATION_GAUSSIANPROCESS_H_ */
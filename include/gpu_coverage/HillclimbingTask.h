@@ -35,6 +35,7 @@
 #include <gpu_coverage/AbstractTask.h>
 #include <gpu_coverage/Scene.h>
 #include <gpu_coverage/RobotSceneConfiguration.h>
+#include <gpu_coverage/SharedBest.h>
 #include <vector>
 
 #define WRITE_VISUALIZATION_DATA true
@@ -46,7 +47,10 @@ class CostMapRenderer;
 class BellmanFordXfbRenderer;
 class PanoRenderer;
 class PanoEvalRenderer;
+class PanoVisibilityRenderer;
 class Renderer;
+class Checkpoint;
+class PoseCache;
 
 class HillclimbingTask: public AbstractTask {
 public:
@@ -54,12 +58,15 @@ public:
     virtual ~HillclimbingTask();
 
     virtual void run();
-    static void allocateSharedData();
+    static void allocateSharedData(const size_t numThreads);
     static void freeSharedData();
 
 protected:
     Scene * const scene;
     const size_t numIterations, numArticulations;
+    const size_t numTopUtilities;
+    const int topUtilitySpacing;
+    PanoVisibilityRenderer * panoVisibilityRenderer;
 
     Texture * costmapTexture;
     Node * cameraNode;
@@ -75,6 +82,22 @@ protected:
     std::vector<GLuint> targetTextures;
     std::vector<std::string> targetNames;
 
+    const size_t checkpointInterval;    ///< Number of iterations between checkpoints, 0 to disable
+    Checkpoint * checkpoint;            ///< Checkpoint for resuming an interrupted run, NULL if disabled
+    uint64_t coverageState;             ///< Hash of the views taken so far, see PoseCache::getKey()
+
+    /**
+     * @brief Writes the current configuration and coverage textures to the checkpoint.
+     * @param[in] nextIteration Iteration at which a resumed run continues.
+     */
+    void saveCheckpoint(const size_t nextIteration);
+    /**
+     * @brief Restores the state written by saveCheckpoint() from the loaded checkpoint.
+     * @param[out] nextIteration Iteration at which to continue.
+     * @return False if the checkpoint does not match the scene.
+     */
+    bool resume(size_t& nextIteration);
+
     struct Configuration {
         glm::mat4x4 cameraTransform;
         size_t frame;
@@ -84,14 +107,38 @@ protected:
         }
     };
 
+    struct Utilities {
+        int a, x, y, utility;
+        Utilities(const int a, const int x, const int y, const int utility) : a(a), x(x), y(y), utility(utility) {}
+        bool operator<(const Utilities& other) const {
+            // total order so that all workers sort the shared candidates identically
+            if (utility != other.utility) {
+                return utility < other.utility;
+            }
+            if (a != other.a) {
+                return a < other.a;
+            }
+            return y != other.y ? y < other.y : x < other.x;
+        }
+    };
+
     struct TaskSharedData {
         // shared across processes, no pointers or dynamic memory here!
         RobotSceneConfiguration currentConfiguration;
         RobotSceneConfiguration bestConfiguration;
         float bestEval;
+        volatile size_t numUtilities;  ///< Number of entries in sharedUtilities, incremented atomically
         bool finished;
     };
     static TaskSharedData *taskSharedData;
+    static SharedBest *sharedBest;      ///< Lock-free reduction of the best candidate, stored behind taskSharedData
+    static PoseCache *poseCache;        ///< Pixel counts of evaluated poses, stored behind sharedBest, NULL if disabled
+    static Utilities *sharedUtilities;  ///< Top utility cells of all workers, stored behind taskSharedData
+    static size_t maxSharedUtilities;   ///< Capacity of sharedUtilities
+    static size_t sharedDataSize;       ///< Size of the shared memory mapping
+
+    static size_t sharedBestOffset();
+    static size_t poseCacheOffset(const size_t numThreads);
 };
 
 } /* namespace gpu_coverage */
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#ifndef INCLUDE_ARTICULATION_LAZYGREEDYTASK_H_
+#define INCLUDE_ARTICULATION_LAZYGREEDYTASK_H_
+
+#include <gpu_coverage/AbstractTask.h>
+#include <gpu_coverage/Scene.h>
+#include <gpu_coverage/RobotSceneConfiguration.h>
+#include <gpu_coverage/RobotSceneConfigurationPool.h>
+#include <vector>
+
+namespace gpu_coverage {
+
+class VisibilityRenderer;
+
+/**
+ * @brief Greedy set cover of the targets with lazy evaluation of the marginal coverage gain.
+ *
+ * A fixed set of random candidate views is sampled once. The candidates are rendered once
+ * to initialize an upper bound of their marginal gain, i.e., the number of target texels
+ * they would observe in addition to the texels covered so far. In every step, the candidate
+ * with the highest bound is re-rendered against the current coverage. If its fresh gain is
+ * still the highest bound, it is selected, otherwise it is re-inserted with the fresh gain.
+ * As coverage is submodular, gains can only decrease and the selected views are the same as
+ * with full greedy evaluation of all candidates in every step.
+ *
+ * The initial evaluation is split across the workers. The lazy evaluation runs on the first
+ * worker, and all workers apply the selected view to their coverage textures.
+ */
+class LazyGreedyTask: public AbstractTask {
+public:
+    LazyGreedyTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData,
+            const size_t numSteps, const size_t numArticulationConfigs, const size_t numCameraPoses);
+    virtual ~LazyGreedyTask();
+
+    virtual void run();
+    static void allocateSharedData(const size_t numCandidates);
+    static void freeSharedData();
+
+protected:
+    Scene * const scene;
+    const size_t numSteps, numArticulationConfigs, numCameraPoses, numCandidates;
+
+    Node * cameraNode;
+    VisibilityRenderer * visibilityRenderer;
+
+    GLuint targetTexture[20];
+    size_t numTargetTextures;
+    std::vector<glm::vec3> targetPoints;
+    RobotSceneConfigurationPool candidatePool;
+
+    /**
+     * @brief Renders a single candidate against the current coverage.
+     * @return Number of covered target texels including the ones covered by the candidate.
+     */
+    GLuint evaluate(const RobotSceneConfiguration& candidate);
+
+    /**
+     * @brief Stale upper bound of the marginal gain of a candidate.
+     */
+    struct Bound {
+        long gain;        ///< Marginal gain when the candidate was evaluated last
+        size_t index;     ///< Index of the candidate
+        size_t step;      ///< Step in which the gain was evaluated
+        Bound(const long gain, const size_t index, const size_t step) : gain(gain), index(index), step(step) {}
+        bool operator<(const Bound& other) const {
+            // max-heap on gain, lower candidate index first on ties
+            return gain != other.gain ? gain < other.gain : index > other.index;
+        }
+    };
+
+    struct TaskSharedData {
+        // shared across processes, no pointers or dynamic memory here!
+        unsigned int candidateSeed;   ///< Seed for sampling the same candidates in all workers
+        size_t selected;              ///< Candidate selected in the current step
+        bool finished;
+    };
+    static TaskSharedData *taskSharedData;
+    static GLuint *candidateCounts;   ///< Initial coverage count of every candidate, stored behind taskSharedData
+    static size_t sharedDataSize;     ///< Size of the shared memory mapping
+};
+
+} /* namespace gpu_coverage */
+
+#endif /* INCLUDE_ARTICULATION_LAZYGREEDYTASK_H_ */
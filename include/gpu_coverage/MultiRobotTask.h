@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#ifndef INCLUDE_ARTICULATION_MULTIROBOTTASK_H_
+#define INCLUDE_ARTICULATION_MULTIROBOTTASK_H_
+
+#include <gpu_coverage/RandomSearchTask.h>
+#include <vector>
+
+namespace gpu_coverage {
+
+/**
+ * @brief Joint next-best-view planning for several robots observing the same scene.
+ *
+ * In every iteration, each robot moves to one new view. The candidates are sampled as in
+ * RandomSearchTask, but the expensive stages are shared by all robots: every articulation
+ * configuration renders one costmap and, with pruning enabled, one multi-source distance map
+ * starting at all robot positions (see BellmanFordXfbRenderer::setSourcePositions()), and every
+ * candidate is rendered once per iteration instead of once per robot.
+ *
+ * The views are then assigned greedily: the candidate and robot with the highest evaluation is
+ * selected, its view is added to the shared coverage, and the next candidate is chosen for the
+ * remaining robots. As coverage is submodular, the gain of a candidate rendered before the last
+ * selection is an upper bound of its current gain. Only candidates whose bound can beat the best
+ * up-to-date evaluation are re-rendered, as in LazyGreedyTask, so views of different robots do not
+ * observe the same texels twice.
+ *
+ * The cost of a candidate for a robot is computed from the robot's camera pose, the articulation
+ * state is shared by all robots. With pruning enabled, candidates that no robot can reach are
+ * discarded, and the distance map labels every candidate with the nearest robot along the costmap
+ * (see BellmanFordXfbRenderer::getSources()). A candidate is then only assigned to that robot, with
+ * the path length instead of the Euclidean distance as travel cost. Candidates whose nearest robot
+ * has already moved wait for the next iteration. Without pruning, no distance map is rendered and a
+ * candidate is assigned to the robot with the highest evaluation by Euclidean distance.
+ *
+ * The following parameters are used in addition to the ones of RandomSearchTask:
+ * | Parameter        | Description |
+ * | ---------------- | ----------- |
+ * | multiRobotCount  | Number of robots |
+ * | multiRobotStarts | Start positions "x y x y ..." of the robots in the frame of the robot camera's parent node, robots without a start position begin at the robot camera pose |
+ */
+class MultiRobotTask: public RandomSearchTask {
+public:
+    MultiRobotTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData,
+            const size_t numIterations, const size_t numArticulationConfigs, const size_t numCameraPoses);
+    virtual ~MultiRobotTask();
+
+    virtual void run();
+    static void allocateSharedData(const size_t numThreads);
+    static void freeSharedData();
+
+protected:
+    const size_t numRobots;
+    std::vector<RobotSceneConfiguration *> robots;   ///< Previous configuration of every robot, see updateRobots()
+    std::vector<GLuint> pixelCounts;                 ///< Reused by render()
+    std::vector<GLint> distances;                    ///< Distance map of the current articulation configuration
+    std::vector<GLint> nearestSources;               ///< Nearest robot of every cell of the distance map
+    float pathLengthScale;                           ///< Path length per distance map unit
+
+    /**
+     * @brief Candidate rendered in the current iteration.
+     */
+    struct Candidate {
+        RobotSceneConfiguration * configuration;
+        long gain;          ///< Newly observed texels when the candidate was rendered last
+        size_t selection;   ///< Number of selections in this iteration when the candidate was rendered last
+        float bound;        ///< Upper bound of the evaluation for the unassigned robots
+        size_t robot;       ///< Nearest robot along the distance map, numRobots if any robot may move there
+        float pathLength;   ///< Path length from the nearest robot, unused if robot is numRobots
+        Candidate(RobotSceneConfiguration * const configuration, const long gain, const size_t robot,
+                const float pathLength)
+                : configuration(configuration), gain(gain), selection(0), bound(0.f), robot(robot),
+                  pathLength(pathLength) {}
+        bool operator<(const Candidate& other) const {
+            // descending by bound
+            return bound > other.bound;
+        }
+    };
+
+    /**
+     * @brief Renders a single candidate against the current coverage.
+     * @return Number of covered target texels including the ones covered by the candidate.
+     */
+    GLuint render(const RobotSceneConfiguration& candidate);
+
+    /**
+     * @brief Returns the robot with the highest evaluation of a candidate.
+     * @param[in] candidate Candidate with up-to-date count.
+     * @param[in] nearestRobot Nearest robot along the distance map, numRobots to consider all robots.
+     * @param[in] pathLength Path length from nearestRobot to the candidate.
+     * @param[in] assigned Robots that already moved in this iteration.
+     * @param[out] eval Receives the evaluation of the candidate for the returned robot.
+     * @return Robot index, numRobots if no eligible robot is left.
+     *
+     * With a nearest robot, only that robot is eligible and its travel cost uses the path length,
+     * otherwise all unassigned robots are compared by Euclidean distance.
+     */
+    size_t getBestRobot(const RobotSceneConfiguration& candidate, const size_t nearestRobot, const float pathLength,
+            const std::vector<bool>& assigned, float& eval);
+
+    /**
+     * @brief Renders the distance map of a configuration and looks up its nearest robot.
+     * @param[in] configuration Configuration, its articulation is applied to the scene.
+     * @param[out] pathLength Receives the path length from the nearest robot.
+     * @return Nearest robot, numRobots without pruning or if the configuration is not reachable.
+     */
+    size_t findNearestRobot(const RobotSceneConfiguration& configuration, float& pathLength);
+
+    /**
+     * @brief Copies the shared robot poses into robots.
+     *
+     * Every robot has its own camera pose and the articulation state and coverage count of the
+     * shared current configuration, so it can be passed as previous configuration to getEvaluation().
+     */
+    void updateRobots();
+
+    struct MultiRobotSharedData {
+        // shared across processes, no pointers or dynamic memory here!
+        size_t selectedRobot;   ///< Robot of the current selection, numRobots if no robot moves
+    };
+    static MultiRobotSharedData *multiRobotSharedData;
+    static glm::mat4 *robotTransforms;    ///< Camera local transform of every robot, stored behind multiRobotSharedData
+    static size_t multiRobotSharedDataSize;
+};
+
+} /* namespace gpu_coverage */
+
+#endif /* INCLUDE_ARTICULATION_MULTIROBOTTASK_H_ */
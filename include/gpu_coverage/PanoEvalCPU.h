@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#ifndef INCLUDE_ARTICULATION_PANOEVALCPU_H_
+#define INCLUDE_ARTICULATION_PANOEVALCPU_H_
+
+#include GL_INCLUDE
+#include <cstddef>
+#include <vector>
+
+namespace gpu_coverage {
+
+/**
+ * @brief CPU reference implementation of the panorama evaluation in PanoEvalRenderer.
+ *
+ * Consumes equirectangular semantic panoramas as rendered by PanoRenderer (RGBA8, row-major,
+ * first row at the bottom as returned by glGetTexImage) and produces the same integral images,
+ * gain maps and utility maps as the tl-edge, tl-step, pano-eval, utility1 and utility2 shaders.
+ * The work is split into row or column ranges that are processed by worker threads.
+ *
+ * This allows evaluating utilities on machines without a GPU and cross-checking the shader path.
+ * Differences to the GPU are limited to texels whose sampling coordinates lie exactly on a
+ * texel border, and to panoramas where tl-step does not converge within its iteration limit.
+ */
+class PanoEvalCPU {
+public:
+    /**
+     * @brief Constructor.
+     * @param[in] panoWidth Width of the panoramas.
+     * @param[in] panoHeight Height of the panoramas.
+     * @param[in] mapWidth Width of the cost, gain and utility maps.
+     * @param[in] mapHeight Height of the cost, gain and utility maps.
+     * @param[in] numThreads Number of worker threads, at least 1.
+     */
+    PanoEvalCPU(const int panoWidth, const int panoHeight, const int mapWidth, const int mapHeight,
+            const size_t numThreads);
+
+    /**
+     * @brief Destructor.
+     */
+    virtual ~PanoEvalCPU();
+
+    /**
+     * @brief Computes the integral image of a panorama, equivalent to tl-edge followed by tl-step until convergence.
+     * @param[in] pano Panorama, panoWidth * panoHeight RGBA8 pixels.
+     * @param[in] clockwise Direction of the panorama edge.
+     * @param[out] integral Two values per pixel, same layout as the RG32I integral texture.
+     */
+    void computeIntegral(const GLubyte * const pano, const bool clockwise, std::vector<GLint>& integral) const;
+
+    /**
+     * @brief Computes the gain map of a panorama, equivalent to the pano-eval shader.
+     * @param[in] pano Panorama, panoWidth * panoHeight RGBA8 pixels.
+     * @param[in] integral Integral image computed by computeIntegral().
+     * @param[out] gain Gain map, mapWidth * mapHeight values.
+     */
+    void computeGain(const GLubyte * const pano, const std::vector<GLint>& integral, std::vector<GLint>& gain) const;
+
+    /**
+     * @brief Updates a utility map with one or two gain maps, equivalent to the utility1 and utility2 shaders.
+     * @param[in] utility Previous utility map, initially the cost map.
+     * @param[in] gain1 Gain map of the first panorama.
+     * @param[in] gain2 Gain map of the second panorama or NULL for a single panorama.
+     * @param[out] result New utility map, must not be the same vector as utility.
+     */
+    void computeUtility(const std::vector<GLint>& utility, const std::vector<GLint>& gain1,
+            const std::vector<GLint> * const gain2, std::vector<GLint>& result) const;
+
+    /**
+     * @brief Evaluates a panorama camera pair as PanoEvalRenderer::display() does for one pair.
+     * @param[in] first Panorama of the first camera.
+     * @param[in] second Panorama of the second camera or NULL for a single camera.
+     * @param[in,out] utility Utility map, initialize with the cost map before evaluating the first pair.
+     */
+    void evaluatePair(const GLubyte * const first, const GLubyte * const second, std::vector<GLint>& utility) const;
+
+protected:
+    /**
+     * @brief Work item processed in parallel by parallelFor().
+     */
+    struct Job {
+        virtual ~Job() {}
+        /**
+         * @brief Processes the items [begin, end).
+         */
+        virtual void run(const size_t begin, const size_t end) = 0;
+    };
+
+    /**
+     * @brief Splits [0, n) into one contiguous range per thread and waits until all ranges are processed.
+     */
+    void parallelFor(Job& job, const size_t n) const;
+    static void * threadMain(void * arg);
+
+    const int panoWidth;     ///< Width of the panoramas.
+    const int panoHeight;    ///< Height of the panoramas.
+    const int mapWidth;      ///< Width of the cost, gain and utility maps.
+    const int mapHeight;     ///< Height of the cost, gain and utility maps.
+    const size_t numThreads; ///< Number of worker threads.
+
+    struct EdgeJob;
+    struct RowRunJob;
+    struct ColumnRunJob;
+    struct GainJob;
+    struct UtilityJob;
+};
+
+} /* namespace gpu_coverage */
+
+#endif /* INCLUDE_ARTICULATION_PANOEVALCPU_H_ */
@@ -36,9 +36,12 @@
 #include <gpu_coverage/BellmanFordRenderer.h>
 #include <gpu_coverage/PanoRenderer.h>
 #include <list>
+#include <vector>
 
 namespace gpu_coverage {
 
+class PanoEvalCPU;
+
 class PanoEvalRenderer: public AbstractRenderer {
 public:
     PanoEvalRenderer(const Scene * const scene, const bool renderToWindow, const bool renderToTexture,
@@ -68,6 +71,34 @@ public:
     void addCamera(CameraPanorama * const cam);
     void addCameraPair(CameraPanorama * const first, CameraPanorama * const second);
 
+    /**
+     * @brief Cell of the utility map, layout matches the candidate buffers of the utility-topk shaders.
+     */
+    struct UtilityCell {
+        GLint utility;  ///< Utility value, lower is better.
+        GLint x;        ///< Column in the utility map.
+        GLint y;        ///< Row in the utility map.
+        GLint valid;    ///< 0 if there was no further cell to select.
+    };
+
+    /**
+     * @brief Selects the best cells of the current utility map on the GPU.
+     * @param[in] k Maximum number of cells to return.
+     * @param[in] minSpacing Minimum distance between two returned cells in utility map cells, 0 to disable.
+     * @param[in] maxUtility Cells with a utility of at least this value are ignored (e.g., unreachable cells).
+     * @param[out] result The selected cells, sorted by ascending utility.
+     *
+     * Only the k selected cells are read back from the GPU instead of the full utility map.
+     * Falls back to a CPU implementation if compute shaders are not available.
+     *
+     * The GPU selection keeps at most k cells per 8x8 tile, suppressing neighbors within the tile,
+     * before the tiles are merged. Without spacing, this yields the k best cells. With minSpacing > 0,
+     * the result is an approximation of greedy suppression over the whole map: a cell suppressed
+     * within its tile by a cell that the merge drops later is not considered again, so the CPU
+     * fallback may return different cells.
+     */
+    void getTopUtilities(const size_t k, const int minSpacing, const int maxUtility, std::vector<UtilityCell>& result);
+
 protected:
     const bool renderToWindow;
     const bool renderToTexture;
@@ -81,6 +112,11 @@ protected:
     ProgramUtility1 progUtility1;
     ProgramUtility2 progUtility2;
     ProgramShowTexture *progShowTexture;
+    ProgramUtilityTopKTile *progUtilityTopKTile;
+    ProgramUtilityTopKMerge *progUtilityTopKMerge;
+    ProgramPanoEvalFused *progPanoEvalFused;  ///< Non-NULL if the fused evaluation is used.
+    PanoEvalCPU *cpuReference;                ///< Non-NULL if the results are checked against the CPU (panoEvalVerify).
+    std::vector<GLubyte> verifyPanos[2];      ///< Panoramas of the current pair read back for the CPU check.
 
     GLuint framebuffer;
     GLuint vao;
@@ -88,9 +124,13 @@ protected:
     GLuint textures[9];
 
     GLuint counterBuffer;
+    GLuint topKCandidateBuffer;
+    GLuint topKResultBuffer;
+    size_t topKCapacity;
     GLuint pbo[3];
     const size_t numPbo;
     const size_t maxIterations;
+    static const int maxFusedWidth = 2048;  ///< Must match MAX_WIDTH in the pano-eval-fused shader.
 
     GLuint panoTexture;
     int panoWidth;
@@ -100,6 +140,8 @@ protected:
     GLuint bellmanFordWidth;
     GLuint bellmanFordHeight;
 
+    GLenum integralFormat;  ///< Format of the integral image textures SWAP1 and SWAP2.
+
     enum TextureRole {
         EVAL,
         SWAP1,
@@ -125,6 +167,15 @@ protected:
     Node * projectionPlaneNode;
 
     bool link(const GLuint program, const char * const name) const;
+    /**
+     * @brief Recomputes the gain maps and the utility map of a pair on the CPU and logs the largest differences.
+     * @param[in] pair The pair whose panoramas are stored in verifyPanos and whose GPU results are current.
+     * @param[in] utility Utility map before the pair was evaluated.
+     */
+    void verifyPair(const PanoEdgePair& pair, const std::vector<GLint>& utility);
+    void readIntTexture(const GLuint texture, std::vector<GLint>& values) const;
+    void getTopUtilitiesCPU(const size_t k, const int minSpacing, const int maxUtility,
+            std::vector<UtilityCell>& result) const;
 
 };
 
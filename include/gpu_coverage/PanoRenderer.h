@@ -60,6 +60,20 @@ public:
     inline void setCamera(CameraPanorama * const camera) {
         this->camera = camera;
     }
+    inline const GLuint& getCubemapTexture() const {
+        return colorCubeMap;
+    }
+    inline bool hasEquirectangularCubemap() const {
+        return renderToCubemap && panoOutputFormat == Config::EQUIRECTANGULAR;
+    }
+    /**
+     * @brief Enables or disables projecting the cube map to the panorama texture.
+     *
+     * Disable if only the cube map is used, e.g. by the fused panorama evaluation.
+     */
+    inline void setProjectToMap(const bool projectToMap) {
+        this->projectToMap = projectToMap;
+    }
 
 protected:
     const bool renderToWindow;
@@ -73,6 +87,7 @@ protected:
     GLuint framebuffer;
     Config::PanoOutputValue panoOutputFormat;
     bool renderToCubemap;
+    bool projectToMap;
 
     AbstractProgramMapProjection *progMapProjection;
     ProgramShowTexture progShowTexture;
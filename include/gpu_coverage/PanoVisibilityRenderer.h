@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#ifndef INCLUDE_ARTICULATION_PANOVISIBILITYRENDERER_H_
+#define INCLUDE_ARTICULATION_PANOVISIBILITYRENDERER_H_
+
+#include <gpu_coverage/AbstractRenderer.h>
+#include <gpu_coverage/Programs.h>
+#include <list>
+#include <vector>
+
+namespace gpu_coverage {
+
+class CameraPanorama;
+
+/**
+ * @brief Scores many camera orientations at one position from a single panorama rendering.
+ *
+ * Instead of rendering the scene once per candidate orientation like VisibilityRenderer,
+ * this renderer renders the target visibility once into a cube map at the position of
+ * the panorama camera. For every observed target texel, the world position of the observed
+ * surface is stored. A compute pass then counts for every candidate view the observed
+ * texels inside the view frustum that are not yet covered in the target textures.
+ *
+ * The counts approximate the gain of VisibilityRenderer::getPixelCounts() over the current
+ * coverage for the same views, deviations are caused by the different resolution of the cube
+ * map faces. They are not exact, so they should only be used for ranking views.
+ */
+class PanoVisibilityRenderer: public AbstractRenderer {
+public:
+    /**
+     * @brief Constructor.
+     * @param[in] scene Scene to be rendered.
+     * @param[in] panoCamera Panorama camera at the position to be evaluated.
+     * @param[in] camera Camera whose projection is used for the candidate views.
+     */
+    PanoVisibilityRenderer(const Scene * const scene, CameraPanorama * const panoCamera,
+            const AbstractCamera * const camera);
+
+    /**
+     * @brief Destructor.
+     */
+    virtual ~PanoVisibilityRenderer();
+
+    /**
+     * @brief Renders the panorama and counts the observed texels for all views set by setViews().
+     */
+    virtual void display();
+
+    /**
+     * @brief Sets the candidate views to be scored by display().
+     * @param[in] views View matrices (world to camera) of the candidate views, at most maxViews.
+     */
+    void setViews(const std::vector<glm::mat4>& views);
+
+    /**
+     * @brief Returns the number of newly observed target texels for each view of the previous display() call.
+     * @param[out] gains Number of observed texels not covered in the target textures, in the order of
+     * the views passed to setViews(). Add the current coverage count to compare with VisibilityRenderer.
+     *
+     * This method waits for the GPU to finish the computation.
+     */
+    void getGains(std::vector<GLuint>& gains);
+
+    /**
+     * @brief Returns the OpenGL texture ID of the position map of the first target.
+     * @return OpenGL texture ID.
+     */
+    inline const GLuint& getTexture() const {
+        return textures[POSITION];
+    }
+
+    /**
+     * @brief Width of the position maps.
+     * @return Width in pixels.
+     */
+    inline const int& getTextureWidth() const {
+        return textureWidth;
+    }
+
+    /**
+     * @brief Height of the position maps.
+     * @return Height in pixels.
+     */
+    inline const int& getTextureHeight() const {
+        return textureHeight;
+    }
+
+    static const size_t maxViews = 256;                       ///< Maximum number of views, must match MAX_VIEWS in the pano-visibility-gain shader
+
+protected:
+    CameraPanorama * const panoCamera;                        ///< Panorama camera at the evaluated position
+    const AbstractCamera * const camera;                      ///< Camera providing the projection of the candidate views
+    ProgramPanoSemantic progPanoSemantic;                     ///< Shader for rendering obstacles to the depth cube map
+    ProgramPanoVisibility progPanoVisibility;                 ///< Shader for storing observed target positions
+    ProgramPanoVisibilityGain progPanoVisibilityGain;         ///< Shader for counting observed texels per view
+    const int cubemapWidth;                                   ///< Width of a cube map side in pixels
+    const int cubemapHeight;                                  ///< Height of a cube map side in pixels
+    const int textureWidth;                                   ///< Width of the position maps in pixels
+    const int textureHeight;                                  ///< Height of the position maps in pixels
+    GLuint framebuffers[2];                                   ///< Framebuffers for rendering the cube map and for clearing the position maps
+    GLuint depthCubeMap;                                      ///< Depth cube map
+    GLuint textures[16];                                      ///< Position map for each target
+    size_t numTextures;                                       ///< Number of allocated textures
+    GLuint viewBuffer;                                        ///< Shader storage buffer with the view-projection matrices
+    GLuint gainBuffer;                                        ///< Shader storage buffer with the texel count per view
+    size_t numViews;                                          ///< Number of views set by setViews()
+    Node * projectionPlaneNode;                               ///< Virtual surface where camera can be placed, only used to hide while rendering
+    typedef std::list<Node *> Targets;                        ///< List of targets (regions of interest)
+    Targets targets;                                          ///< List of targets (regions of interest)
+    std::vector<GLuint> coverageTextures;                     ///< Coverage texture of each target, texels already covered are not counted
+
+    enum TextureRole {
+        POSITION = 0                                          ///< Position map of the first target
+    };
+};
+
+} /* namespace gpu_coverage */
+
+#endif /* INCLUDE_ARTICULATION_PANOVISIBILITYRENDERER_H_ */
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#ifndef INCLUDE_ARTICULATION_PARALLELTEMPERINGTASK_H_
+#define INCLUDE_ARTICULATION_PARALLELTEMPERINGTASK_H_
+
+#include <gpu_coverage/CmaEsTask.h>
+#include <cstdlib>
+#include <vector>
+
+namespace gpu_coverage {
+
+/**
+ * @brief Next-best-view search with parallel tempering over the articulation vector and the camera pose.
+ *
+ * Uses the same candidate vectors and iterations as CmaEsTask. Every worker runs temperingChains
+ * Metropolis chains, each at its own temperature of a geometric ladder over all chains of all workers.
+ * All chains start at the current configuration. In every sweep, each chain proposes one move,
+ * either setting one articulated object to a random value and the others to the zero configuration
+ * or perturbing the camera pose, and the proposals of all chains of a worker are rendered as one batch.
+ * A proposal is accepted with probability min(1, exp((e' - e) / T)) for the evaluations e and e'.
+ *
+ * Every temperingExchangeInterval sweeps, the chain states of all workers are written to shared memory
+ * and the first worker swaps the states of chains with neighboring temperatures with probability
+ * min(1, exp((e_hot - e_cold) (1 / T_cold - 1 / T_hot))), alternating between even and odd pairs.
+ * The hot chains explore and hand good states down to the cold chains, which refine them, so no
+ * restarts are needed to leave local optima.
+ *
+ * The following parameters are used:
+ * | Parameter                 | Description |
+ * | ------------------------- | ----------- |
+ * | temperingChains           | Number of chains per worker, rendered as one batch |
+ * | temperingExchangeInterval | Number of sweeps between replica exchanges |
+ * | temperingMaxTemperature   | Temperature of the hottest chain, in units of the evaluation |
+ * | temperingMinTemperature   | Temperature of the coldest chain, in units of the evaluation |
+ * | temperingStepSize         | Maximum camera pose change of a move in the normalized search space |
+ * | temperingSweeps           | Number of sweeps per iteration |
+ */
+class ParallelTemperingTask: public CmaEsTask {
+public:
+    ParallelTemperingTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData,
+            const size_t numIterations);
+    virtual ~ParallelTemperingTask();
+
+    static void allocateSharedData(const size_t numThreads);
+    static void freeSharedData();
+
+protected:
+    const size_t numChains, numSweeps, exchangeInterval;
+    const double stepSize;
+    std::vector<double> temperatures;   ///< Temperatures of the chains of this worker
+
+    virtual size_t search(RobotSceneConfiguration& bestConfiguration, float& bestEval);
+
+    /**
+     * @brief Proposes a move of a chain.
+     * @param[in] x State of the chain.
+     * @param[out] proposal Receives the proposed state.
+     */
+    void propose(const std::vector<double>& x, std::vector<double>& proposal);
+
+    /**
+     * @brief Swaps states between chains of neighboring temperatures across all workers.
+     * @param[in,out] states States of the chains of this worker.
+     * @param[in,out] evals Evaluations of the states.
+     * @param[in] exchange Number of the exchange in this iteration, selects even or odd pairs.
+     * @param[in,out] failed Set to true if the renders of any worker have failed since the last exchange.
+     * @return Number of swaps, only counted by the first worker.
+     */
+    size_t exchangeReplicas(std::vector<std::vector<double> >& states, std::vector<double>& evals,
+            const size_t exchange, bool& failed);
+
+    /**
+     * @brief Returns the temperature of a chain.
+     * @param[in] chain Index of the chain over all workers.
+     */
+    static double getTemperature(const size_t chain, const size_t numChains);
+
+    /**
+     * @brief Returns a uniformly random value in [0, 1).
+     */
+    inline double uniform() {
+        return rand_r(&seed) / (static_cast<double>(RAND_MAX) + 1.);
+    }
+
+    static double *chainStates;         ///< Candidate vectors and evaluations of all chains for the replica exchange
+    static size_t chainStatesSize;      ///< Size of the shared memory mapping of chainStates
+};
+
+} /* namespace gpu_coverage */
+
+#endif /* INCLUDE_ARTICULATION_PARALLELTEMPERINGTASK_H_ */
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#ifndef INCLUDE_ARTICULATION_POSECACHE_H_
+#define INCLUDE_ARTICULATION_POSECACHE_H_
+
+#include <gpu_coverage/RobotSceneConfiguration.h>
+#include GL_INCLUDE
+#include <stdint.h>
+#include <string>
+
+namespace gpu_coverage {
+
+/**
+ * @brief Lock-free cache of the pixel counts of evaluated configurations.
+ *
+ * Like SharedBest, the cache is placed in memory shared between the worker
+ * threads or processes, see getSize() and create(). It is an open addressing
+ * hash table of bounded size. An entry is found within a few slots of its
+ * home slot, and if all of them are taken, a new entry replaces one of them.
+ *
+ * The key of an entry is a 64 bit hash of the quantized camera pose, the
+ * articulation and the coverage state, see getKey(). The pixel count of a
+ * pose depends on the target texels observed so far, hence the coverage
+ * state must identify the sequence of views that has been taken before.
+ * Every view changes the coverage state, so within a run an entry is only
+ * hit by a pose that is evaluated twice in the same iteration, which is
+ * rare. The cache pays off when a run repeats the views of an earlier run
+ * of the same scene and settings, e.g. a restart with the same seed, with
+ * the entries kept in a file by load() and save(). It does not speed up a
+ * single run.
+ */
+class PoseCache {
+public:
+    /**
+     * @brief Returns the number of bytes needed for the cache.
+     * @param[in] capacity Maximum number of entries, rounded up to a power of two.
+     * @return Size in bytes including the entries.
+     */
+    static size_t getSize(const size_t capacity);
+
+    /**
+     * @brief Initializes an empty cache in the given memory.
+     * @param[in] memory Memory of getSize() bytes shared between the workers, aligned to 8 bytes.
+     * @param[in] capacity Maximum number of entries, rounded up to a power of two.
+     * @return The cache, located at the start of memory.
+     *
+     * Must be called before the workers are forked.
+     */
+    static PoseCache * create(void * const memory, const size_t capacity);
+
+    /**
+     * @brief Computes a hash of arbitrary data.
+     * @param[in] data Data to hash.
+     * @param[in] size Size of the data in bytes.
+     * @param[in] seed Hash to continue from, e.g. a previous result.
+     * @return 64 bit FNV-1a hash.
+     */
+    static uint64_t hash(const void * const data, const size_t size, const uint64_t seed);
+
+    /**
+     * @brief Computes the initial coverage state of a scene.
+     * @param[in] mode Name of the task, pixel counts of different tasks are not interchangeable.
+     * @param[in] projection Projection matrix of the robot camera.
+     * @param[in] textureWidth Width of the texture in which the visible pixels are counted.
+     * @param[in] textureHeight Height of the texture in which the visible pixels are counted.
+     * @return Hash of the scene file, target and camera names, the panorama orientation search
+     *         setting and the parameters, so that counts of other settings are never looked up.
+     */
+    static uint64_t getSceneState(const std::string& mode, const glm::mat4& projection, const int textureWidth,
+            const int textureHeight);
+
+    /**
+     * @brief Computes the key of a configuration.
+     * @param[in] configuration Configuration whose camera pose and articulation are hashed.
+     * @param[in] state Coverage state before the configuration is evaluated.
+     * @return Key of the configuration.
+     *
+     * The key of a configuration that has been taken as a view is also the
+     * coverage state after it.
+     */
+    static uint64_t getKey(const RobotSceneConfiguration& configuration, const uint64_t state);
+
+    /**
+     * @brief Looks up the pixel count of a key.
+     * @param[in] key Key computed by getKey().
+     * @param[out] count Receives the pixel count if found.
+     * @return True on a cache hit.
+     */
+    bool lookup(const uint64_t key, GLuint& count);
+
+    /**
+     * @brief Stores the pixel count of a key.
+     * @param[in] key Key computed by getKey().
+     * @param[in] count Pixel count of the configuration.
+     */
+    void insert(const uint64_t key, const GLuint count);
+
+    /**
+     * @brief Inserts the entries of a cache file written by save().
+     * @param[in] filename Cache file.
+     * @return Number of entries loaded, 0 if the file is missing or invalid.
+     *
+     * Must only be called while no worker accesses the cache.
+     */
+    size_t load(const std::string& filename);
+
+    /**
+     * @brief Writes all entries to a file.
+     * @param[in] filename Cache file.
+     * @return False if the file could not be written.
+     *
+     * Must only be called while no worker accesses the cache.
+     */
+    bool save(const std::string& filename) const;
+
+    inline uint64_t getHits() const {
+        return hits;
+    }
+    inline uint64_t getMisses() const {
+        return misses;
+    }
+
+protected:
+    /**
+     * @brief Entry of the hash table.
+     *
+     * value contains the upper 32 bits of the key and the pixel count, so
+     * that a reader detects an entry that is replaced while reading it.
+     */
+    struct Entry {
+        volatile uint64_t key;                 ///< Key of the entry, 0 if empty
+        volatile uint64_t value;               ///< Upper 32 bits of the key and pixel count, 0 if not yet written
+    };
+
+    size_t mask;                               ///< Number of entries minus one
+    volatile uint64_t hits;                    ///< Number of successful lookups
+    volatile uint64_t misses;                  ///< Number of failed lookups
+
+    static const size_t probeLength = 8;       ///< Number of slots searched for a key
+    static const uint32_t magic = 0x43504750;  ///< "GPPC" in little endian
+    static const uint32_t version = 1;         ///< File format version
+
+    inline Entry * getEntries() {
+        return reinterpret_cast<Entry *>(this + 1);
+    }
+    inline const Entry * getEntries() const {
+        return reinterpret_cast<const Entry *>(this + 1);
+    }
+    static inline uint64_t packValue(const uint64_t key, const GLuint count) {
+        return (key & 0xffffffff00000000ull) | count;
+    }
+};
+
+} /* namespace gpu_coverage */
+
+#endif /* INCLUDE_ARTICULATION_POSECACHE_H_ */
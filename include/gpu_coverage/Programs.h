@@ -454,8 +454,9 @@ public:
     struct Locations {
         GLint resolution;
         GLint robotPosition;
+        GLint source;
         Locations()
-                : resolution(-1), robotPosition(-1) {
+                : resolution(-1), robotPosition(-1), source(-1) {
         }
     } locations;
 };
@@ -515,6 +516,116 @@ public:
     } locations;
 };
 
+class ProgramUtilityTopKTile : public AbstractProgram {
+public:
+    ProgramUtilityTopKTile();
+    ~ProgramUtilityTopKTile();
+    struct Locations {
+        GLint utilityUnit;
+        GLint k;
+        GLint maxUtility;
+        GLint minSpacing;
+        Locations()
+                : utilityUnit(-1), k(-1), maxUtility(-1), minSpacing(-1) {
+        }
+    } locations;
+};
+
+class ProgramUtilityTopKMerge : public AbstractProgram {
+public:
+    ProgramUtilityTopKMerge();
+    ~ProgramUtilityTopKMerge();
+    struct Locations {
+        GLint k;
+        GLint numCandidates;
+        GLint minSpacing;
+        Locations()
+                : k(-1), numCandidates(-1), minSpacing(-1) {
+        }
+    } locations;
+};
+
+class ProgramPanoVisibility : public AbstractProgram {
+public:
+    ProgramPanoVisibility();
+    ~ProgramPanoVisibility();
+    struct Locations {
+        GLint resolution;
+        Locations()
+                : resolution(-1) {
+        }
+    } locations;
+    LocationsMVP locationsMVP;
+};
+
+class ProgramPanoVisibilityGain : public AbstractProgram {
+public:
+    ProgramPanoVisibilityGain();
+    ~ProgramPanoVisibilityGain();
+    struct Locations {
+        GLint numViews;
+        GLint coverageUnit;
+        Locations()
+                : numViews(-1), coverageUnit(-1) {
+        }
+    } locations;
+};
+
+class ProgramPanoEvalFused : public AbstractProgram {
+public:
+    ProgramPanoEvalFused();
+    ~ProgramPanoEvalFused();
+    struct Locations {
+        GLint cubeUnit;
+        GLint width;
+        GLint height;
+        GLint clockwise;
+        Locations()
+                : cubeUnit(-1), width(-1), height(-1), clockwise(-1) {
+        }
+    } locations;
+};
+
+class ProgramReversePatches : public AbstractProgram {
+public:
+    ProgramReversePatches();
+    ~ProgramReversePatches();
+    LocationsMVP locationsMVP;
+};
+
+class ProgramReverseDepth : public AbstractProgram {
+public:
+    ProgramReverseDepth();
+    ~ProgramReverseDepth();
+    LocationsMVP locationsMVP;
+};
+
+class ProgramReverseGather : public AbstractProgram {
+public:
+    ProgramReverseGather();
+    ~ProgramReverseGather();
+    struct Locations {
+        GLint depthUnit;
+        GLint patchViewProjection;
+        GLint patchPosition;
+        GLint patchNormal;
+        GLint clipNear;
+        GLint clipFar;
+        GLint bias;
+        GLint weight;
+        GLint gridOrigin;
+        GLint cellSize;
+        GLint useFrustum;
+        GLint lookAt;
+        GLint cameraProjection;
+        Locations()
+                : depthUnit(-1), patchViewProjection(-1), patchPosition(-1), patchNormal(-1), clipNear(-1),
+                  clipFar(-1), bias(-1), weight(-1), gridOrigin(-1), cellSize(-1), useFrustum(-1), lookAt(-1),
+                  cameraProjection(-1) {
+        }
+    } locations;
+};
+
 
 } /* namespace gpu_coverage */
 
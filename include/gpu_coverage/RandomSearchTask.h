@@ -35,6 +35,9 @@
 #include <gpu_coverage/AbstractTask.h>
 #include <gpu_coverage/Scene.h>
 #include <gpu_coverage/RobotSceneConfiguration.h>
+#include <gpu_coverage/RobotSceneConfigurationPool.h>
+#include <gpu_coverage/CandidateBatch.h>
+#include <gpu_coverage/SharedBest.h>
 #include <vector>
 
 namespace gpu_coverage {
@@ -43,6 +46,8 @@ class VisibilityRenderer;
 class CostMapRenderer;
 class BellmanFordXfbRenderer;
 class Renderer;
+class Checkpoint;
+class PoseCache;
 
 class RandomSearchTask: public AbstractTask {
 public:
@@ -51,7 +56,7 @@ public:
     virtual ~RandomSearchTask();
 
     virtual void run();
-    static void allocateSharedData();
+    static void allocateSharedData(const size_t numThreads);
     static void freeSharedData();
 
 protected:
@@ -68,6 +73,43 @@ protected:
     GLuint targetTexture[20];
     size_t numTargetTextures;
     std::vector<glm::vec3> targetPoints;
+    RobotSceneConfigurationPool candidatePool;
+    CandidateBatch candidateBatch;      ///< Rendered candidates of an evaluateCandidates() call
+    const bool pipelined;
+    const std::string samplerType;      ///< Sampler for the candidate poses, see Sampler::create()
+    const bool sampleFreeSpace;         ///< Reject candidate poses on obstacles before rendering them
+    const bool pruneCandidates;         ///< Discard unreachable candidates and candidates bounded by the best evaluation
+
+    const size_t checkpointInterval;    ///< Number of iterations between checkpoints, 0 to disable
+    Checkpoint * checkpoint;            ///< Checkpoint for resuming an interrupted run, NULL if disabled
+    uint64_t coverageState;             ///< Hash of the views taken so far, see PoseCache::getKey()
+
+    static const size_t maxSampleRounds = 10;  ///< Maximum number of sampling rounds per articulation configuration
+
+    /**
+     * @brief Writes the current configuration, coverage textures and seed to the checkpoint.
+     * @param[in] nextIteration Iteration at which a resumed run continues.
+     * @param[in] baseSeed Seed of this thread at the start of the run.
+     */
+    void saveCheckpoint(const size_t nextIteration, const unsigned int baseSeed);
+    /**
+     * @brief Restores the state written by saveCheckpoint() from the loaded checkpoint.
+     * @param[out] nextIteration Iteration at which to continue.
+     * @param[out] baseSeed Seed of this thread at the start of the interrupted run.
+     * @return False if the checkpoint does not match the scene.
+     */
+    bool resume(size_t& nextIteration, unsigned int& baseSeed);
+
+    bool isAllowed(const std::vector<unsigned char>& allowedCells, const RobotSceneConfiguration& configuration) const;
+    /**
+     * @brief Computes the costmap cell below the camera of a configuration.
+     * @return False if the camera is outside of the costmap.
+     */
+    bool getCell(const RobotSceneConfiguration& configuration, size_t& cell) const;
+
+    void evaluateCandidates(const std::vector<RobotSceneConfiguration *>& configurations,
+            const std::vector<GLuint>& visibilityResults, size_t& numEvaluated,
+            RobotSceneConfiguration *& bestConfiguration, float& bestEval);
 
     struct TaskSharedData {
         // shared across processes, no pointers or dynamic memory here!
@@ -77,6 +119,12 @@ protected:
         bool finished;
     };
     static TaskSharedData *taskSharedData;
+    static SharedBest *sharedBest;      ///< Lock-free reduction of the best candidate, stored behind taskSharedData
+    static PoseCache *poseCache;        ///< Pixel counts of evaluated poses, stored behind sharedBest, NULL if disabled
+    static size_t sharedDataSize;       ///< Size of the shared memory mapping
+
+    static size_t sharedBestOffset();
+    static size_t poseCacheOffset(const size_t numThreads);
 
 };
 
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#ifndef INCLUDE_ARTICULATION_REVERSEVISIBILITYRENDERER_H_
+#define INCLUDE_ARTICULATION_REVERSEVISIBILITYRENDERER_H_
+
+#include <gpu_coverage/AbstractRenderer.h>
+#include <gpu_coverage/Programs.h>
+#include <vector>
+
+namespace gpu_coverage {
+
+/**
+ * @brief Renders the gain of all camera positions on a grid by rendering from the target instead of the cameras.
+ *
+ * The target meshes are unwrapped into their texture space on a patch atlas, every covered
+ * atlas texel becomes a target patch. For every patch, the scene depth is rendered from the patch
+ * towards the grid. Every grid cell whose camera position lies in front of the patch and passes the
+ * depth test like in shadow mapping then accumulates the number of target texels represented by
+ * the patch. The number of render passes thus depends on the number of patches, not on the
+ * number of grid cells.
+ *
+ * The result approximates the pixel counts of VisibilityRenderer for cameras above every cell.
+ * Patches are point samples of the target, and patches outside the maximum field of view of the
+ * patch camera are not counted.
+ */
+class ReverseVisibilityRenderer: public AbstractRenderer {
+public:
+    /**
+     * @brief Constructor.
+     * @param[in] scene Scene to be rendered.
+     * @param[in] width Number of grid cells in x direction.
+     * @param[in] height Number of grid cells in y direction.
+     * @param[in] textureWidth Width of the target textures counted by VisibilityRenderer.
+     * @param[in] textureHeight Height of the target textures counted by VisibilityRenderer.
+     */
+    ReverseVisibilityRenderer(const Scene * const scene, const int width, const int height,
+            const int textureWidth, const int textureHeight);
+
+    /**
+     * @brief Destructor.
+     */
+    virtual ~ReverseVisibilityRenderer();
+
+    /**
+     * @brief Renders the gain of all grid cells for the current frame.
+     */
+    virtual void display();
+
+    /**
+     * @brief Returns the OpenGL texture ID of the gain texture.
+     * @return OpenGL texture ID.
+     */
+    inline const GLuint& getTexture() const {
+        return textures[GAIN];
+    }
+    inline const int& getTextureWidth() const {
+        return width;
+    }
+    inline const int& getTextureHeight() const {
+        return height;
+    }
+
+    /**
+     * @brief Sets the camera positions of the grid cells.
+     * @param[in] origin Camera position above cell (0, 0).
+     * @param[in] cellSize Distance between the camera positions of neighbouring cells.
+     *
+     * The camera of cell (x, y) is at origin + (x * cellSize.x, y * cellSize.y, 0).
+     */
+    void setGrid(const glm::vec3& origin, const glm::vec2& cellSize);
+
+    /**
+     * @brief Restricts the gain to patches in the field of view of cameras looking at a point.
+     * @param[in] lookAt Point all cameras look at.
+     * @param[in] projection Projection matrix of the cameras.
+     *
+     * Without calling this method, the cameras see in all directions.
+     */
+    void setLookAt(const glm::vec3& lookAt, const glm::mat4& projection);
+
+    /**
+     * @brief Reads the gain rendered by the last call to display() back from the GPU.
+     * @param[out] gains Receives width * height gains, row by row.
+     */
+    void getGains(std::vector<GLuint>& gains) const;
+
+    /**
+     * @brief Returns the number of target patches rendered by the last call to display().
+     * @return Number of patches.
+     */
+    inline size_t getNumPatches() const {
+        return numPatches;
+    }
+
+protected:
+    const int width, height;
+    const int patchResolution;      ///< Edge length of the patch atlas
+    const int depthResolution;      ///< Edge length of the depth map rendered from each patch
+    float texelsPerPatch;           ///< Target texels represented by one atlas texel
+    ProgramReversePatches progPatches;
+    ProgramReverseDepth progDepth;
+    ProgramReverseGather progGather;
+    std::vector<Node*> targets;
+    glm::vec3 gridOrigin;
+    glm::vec2 cellSize;
+    bool useFrustum;
+    glm::vec3 lookAt;
+    glm::mat4 cameraProjection;
+    size_t numPatches;
+    GLuint framebuffers[3];
+    GLuint textures[4];
+    GLuint vao;
+    GLuint vbo;
+    enum TextureRole {
+        PATCH_POSITION = 0,
+        PATCH_NORMAL = 1,
+        DEPTH = 2,
+        GAIN = 3
+    };
+    enum FramebufferRole {
+        PATCH_FRAMEBUFFER = 0,
+        DEPTH_FRAMEBUFFER = 1,
+        GAIN_FRAMEBUFFER = 2
+    };
+    static const float clipNear;    ///< Near clipping plane of the patch cameras
+    static const float clipFar;     ///< Far clipping plane of the patch cameras
+    static const float maxFov;      ///< Maximum field of view of the patch cameras in radians
+};
+
+} /* namespace gpu_coverage */
+
+#endif /* INCLUDE_ARTICULATION_REVERSEVISIBILITYRENDERER_H_ */
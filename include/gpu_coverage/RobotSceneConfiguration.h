@@ -53,6 +53,13 @@ public:
      * @param[in] other RobotSceneConfiguration to copy data from.
      */
     explicit RobotSceneConfiguration(const RobotSceneConfiguration& other);
+    /**
+     * @brief Constructor with external storage for the articulation values.
+     * @param[in] articulationStorage Array of numArticulation values, must outlive this configuration.
+     *
+     * Used by RobotSceneConfigurationPool to avoid one heap allocation per configuration.
+     */
+    explicit RobotSceneConfiguration(float * const articulationStorage);
     /**
      * @brief Destructor.
      */
@@ -69,6 +76,16 @@ public:
      */
     float getCost(RobotSceneConfiguration& previousConfig) const;
 
+    /**
+     * @brief Computes the cost for transitioning from a previous configuration along a known path.
+     * @param[in] previousConfig The previous configuration.
+     * @param[in] pathLength Length of the robot's path from the previous camera position, e.g., from a distance map.
+     * @return Cost value.
+     *
+     * Same as getCost(), but with the path length instead of the Euclidean distance between the camera positions.
+     */
+    float getCost(RobotSceneConfiguration& previousConfig, const float pathLength) const;
+
     /**
      * @brief Calculates the information gain achieved by moving to the new configuration.
      * @param[in] previousConfig The previous configuration.
@@ -113,12 +130,26 @@ public:
      */
     void setRandomArticulation(unsigned int& seed);
 
+    /**
+     * @brief Sets the articulation from a sample of the unit square, see Sampler.
+     * @param[in] sample Two values in [0,1), selecting the articulated object and its configuration.
+     *
+     * As setRandomArticulation(), the other articulated objects are set to the zero configuration.
+     */
+    void setArticulationFromSample(const float * const sample);
+
     /**
      * @brief Sets the camera height to a random value within the feasible range.
      * @param[in] seed Random seed.
      */
     void setRandomCameraHeight(unsigned int& seed);
 
+    /**
+     * @brief Sets the camera height from a sample in [0,1), mapped linearly to the feasible range.
+     * @param[in] sample Sample value.
+     */
+    void setCameraHeightFromSample(const float sample);
+
     /**
      * @brief Sets the camera pose to a random pose with the camera facing a random point from targetPoints.
      * @param[in] seed Random seed.
@@ -126,6 +157,13 @@ public:
      */
     void setRandomCameraPosition(unsigned int& seed, const std::vector<glm::vec3> * const targetPoints);
 
+    /**
+     * @brief Sets the camera pose from a sample of the unit cube, see Sampler.
+     * @param[in] sample Three values in [0,1) for the x and y position and the target point.
+     * @param[in] targetPoints A list of 3D points in world coordinates
+     */
+    void setCameraPositionFromSample(const float * const sample, const std::vector<glm::vec3> * const targetPoints);
+
     /**
      * @brief Sets the camera height.
      * @param[in] value The new camera height above the ground.
@@ -202,6 +240,7 @@ public:
 
     /**
      * @brief Load the cost coefficients and feasible ranges from the configuration file.
+     * @param[in] numArticulation Number of articulated objects in the scene, see Scene::countChannels().
      *
      * The following parameters are used:
      * | Parameter              | Description | Comment                                |
@@ -213,15 +252,16 @@ public:
      * | maxCameraHeight        | Maximum feasible camera height above ground | |
      * | gainFactor             | Coefficient for weighting the information gain relative to the costs | |
      */
-    static void loadCosts();
+    static void loadCosts(const size_t numArticulation);
 
-    static size_t numArticulation;   ///< The maximum number of articulated objects, hard-coded to 20
+    static size_t numArticulation;   ///< The number of articulated objects in the scene, see loadCosts()
 
 protected:
     glm::mat4x4 cameraLocalTransform;          ///< Camera pose as homogeneous transformation matrix in world coordinates
     glm::vec3 cameraPosition;                  ///< Camera position in world coordinates
     float *articulation;                       ///< Array current of articulation positions
     GLuint count;                              ///< Total number of observed pixels so far
+    bool ownsArticulation;                     ///< True if articulation has been allocated by this instance
 
     /**
      * @brief Linear cost function for manipulating an articulated scene object.
@@ -248,7 +288,15 @@ protected:
 
     friend class RandomSearchTask;
     friend class HillclimbingTask;
+    friend class CmaEsTask;
+    friend class BeamSearchTask;
+    friend class CandidateBatch;
 
+private:
+    /**
+     * @brief Not implemented, use set() to copy configurations.
+     */
+    RobotSceneConfiguration& operator=(const RobotSceneConfiguration& other);
 };
 
 } /* namespace gpu_coverage */
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#ifndef INCLUDE_ARTICULATION_ROBOTSCENECONFIGURATIONPOOL_H_
+#define INCLUDE_ARTICULATION_ROBOTSCENECONFIGURATIONPOOL_H_
+
+#include <gpu_coverage/RobotSceneConfiguration.h>
+#include <vector>
+
+namespace gpu_coverage {
+
+/**
+ * @brief Fixed-capacity arena of RobotSceneConfiguration candidates with reusable slots.
+ *
+ * All slots and their articulation values are allocated once in the constructor.
+ * The articulation values of all slots are stored in one contiguous array,
+ * slot i using the values [i * numArticulation, (i + 1) * numArticulation).
+ * Search loops acquire() slots for their candidates and call releaseAll()
+ * at the end of an iteration instead of deleting the candidates.
+ */
+class RobotSceneConfigurationPool {
+public:
+    /**
+     * @brief Constructor.
+     * @param[in] capacity Maximum number of slots in use at the same time.
+     *
+     * RobotSceneConfiguration::loadCosts() must have been called before.
+     */
+    explicit RobotSceneConfigurationPool(const size_t capacity);
+
+    /**
+     * @brief Destructor.
+     */
+    virtual ~RobotSceneConfigurationPool();
+
+    /**
+     * @brief Returns an unused slot reset to the zero configuration.
+     * @return The slot, or NULL if all slots are in use.
+     *
+     * The slot stays valid until releaseAll() is called.
+     */
+    RobotSceneConfiguration * acquire();
+
+    /**
+     * @brief Marks all slots as unused.
+     */
+    inline void releaseAll() {
+        used = 0;
+    }
+
+    /**
+     * @brief Returns the number of slots in use.
+     * @return Number of slots in use.
+     */
+    inline size_t size() const {
+        return used;
+    }
+
+    /**
+     * @brief Returns the maximum number of slots in use at the same time.
+     * @return Capacity of this pool.
+     */
+    inline size_t capacity() const {
+        return slots.size();
+    }
+
+protected:
+    std::vector<float> articulations;                 ///< Articulation values of all slots.
+    std::vector<RobotSceneConfiguration *> slots;     ///< Preallocated configurations.
+    size_t used;                                      ///< Number of slots in use.
+
+private:
+    /**
+     * @brief Not implemented, slots point into articulations.
+     */
+    RobotSceneConfigurationPool(const RobotSceneConfigurationPool& other);
+    /**
+     * @brief Not implemented, slots point into articulations.
+     */
+    RobotSceneConfigurationPool& operator=(const RobotSceneConfigurationPool& other);
+};
+
+} /* namespace gpu_coverage */
+
+#endif /* INCLUDE_ARTICULATION_ROBOTSCENECONFIGURATIONPOOL_H_ */
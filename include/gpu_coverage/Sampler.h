@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#ifndef INCLUDE_ARTICULATION_SAMPLER_H_
+#define INCLUDE_ARTICULATION_SAMPLER_H_
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+namespace gpu_coverage {
+
+/**
+ * @brief Generates sample points in the unit hypercube [0,1)^d.
+ *
+ * Samples are generated in bulk into a contiguous array with one row of
+ * getDimensions() values per sample. Subclasses implement plain uniform
+ * random sampling and space-filling designs (Halton and Sobol sequences,
+ * Latin hypercube sampling), see create().
+ */
+class Sampler {
+public:
+    /**
+     * @brief Constructor.
+     * @param[in] dimensions Number of dimensions of each sample.
+     */
+    explicit Sampler(const size_t dimensions);
+    /**
+     * @brief Destructor.
+     */
+    virtual ~Sampler();
+
+    /**
+     * @brief Generates samples.
+     * @param[in] numSamples Number of samples to generate.
+     * @param[out] samples Receives numSamples * getDimensions() values in [0,1), sample after sample.
+     *
+     * Successive calls continue the sequence, i.e. the samples of several
+     * calls together are as well distributed as the samples of a single call.
+     * The Latin hypercube sampler is the exception, it stratifies each call
+     * separately.
+     */
+    virtual void generate(const size_t numSamples, std::vector<float>& samples) = 0;
+
+    /**
+     * @brief Returns the number of dimensions of each sample.
+     * @return Number of dimensions.
+     */
+    inline size_t getDimensions() const {
+        return dimensions;
+    }
+
+    /**
+     * @brief Creates a sampler by name.
+     * @param[in] type One of "random", "halton", "sobol" or "lhs".
+     * @param[in] dimensions Number of dimensions of each sample.
+     * @param[in] seed Random seed. Halton and Sobol sequences are randomly shifted
+     *                 by this seed, so that workers with different seeds do not
+     *                 generate the same points.
+     * @return New sampler, to be deleted by the caller, or NULL if the type is unknown.
+     */
+    static Sampler * create(const std::string& type, const size_t dimensions, unsigned int seed);
+
+protected:
+    const size_t dimensions;   ///< Number of dimensions of each sample
+};
+
+/**
+ * @brief Independent uniform random samples, as drawn by rand_r().
+ */
+class UniformSampler : public Sampler {
+public:
+    UniformSampler(const size_t dimensions, const unsigned int seed);
+    virtual void generate(const size_t numSamples, std::vector<float>& samples);
+protected:
+    unsigned int seed;         ///< Random seed for rand_r()
+};
+
+/**
+ * @brief Halton sequence with the first prime numbers as bases and a random Cranley-Patterson rotation.
+ */
+class HaltonSampler : public Sampler {
+public:
+    HaltonSampler(const size_t dimensions, unsigned int seed);
+    virtual void generate(const size_t numSamples, std::vector<float>& samples);
+protected:
+    uint32_t index;              ///< Index of the next sample in the sequence
+    std::vector<uint32_t> bases; ///< Prime base of each dimension
+    std::vector<float> shift;    ///< Random offset of each dimension
+};
+
+/**
+ * @brief Sobol sequence in Gray code order with a random digital shift.
+ *
+ * Uses the direction numbers of Joe and Kuo, supports up to maxDimensions dimensions.
+ */
+class SobolSampler : public Sampler {
+public:
+    SobolSampler(const size_t dimensions, unsigned int seed);
+    virtual void generate(const size_t numSamples, std::vector<float>& samples);
+
+    static const size_t maxDimensions = 16;  ///< Number of dimensions with direction numbers
+protected:
+    static const size_t numBits = 32;        ///< Number of bits of each coordinate
+    uint32_t index;                          ///< Index of the next sample in the sequence
+    std::vector<uint32_t> directions;        ///< numBits direction numbers per dimension
+    std::vector<uint32_t> state;             ///< Current point of the sequence, digitally shifted
+};
+
+/**
+ * @brief Latin hypercube sampling, each call to generate() is one stratified design.
+ */
+class LatinHypercubeSampler : public Sampler {
+public:
+    LatinHypercubeSampler(const size_t dimensions, const unsigned int seed);
+    virtual void generate(const size_t numSamples, std::vector<float>& samples);
+protected:
+    unsigned int seed;            ///< Random seed for rand_r()
+    std::vector<size_t> strata;   ///< Permutation of the strata, reused across calls
+};
+
+} /* namespace gpu_coverage */
+
+#endif /* INCLUDE_ARTICULATION_SAMPLER_H_ */
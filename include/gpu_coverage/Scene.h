@@ -164,6 +164,15 @@ public:
         return channels;
     }
 
+    /**
+     * @brief Returns the number of animation channels a Scene created from an Assimp scene will have.
+     * @param[in] aiScene Assimp scene structure.
+     * @return Number of animation channels, equals getChannels().size() of the Scene.
+     *
+     * Allows sizing data structures per articulated object before the Scene is created by the worker threads.
+     */
+    static size_t countChannels(const aiScene * const aiScene);
+
     /**
      * @brief Get the root node of the scene graph.
      * @return Root node.
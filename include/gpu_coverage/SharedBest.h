@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#ifndef INCLUDE_ARTICULATION_SHAREDBEST_H_
+#define INCLUDE_ARTICULATION_SHAREDBEST_H_
+
+#include <gpu_coverage/RobotSceneConfiguration.h>
+#include <stdint.h>
+
+namespace gpu_coverage {
+
+/**
+ * @brief Lock-free reduction of the best candidate of parallel workers.
+ *
+ * The structure is placed in memory shared between the worker threads or
+ * processes, see getSize() and create(). Each worker owns one result slot
+ * protected by a sequence counter. publish() writes the candidate into the
+ * worker's slot and then updates a single 64 bit word that packs the
+ * evaluation and the candidate index with compare-and-swap, so publishing
+ * neither takes the mutex nor waits for other workers.
+ *
+ * The evaluation is stored in the upper 32 bits in an order-preserving
+ * encoding. The lower 32 bits contain the inverted candidate index and
+ * worker number, so that on equal evaluation the candidate with the lower
+ * index (and then the lower worker number) wins.
+ */
+class SharedBest {
+public:
+    static const size_t maxWorkers = 256;          ///< Worker numbers are packed into 8 bits of the key
+    static const size_t maxIndex = 1u << 24;       ///< Candidate indices are packed into 24 bits of the key
+
+    /**
+     * @brief Returns the number of bytes needed for the reduction.
+     * @param[in] numWorkers Number of workers publishing results.
+     * @return Size in bytes including the result slots.
+     *
+     * RobotSceneConfiguration::loadCosts() must have been called before.
+     */
+    static size_t getSize(const size_t numWorkers);
+
+    /**
+     * @brief Initializes the reduction in the given memory.
+     * @param[in] memory Memory of getSize() bytes shared between the workers, aligned to 8 bytes.
+     * @param[in] numWorkers Number of workers publishing results, at most maxWorkers.
+     * @return The reduction, located at the start of memory, or NULL if there are too many workers.
+     *
+     * Must be called before the workers are forked.
+     */
+    static SharedBest * create(void * const memory, const size_t numWorkers);
+
+    /**
+     * @brief Publishes the best candidate of a worker.
+     * @param[in] worker Worker number, less than the number of workers.
+     * @param[in] configuration The candidate configuration.
+     * @param[in] eval Evaluation of the candidate.
+     * @param[in] index Index of the candidate for breaking ties, less than maxIndex.
+     * @return True if the candidate is the best candidate published so far,
+     *         false if it is not or if worker or index are out of range.
+     */
+    bool publish(const size_t worker, const RobotSceneConfiguration& configuration, const float eval,
+            const size_t index);
+
+    /**
+     * @brief Copies the best published candidate.
+     * @param[out] configuration Receives the best configuration.
+     * @param[out] eval Receives the evaluation of the best configuration.
+     * @return False if no candidate has been published since the last reset().
+     *
+     * May be called while other workers are still publishing. In this case,
+     * the result is the best candidate at some point during the call.
+     */
+    bool getBest(RobotSceneConfiguration& configuration, float& eval) const;
+
+    /**
+     * @brief Removes all published candidates.
+     *
+     * Must only be called while no worker is publishing, e.g. between two barriers.
+     */
+    void reset();
+
+protected:
+    /**
+     * @brief Result slot of one worker.
+     */
+    struct Slot {
+        volatile uint32_t sequence;                ///< Odd while the slot is being written
+        volatile uint64_t key;                     ///< Packed key of the candidate in this slot
+        RobotSceneConfiguration configuration;     ///< Candidate configuration, articulation values stored behind the slots
+    };
+
+    volatile uint64_t best;                        ///< Packed key of the best candidate, 0 if none
+    size_t numWorkers;                             ///< Number of result slots
+
+    static uint64_t packKey(const float eval, const size_t index, const size_t worker);
+    static float unpackEval(const uint64_t key);
+
+    inline Slot * getSlots() {
+        return reinterpret_cast<Slot *>(this + 1);
+    }
+    inline const Slot * getSlots() const {
+        return reinterpret_cast<const Slot *>(this + 1);
+    }
+};
+
+} /* namespace gpu_coverage */
+
+#endif /* INCLUDE_ARTICULATION_SHAREDBEST_H_ */
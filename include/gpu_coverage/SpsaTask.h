@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#ifndef INCLUDE_ARTICULATION_SPSATASK_H_
+#define INCLUDE_ARTICULATION_SPSATASK_H_
+
+#include <gpu_coverage/CmaEsTask.h>
+#include <cstdlib>
+#include <vector>
+
+namespace gpu_coverage {
+
+/**
+ * @brief Next-best-view search with sign simultaneous perturbation stochastic approximation (sign-SPSA).
+ *
+ * Uses the same candidate vectors and iterations as CmaEsTask, with the articulation values as
+ * continuous frame positions (see Channel::setFramePosition()). Every worker runs spsaStarts
+ * gradient ascents from random starting points. In every step, each ascent perturbs all entries of
+ * its vector at once by +c or -c and renders the two perturbed vectors, so the gradient estimate
+ * needs two renders regardless of the number of articulated objects. The perturbed vectors of all
+ * ascents of a worker are rendered as one batch.
+ *
+ * The gain sequences follow J. C. Spall, "Implementation of the Simultaneous Perturbation Algorithm
+ * for Stochastic Optimization", 1998: a_k = a / (k + 1 + A)^0.602 and c_k = c / (k + 1)^0.101 with
+ * A = 10% of the steps. Unlike standard SPSA, which steps by a_k times the gradient estimate, the
+ * ascent uses only the sign of each gradient entry. With perturbations of +-c, all entries of the
+ * estimate have the same magnitude, so every entry moves by exactly a_k in the normalized search
+ * space. The step size thus does not depend on the scale of the evaluation, which varies with the
+ * scene and the cost weights, and a needs no tuning per scene.
+ *
+ * The following parameters are used:
+ * | Parameter        | Description |
+ * | ---------------- | ----------- |
+ * | spsaPerturbation | Initial perturbation c in the normalized search space |
+ * | spsaStarts       | Number of gradient ascents per worker, rendered as one batch |
+ * | spsaStepSize     | Initial step size a in the normalized search space |
+ * | spsaSteps        | Number of gradient steps per iteration |
+ */
+class SpsaTask: public CmaEsTask {
+public:
+    SpsaTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData, const size_t numIterations);
+    virtual ~SpsaTask();
+
+protected:
+    const size_t numStarts, numSteps;
+    const double stepSize, perturbation;
+
+    virtual size_t search(RobotSceneConfiguration& bestConfiguration, float& bestEval);
+
+    /**
+     * @brief Wraps the yaw entry of a candidate vector and clamps the other entries to [0, 1].
+     */
+    void clampVector(std::vector<double>& x) const;
+
+    /**
+     * @brief Returns a uniformly random value in [0, 1).
+     */
+    inline double uniform() {
+        return rand_r(&seed) / (static_cast<double>(RAND_MAX) + 1.);
+    }
+};
+
+} /* namespace gpu_coverage */
+
+#endif /* INCLUDE_ARTICULATION_SPSATASK_H_ */
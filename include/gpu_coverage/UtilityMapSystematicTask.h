@@ -44,11 +44,11 @@ class CostMapRenderer;
 class BellmanFordXfbRenderer;
 class BellmanFordRenderer;
 class Renderer;
+class ReverseVisibilityRenderer;
 
 class UtilityMapSystematicTask : public AbstractTask {
 public:
-    UtilityMapSystematicTask(Scene * const scene, const size_t threadNr,
-            SharedData * const sharedData, const size_t& startFrame, const size_t& endFrame);
+    UtilityMapSystematicTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData);
     virtual ~UtilityMapSystematicTask();
     virtual void run();
 
@@ -58,13 +58,64 @@ protected:
     BellmanFordXfbRenderer * bellmanFordRenderer;
     VisibilityRenderer * visibilityRenderer;
     Renderer * renderer;
+    ReverseVisibilityRenderer * reverseVisibilityRenderer;  ///< Renders the whole map from the targets, NULL if disabled
     Node * cameraNode;
 
-    const size_t startFrame;
-    const size_t endFrame;
-
     cv::VideoWriter *outputVideo;
     const bool debug;
+    std::string framesFile;     ///< Log of finished frames for resuming, empty if disabled
+
+    const bool adaptive;            ///< Refine the utility map adaptively instead of rendering every cell
+    const int baseStep;             ///< Spacing of the coarse grid in cells
+    const GLint gainThreshold;      ///< Refine if the gain utilities of the corners differ by more than this
+    const GLint valueThreshold;     ///< Refine if the utility at a corner exceeds this
+    const size_t numErrorSamples;   ///< Interpolated cells rendered per frame for the error estimate
+
+    /**
+     * @brief Cell of the adaptive quadtree, spanning the inclusive cell range [x0, x1] x [y0, y1].
+     */
+    struct Quad {
+        int x0, y0, x1, y1;
+        Quad(const int x0, const int y0, const int x1, const int y1) : x0(x0), y0(y0), x1(x1), y1(y1) {}
+    };
+
+    /**
+     * @brief Places the robot camera above the given utility map cell and renders its visibility.
+     * @param[in] x Column of the cell.
+     * @param[in] y Row of the cell.
+     * @param[in] origin World position of cell (0, 0), the z coordinate is the camera height.
+     * @param[in] cellSize Size of a cell in world coordinates.
+     */
+    void renderCell(const int x, const int y, const glm::vec3& origin, const glm::vec2& cellSize);
+
+    /**
+     * @brief Renders the given cells and stores their pixel counts.
+     * @param[in,out] cells Indices of the cells to render, cleared afterwards.
+     * @param[in] origin World position of cell (0, 0), the z coordinate is the camera height.
+     * @param[in] cellSize Size of a cell in world coordinates.
+     * @param[out] gains Pixel counts of all cells, the entries of the rendered cells are set.
+     * @return False if the number of pixel counts does not match.
+     */
+    bool renderCells(std::vector<int>& cells, const glm::vec3& origin, const glm::vec2& cellSize,
+            std::vector<GLuint>& gains);
+
+    /**
+     * @brief Computes the pixel counts of all cells by refining a coarse grid where needed.
+     * @param[in] frame Current frame, used for seeding the error estimate.
+     * @param[in] costmap Costs of all cells.
+     * @param[in] origin World position of cell (0, 0), the z coordinate is the camera height.
+     * @param[in] cellSize Size of a cell in world coordinates.
+     * @param[out] gains Rendered or interpolated pixel counts of all cells.
+     * @return False if rendering failed.
+     *
+     * A quad is split in four if the gain utilities at its corners differ by more than gainThreshold,
+     * if the utility at one of its corners exceeds valueThreshold, or if only some of its corners are
+     * blocked. Otherwise the pixel counts of its inner cells are interpolated bilinearly from its
+     * corners. Afterwards, up to numErrorSamples interpolated free cells are rendered to estimate
+     * the interpolation error, which is logged together with the number of rendered cells.
+     */
+    bool sampleAdaptive(const size_t frame, const GLuint * const costmap, const glm::vec3& origin,
+            const glm::vec2& cellSize, std::vector<GLuint>& gains);
 };
 
 } /* namespace gpu_coverage */
@@ -44,17 +44,13 @@ namespace gpu_coverage {
 
 class VideoTask: public AbstractTask {
 public:
-    VideoTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData, const size_t startFrame,
-            const size_t endFrame);
+    VideoTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData);
     virtual ~VideoTask();
 
     virtual void run();
 
 protected:
     Scene * const scene;
-    const size_t startFrame;
-    const size_t endFrame;
-    const size_t captureFrame;
     const bool writeVideo;
 
     typedef std::vector<AbstractRenderer*> Renderers;
@@ -66,6 +62,9 @@ protected:
     cv::VideoWriter *outputVideo, *outputCubemapVideo;
     GLuint panoTexture;
 
+    bool openVideos(const size_t firstFrame);
+    void closeVideos();
+
 };
 
 } /* namespace gpu_coverage */
@@ -89,6 +89,19 @@ public:
      */
     void getPixelCounts(std::vector<GLuint>& counts);
 
+    /**
+     * @brief Appends the pixel counts that are already available on the CPU.
+     * @param[in,out] counts Vector to which the available pixel counts are appended.
+     * @return Number of pixel counts appended to counts.
+     * @exception std::invalid_argument Pixel counting has been disabled in the constructor.
+     *
+     * Unlike getPixelCounts(), this method does not flush the pipeline. It only
+     * returns the counts of frames that have already left the PBO ring buffer,
+     * in the order in which the frames were rendered. The counts of the frames
+     * still in flight are returned by the next call to getPixelCounts().
+     */
+    size_t takePixelCounts(std::vector<GLuint>& counts);
+
     /**
      * @brief Returns the OpenGL texture ID of the result texture.
      * @return OpenGL texture ID.
@@ -158,6 +171,7 @@ protected:
     const GLuint numPbo;                                      ///< Number of allocated pixel buffer objects
     GLuint curPbo;                                            ///< Current pixel buffer object
     GLuint run;                                               ///< Ring buffer index
+    GLuint numTaken;                                          ///< Number of pixel counts returned by takePixelCounts() since the last call to getPixelCounts()
     GLuint vaoPoint;                                          ///< Vertex array object for rendering single output pixel
     GLuint vboPoint;                                          ///< Vertex buffer object for rendering single output pixel
     void readBack();                                          ///< Read back ring bufer
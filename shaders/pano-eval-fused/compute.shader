@@ -0,0 +1,121 @@
+/**
+ * @brief Compute shader for pano-eval-fused.
+ * @author Stefan Osswald
+ * @date 2018
+ * @namespace articulation::shader::pano_eval_fused
+ * @class ComputeShader
+ *
+ * Fused version of the equirectangular, tl-edge, tl-step and pano-eval passes.
+ * Every work group handles one row of the panorama: it samples the opposite row
+ * from the semantic cube map, computes the converged run lengths of tl-step by a
+ * segmented scan in shared memory, and writes the gains of its own row to the
+ * gain map. No panorama or integral image is written to texture memory.
+ */
+
+#version 440
+// EXTENSION compute_shader
+// EXTENSION shader_image_load_store
+// EXTENSION shading_language_420pack
+
+#define PI      3.14159265358979323846
+#define MAX_WIDTH 2048
+#define NUM_THREADS 256
+
+layout(local_size_x = NUM_THREADS) in;
+
+uniform samplerCube cube_unit;
+uniform layout(binding=7, r32i) coherent iimage2D utility_map;
+uniform int width;
+uniform int height;
+uniform int clockwise;
+
+shared int edges[MAX_WIDTH];
+shared int runs[MAX_WIDTH];
+shared int carry[NUM_THREADS];
+
+vec4 panoColor(const int x, const int y) {
+    // Same projection as the equirectangular shader, quantized like the RGBA8 panorama texture
+    vec2 latLon = vec2((float(x) + 0.5) / float(width) * 2. * PI, (float(y) + 0.5) / float(height) * PI);
+    vec2 c = cos(latLon), s = sin(latLon);
+    return round(texture(cube_unit, vec3(-s.y * s.x, c.y, -c.x * s.y)) * 255.) / 255.;
+}
+
+int isReachable(const vec4 color) {
+    return int(step(color.a, 0.6f))   // MSB of alpha is 0 for costmap and 1 for target texture
+         * (1 - int(step(dot(step(color, vec4(0.)), vec4(1.)), 0.5)));    // any component > 0 --> not obstacle
+}
+
+ivec2 colorToCoordinate(const vec4 color) {
+    // Unpack format defined in IndexImage
+    ivec4 i = ivec4(color * 255.f + 0.5f);
+    return ivec2(i.x << 8 | i.y, i.a << 8 | i.z);
+}
+
+void main() {
+    int y = int(gl_WorkGroupID.y);
+    int oppositeY = height - 1 - y;
+    int t = int(gl_LocalInvocationIndex);
+    int dir = clockwise != 0 ? 1 : -1;
+
+    // Target mask of the opposite row
+    for (int x = t; x < width; x += NUM_THREADS) {
+        float red = panoColor(x, oppositeY).r;
+        edges[x] = int(step(0.5f, red));
+        runs[x] = int(step(red, 0.01f));
+    }
+    barrier();
+
+    // Horizontal edge value as in tl-edge, stored in propagation order k
+    int e[MAX_WIDTH / NUM_THREADS];
+    int chunk = (width + NUM_THREADS - 1) / NUM_THREADS;
+    for (int i = 0; i < chunk; ++i) {
+        int k = t * chunk + i;
+        if (k < width) {
+            int x = clockwise != 0 ? k : width - 1 - k;
+            int left = (x - 3 * dir + width) % width;
+            e[i] = (runs[left] * 2 - 1) * edges[x];
+        }
+    }
+
+    // Run length at the end of each chunk if it contains a run start,
+    // otherwise the negative number of run texels in the chunk
+    int r = 0;
+    int count = 0;
+    for (int i = 0; i < chunk && t * chunk + i < width; ++i) {
+        r = e[i] == 1 ? 1 : (r >= 1 ? r - e[i] : 0);
+        count -= int(e[i] == -1);
+    }
+    carry[t] = r >= 1 ? r : count;
+    barrier();
+    if (t == 0) {
+        // Run length entering each chunk
+        int c = 0;
+        for (int i = 0; i < NUM_THREADS; ++i) {
+            int end = carry[i];
+            carry[i] = c;
+            c = end >= 1 ? end : (c >= 1 ? c - end : 0);
+        }
+    }
+    barrier();
+    r = carry[t];
+    for (int i = 0; i < chunk; ++i) {
+        int k = t * chunk + i;
+        if (k < width) {
+            r = e[i] == 1 ? 1 : (r >= 1 ? r - e[i] : 0);
+            runs[clockwise != 0 ? k : width - 1 - k] = r >= 1 ? r : e[i];
+        }
+    }
+    barrier();
+
+    // Gains of own row as in pano-eval
+    for (int x = t; x < width; x += NUM_THREADS) {
+        vec4 my_color = panoColor(x, y);
+        float u = (float(x) + 0.5) / float(width);
+        int oppositeX = clamp(int(floor((u + 0.5 * (step(u, 0.5) * 2. - 1.)) * float(width))), 0, width - 1);
+        int gain = runs[oppositeX] * isReachable(my_color);
+        ivec2 center = colorToCoordinate(my_color);
+        if (center.x >= 0 && center.x < 256 && center.y >= 0 && center.y < 256) {
+            imageAtomicMax(utility_map, center, gain);
+        }
+    }
+}
@@ -0,0 +1,71 @@
+/**
+ * @brief Compute shader for pano-visibility-gain.
+ * @author Stefan Osswald
+ * @date 2018
+ * @namespace articulation::shader::pano_visibility_gain
+ * @class ComputeShader
+ *
+ * Counts for every candidate view the target texels observed in the
+ * panorama whose surface point lies inside the view frustum. Texels that
+ * are already covered in the target texture are skipped with the same test
+ * as in the pixel-counter shader, so the counts are newly observed texels.
+ */
+
+#version 440
+// EXTENSION compute_shader
+// EXTENSION shader_storage_buffer_object
+// EXTENSION shader_image_load_store
+// EXTENSION shading_language_420pack
+
+layout(local_size_x = 16, local_size_y = 16) in;
+
+uniform layout(binding=7, rgba32f) readonly image2D position_map;
+uniform sampler2D coverage_unit;
+
+layout(std430, binding = 3) readonly buffer Views {
+    mat4 view_projection[];
+};
+
+layout(std430, binding = 4) buffer Gains {
+    uint gains[];
+};
+
+uniform int num_views;
+
+const int MAX_VIEWS = 256;
+const int GROUP_SIZE = 256;
+
+shared uint counts[MAX_VIEWS];
+
+void main() {
+    int local = int(gl_LocalInvocationIndex);
+    for (int v = local; v < num_views; v += GROUP_SIZE) {
+        counts[v] = 0u;
+    }
+    memoryBarrierShared();
+    barrier();
+
+    ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(position_map);
+    if (pos.x < size.x && pos.y < size.y) {
+        vec4 p = imageLoad(position_map, pos);
+        // is green in the coverage so far?
+        bool covered = texture(coverage_unit, (vec2(pos) + 0.5) / vec2(size)).y > 0.5;
+        if (p.w > 0.5 && !covered) {
+            for (int v = 0; v < num_views; ++v) {
+                vec4 clip = view_projection[v] * vec4(p.xyz, 1.);
+                if (all(lessThanEqual(abs(clip.xyz), vec3(clip.w)))) {
+                    atomicAdd(counts[v], 1u);
+                }
+            }
+        }
+    }
+    memoryBarrierShared();
+    barrier();
+
+    for (int v = local; v < num_views; v += GROUP_SIZE) {
+        if (counts[v] > 0u) {
+            atomicAdd(gains[v], counts[v]);
+        }
+    }
+}
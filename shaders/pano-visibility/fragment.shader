@@ -0,0 +1,34 @@
+/**
+ * @brief Fragment shader for pano-visibility.
+ * @author Stefan Osswald
+ * @date 2018
+ * @namespace articulation::shader::pano_visibility
+ * @class FragmentShader
+ *
+ * Same marking as the visibility shader, but instead of a color the world
+ * position of the observed surface is stored for every target texel.
+ */
+
+#version 440
+// EXTENSION shading_language_420pack
+// EXTENSION shader_image_load_store
+
+layout(early_fragment_tests) in;
+uniform layout(binding=7, rgba32f) writeonly image2D position_map;
+uniform float resolution;
+
+in vec2 tex_coord;
+in vec3 world_position;
+out vec4 frag_color;
+
+void main() {
+  if (gl_FrontFacing) {
+    ivec2 center = ivec2(tex_coord.xy * resolution);
+    for (int x = center.x - 3; x <= center.x + 3; ++x) {
+      for (int y = center.y - 3; y <= center.y + 3; ++y) {
+        imageStore(position_map, ivec2(x, y), vec4(world_position, 1.));
+      }
+    }
+  }
+  frag_color = vec4(0.f, 0.f, 0.f, 1.f);
+}
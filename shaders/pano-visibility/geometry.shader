@@ -0,0 +1,34 @@
+/**
+ * @brief Geometry shader for pano-visibility.
+ * @author Stefan Osswald
+ * @date 2018
+ * @namespace articulation::shader::pano_visibility
+ * @class GeometryShader
+ */
+
+#version 440
+
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 18) out;
+
+uniform mat4 model_matrix;
+uniform mat4 view_matrix[6];
+uniform mat4 projection_matrix;
+
+in vec2 vertex_texcoord[];
+out vec2 tex_coord;
+out vec3 world_position;
+
+void main() {
+    for (int layer = 0; layer < 6; ++layer) {
+        for (int i = 0; i < gl_in.length(); ++i) {
+            gl_Layer = layer;
+            vec4 world = model_matrix * gl_in[i].gl_Position;
+            gl_Position = projection_matrix * view_matrix[layer] * world;
+            tex_coord = vertex_texcoord[i];
+            world_position = world.xyz / world.w;
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
+}
@@ -0,0 +1,15 @@
+/**
+ * @brief Fragment shader for reverse-depth.
+ * @author Stefan Osswald
+ * @date 2018
+ * @namespace articulation::shader::reverse_depth
+ * @class FragmentShader
+ *
+ * Only the depth buffer is written.
+ */
+
+#version 440
+// EXTENSION shading_language_420pack
+
+void main() {
+}
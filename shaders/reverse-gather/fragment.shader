@@ -0,0 +1,78 @@
+/**
+ * @brief Fragment shader for reverse-gather.
+ * @author Stefan Osswald
+ * @date 2018
+ * @namespace articulation::shader::reverse_gather
+ * @class FragmentShader
+ *
+ * Tests for every cell of the floor grid whether a camera above the cell
+ * sees the current target patch and adds the texels of the patch to the
+ * cell by additive blending. The depth map rendered from the patch
+ * resolves occlusions like a shadow map.
+ */
+
+#version 440
+// EXTENSION shading_language_420pack
+
+uniform sampler2D depth_unit;
+uniform mat4 patch_view_projection;
+uniform vec3 patch_position;
+uniform vec3 patch_normal;
+uniform float clip_near;
+uniform float clip_far;
+uniform float bias;
+uniform float weight;
+uniform vec3 grid_origin;
+uniform vec2 cell_size;
+uniform int use_frustum;
+uniform vec3 look_at;
+uniform mat4 camera_projection;
+
+out float frag_gain;
+
+float linearDepth(const float depth) {
+    float z = depth * 2.f - 1.f;
+    return 2.f * clip_near * clip_far / (clip_far + clip_near - z * (clip_far - clip_near));
+}
+
+// Same as glm::lookAt
+mat4 lookAt(const vec3 eye, const vec3 center, const vec3 up) {
+    vec3 f = normalize(center - eye);
+    vec3 s = normalize(cross(f, up));
+    vec3 u = cross(s, f);
+    return mat4(vec4(s.x, u.x, -f.x, 0.f), vec4(s.y, u.y, -f.y, 0.f), vec4(s.z, u.z, -f.z, 0.f),
+            vec4(-dot(s, eye), -dot(u, eye), dot(f, eye), 1.f));
+}
+
+void main() {
+    vec3 eye = grid_origin + vec3(floor(gl_FragCoord.xy) * cell_size, 0.f);
+    if (dot(patch_normal, eye - patch_position) <= 0.f) {
+        discard;
+    }
+
+    // The camera above the cell must have the patch in its field of view
+    if (use_frustum != 0) {
+        vec3 look = normalize(eye - look_at);
+        vec3 right = cross(look, vec3(0.f, 0.f, -1.f));
+        vec3 up = cross(look, right);
+        vec4 clip = camera_projection * lookAt(eye, look_at, up) * vec4(patch_position, 1.f);
+        if (any(greaterThan(abs(clip.xyz), vec3(clip.w)))) {
+            discard;
+        }
+    }
+
+    // Occlusion test against the depth map of the patch
+    vec4 clip = patch_view_projection * vec4(eye, 1.f);
+    if (clip.w <= 0.f) {
+        discard;
+    }
+    vec3 ndc = clip.xyz / clip.w;
+    if (any(greaterThan(abs(ndc), vec3(1.f)))) {
+        discard;
+    }
+    float occluder = texture(depth_unit, ndc.xy * 0.5f + 0.5f).r;
+    if (linearDepth(ndc.z * 0.5f + 0.5f) > linearDepth(occluder) + bias) {
+        discard;
+    }
+    frag_gain = weight;
+}
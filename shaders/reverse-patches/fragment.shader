@@ -0,0 +1,25 @@
+/**
+ * @brief Fragment shader for reverse-patches.
+ * @author Stefan Osswald
+ * @date 2018
+ * @namespace articulation::shader::reverse_patches
+ * @class FragmentShader
+ *
+ * Writes world position and normal of the target surface at every
+ * covered texel of the patch atlas, w = 1 marks covered texels.
+ */
+
+#version 440
+// EXTENSION shading_language_420pack
+// EXTENSION explicit_attrib_location
+
+in vec3 world_position;
+in vec3 world_normal;
+
+layout(location = 0) out vec4 patch_position;
+layout(location = 1) out vec4 patch_normal;
+
+void main() {
+    patch_position = vec4(world_position, 1.f);
+    patch_normal = vec4(normalize(world_normal), 0.f);
+}
@@ -0,0 +1,29 @@
+/**
+ * @brief Vertex shader for reverse-patches.
+ * @author Stefan Osswald
+ * @date 2018
+ * @namespace articulation::shader::reverse_patches
+ * @class VertexShader
+ *
+ * Unwraps the target mesh into its texture space, so that every fragment
+ * of the patch atlas corresponds to a patch of the target texture.
+ */
+
+#version 440
+// EXTENSION shading_language_420pack
+// EXTENSION explicit_attrib_location
+
+uniform mat4 model_matrix;
+
+layout(location = 0) in vec3 vertex_position;
+layout(location = 2) in vec2 vertex_texcoord;
+layout(location = 3) in vec3 vertex_normal;
+
+out vec3 world_position;
+out vec3 world_normal;
+
+void main() {
+    gl_Position = vec4(vertex_texcoord * 2.f - 1.f, 0.f, 1.f);
+    world_position = vec3(model_matrix * vec4(vertex_position, 1.f));
+    world_normal = transpose(inverse(mat3(model_matrix))) * vertex_normal;
+}
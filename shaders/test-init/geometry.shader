@@ -13,7 +13,9 @@
 layout(points) in;
 layout(points, max_vertices=1) out;
 uniform layout(binding=5, r32i) writeonly iimage2D map;
+uniform layout(binding=7, r32i) writeonly iimage2D sources;
 uniform float resolution;
+uniform int source;
 //const float resolution = 256.;
 
 //in ivec2[] tex_coord;
@@ -22,6 +24,8 @@ out vec3 position;
 void main() {
 	ivec2 tex_coord[1] = ivec2[1](ivec2((gl_in[0].gl_Position.xy + 1.f) / 2.f * resolution));
 	imageStore(map, tex_coord[0], ivec4(0, 0, 0, 0));
+	// distance 0 in the high bits, index of the start position in the low bits
+	imageStore(sources, tex_coord[0], ivec4(source, 0, 0, 0));
 	position = gl_in[0].gl_Position.xyz;
 	gl_Position = gl_in[0].gl_Position;
 	EmitVertex();
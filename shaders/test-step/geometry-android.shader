@@ -15,11 +15,19 @@ layout(points, max_vertices=8) out;
 uniform layout(binding=4, r32i) readonly iimage2D costmap;
 uniform layout(binding=5, r32i) coherent iimage2D map;
 uniform layout(binding=6, r32i) coherent iimage2D queued;
+uniform layout(binding=7, r32i) coherent iimage2D sources;
 
 uniform float resolution;
 
 const int COST_FACTOR = 100;
 
+// A texel of sources holds the distance in the high bits and the index of the start position in the
+// low bits. Without image atomics an update may still be lost, but a start position is never stored
+// with the distance of another one.
+const int SOURCE_BITS = 8;
+const int SOURCE_MASK = (1 << SOURCE_BITS) - 1;
+const int MAX_SOURCE_COST = (1 << (31 - SOURCE_BITS)) - 1;
+
 out vec3 position;
 
 const ivec3 DELTA[8] = ivec3[8](
@@ -44,6 +52,10 @@ void main() {
     ivec2 tex_coord[1] = ivec2[1](ivec2((gl_in[0].gl_Position.xy + 1.f) / 2.f * resolution));
     imageStore(queued, tex_coord[0], ivec4(0, 0, 0, 0));
     int newCost = imageLoad(map, tex_coord[0]).r;
+    // Distance and start position from the same word, the distance in map may be newer
+    int packedSource = imageLoad(sources, tex_coord[0]).r;
+    int source = packedSource & SOURCE_MASK;
+    int sourceCost = packedSource >> SOURCE_BITS;
     for (int d = 0; d < 8; ++d) {
         ivec2 neighbor = tex_coord[0] + DELTA[d].xy;
         if (insideBox(neighbor)) {
@@ -51,10 +63,18 @@ void main() {
             if (cost < 100000) {
                 int neighborNewCost = newCost + DELTA[d].z + cost * COST_FACTOR;
                 int neighborOldCost = imageLoad(map, neighbor).r;
+                int neighborSource = (min(sourceCost + DELTA[d].z + cost * COST_FACTOR, MAX_SOURCE_COST) << SOURCE_BITS)
+                        | source;
+                int neighborOldSource = imageLoad(sources, neighbor).r;
                 
                 // neighbor changed -> queue            
-                if (neighborNewCost <= neighborOldCost) {
-                    imageStore(map, neighbor, ivec4(neighborNewCost, 0, 0, 0));
+                if (neighborNewCost <= neighborOldCost || neighborSource < neighborOldSource) {
+                    if (neighborNewCost <= neighborOldCost) {
+                        imageStore(map, neighbor, ivec4(neighborNewCost, 0, 0, 0));
+                    }
+                    if (neighborSource < neighborOldSource) {
+                        imageStore(sources, neighbor, ivec4(neighborSource, 0, 0, 0));
+                    }
                     int alreadyQueued = imageLoad(queued, neighbor).r;
                     if (alreadyQueued == 0) {
                         imageStore(queued, neighbor, ivec4(1, 0, 0, 0));
@@ -15,11 +15,18 @@ layout(points, max_vertices=8) out;
 uniform layout(binding=4, r32i) readonly iimage2D costmap;
 uniform layout(binding=5, r32i) coherent iimage2D map;
 uniform layout(binding=6, r32i) coherent iimage2D queued;
+uniform layout(binding=7, r32i) coherent iimage2D sources;
 
 uniform float resolution;
 
 const int COST_FACTOR = 40;
 
+// A texel of sources holds the distance in the high bits and the index of the start position in the
+// low bits, so that one atomic minimum keeps the index of the smallest distance.
+const int SOURCE_BITS = 8;
+const int SOURCE_MASK = (1 << SOURCE_BITS) - 1;
+const int MAX_SOURCE_COST = (1 << (31 - SOURCE_BITS)) - 1;
+
 in ivec2 tex_coord[];
 out vec3 position;
 
@@ -44,6 +51,10 @@ bool insideBox(ivec2 point) {
 void main() {
     imageStore(queued, tex_coord[0], ivec4(0, 0, 0, 0));
     int newCost = imageLoad(map, tex_coord[0]).r;
+    // Distance and start position from the same word, the distance in map may be newer
+    int packedSource = imageLoad(sources, tex_coord[0]).r;
+    int source = packedSource & SOURCE_MASK;
+    int sourceCost = packedSource >> SOURCE_BITS;
     for (int d = 0; d < 8; ++d) {
         ivec2 neighbor = tex_coord[0] + DELTA[d].xy;
         if (insideBox(neighbor)) {
@@ -51,10 +62,15 @@ void main() {
             if (cost < 1000000) {
                 int neighborNewCost = newCost + DELTA[d].z + cost * COST_FACTOR;
                 int neighborOldCost = imageAtomicMin(map, neighbor, neighborNewCost);
+                int neighborSource = (min(sourceCost + DELTA[d].z + cost * COST_FACTOR, MAX_SOURCE_COST) << SOURCE_BITS)
+                        | source;
+                int neighborOldSource = imageAtomicMin(sources, neighbor, neighborSource);
                 
                 // neighbor changed -> queue            
-                if (neighborNewCost < neighborOldCost) {
-                    imageStore(map, neighbor, ivec4(neighborNewCost, 0, 0, 0));
+                if (neighborNewCost < neighborOldCost || neighborSource < neighborOldSource) {
+                    if (neighborNewCost < neighborOldCost) {
+                        imageStore(map, neighbor, ivec4(neighborNewCost, 0, 0, 0));
+                    }
                     int alreadyQueued = imageAtomicCompSwap(queued, neighbor, 0, 1);
                     if (alreadyQueued == 0) {
                         position = vec3(gl_in[0].gl_Position.xy + vec2(DELTA[d].xy) * (2. / resolution), 0.);
@@ -0,0 +1,97 @@
+/**
+ * @brief Compute shader for utility-topk-merge.
+ * @author Stefan Osswald
+ * @date 2018
+ * @namespace articulation::shader::utility_topk_merge
+ * @class ComputeShader
+ *
+ * Second stage of the top-k selection on the utility map. A single work group
+ * selects the k best cells from the per-tile candidates written by
+ * utility-topk-tile, sorted by ascending utility.
+ */
+
+#version 440
+// EXTENSION compute_shader
+// EXTENSION shader_storage_buffer_object
+// EXTENSION shading_language_420pack
+
+layout(local_size_x = 128) in;
+
+struct Candidate {
+    int utility;
+    int x;
+    int y;
+    int valid;
+};
+
+layout(std430, binding = 3) buffer Candidates {
+    Candidate candidates[];
+};
+
+layout(std430, binding = 4) writeonly buffer Result {
+    Candidate result[];
+};
+
+uniform int k;
+uniform int num_candidates;
+uniform int min_spacing;
+
+const int NONE = 0x7fffffff;
+const uint GROUP_SIZE = 128u;
+
+shared int values[GROUP_SIZE];
+shared int indices[GROUP_SIZE];
+shared Candidate winner;
+
+void main() {
+    int local = int(gl_LocalInvocationIndex);
+
+    for (int i = 0; i < k; ++i) {
+        // Every invocation scans its own strided subset of the candidates
+        int best = NONE;
+        int bestIndex = -1;
+        for (int c = local; c < num_candidates; c += int(GROUP_SIZE)) {
+            if (candidates[c].valid != 0 && candidates[c].utility < best) {
+                best = candidates[c].utility;
+                bestIndex = c;
+            }
+        }
+        values[local] = best;
+        indices[local] = bestIndex;
+        memoryBarrierShared();
+        barrier();
+
+        // Parallel reduction to the best candidate
+        for (uint s = GROUP_SIZE / 2u; s > 0u; s >>= 1) {
+            if (uint(local) < s) {
+                int v = values[local + s];
+                int idx = indices[local + s];
+                if (v < values[local] || (v == values[local] && idx < indices[local])) {
+                    values[local] = v;
+                    indices[local] = idx;
+                }
+            }
+            memoryBarrierShared();
+            barrier();
+        }
+
+        if (local == 0) {
+            winner = indices[0] >= 0 ? candidates[indices[0]] : Candidate(NONE, 0, 0, 0);
+            result[i] = winner;
+        }
+        memoryBarrierShared();
+        barrier();
+
+        // Suppress the selected cell and its neighborhood
+        if (winner.valid != 0) {
+            for (int c = local; c < num_candidates; c += int(GROUP_SIZE)) {
+                ivec2 d = ivec2(candidates[c].x, candidates[c].y) - ivec2(winner.x, winner.y);
+                if (d == ivec2(0) || d.x * d.x + d.y * d.y < min_spacing * min_spacing) {
+                    candidates[c].valid = 0;
+                }
+            }
+        }
+        memoryBarrierBuffer();
+        barrier();
+    }
+}
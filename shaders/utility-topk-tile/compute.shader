@@ -0,0 +1,89 @@
+/**
+ * @brief Compute shader for utility-topk-tile.
+ * @author Stefan Osswald
+ * @date 2018
+ * @namespace articulation::shader::utility_topk_tile
+ * @class ComputeShader
+ *
+ * First stage of the top-k selection on the utility map. Every work group
+ * selects the k lowest utility values of one 8x8 tile by greedy non-maximum
+ * suppression and writes them to the candidate buffer.
+ */
+
+#version 440
+// EXTENSION compute_shader
+// EXTENSION shader_storage_buffer_object
+// EXTENSION shading_language_420pack
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+struct Candidate {
+    int utility;
+    int x;
+    int y;
+    int valid;
+};
+
+layout(std430, binding = 3) buffer Candidates {
+    Candidate candidates[];
+};
+
+uniform isampler2D utility_unit;
+uniform int k;
+uniform int max_utility;
+uniform int min_spacing;
+
+const int NONE = 0x7fffffff;
+const uint TILE_SIZE = 64u;
+
+shared int values[TILE_SIZE];
+shared int indices[TILE_SIZE];
+
+void main() {
+    ivec2 size = textureSize(utility_unit, 0);
+    ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+    uint local = gl_LocalInvocationIndex;
+    uint tile = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    ivec2 origin = ivec2(gl_WorkGroupID.xy * gl_WorkGroupSize.xy);
+
+    int value = NONE;
+    if (pos.x < size.x && pos.y < size.y) {
+        int u = texelFetch(utility_unit, pos, 0).r;
+        if (u < max_utility) {
+            value = u;
+        }
+    }
+
+    for (int i = 0; i < k; ++i) {
+        // Parallel reduction to the lowest utility in this tile
+        values[local] = value;
+        indices[local] = int(local);
+        memoryBarrierShared();
+        barrier();
+        for (uint s = TILE_SIZE / 2u; s > 0u; s >>= 1) {
+            if (local < s) {
+                int v = values[local + s];
+                int idx = indices[local + s];
+                if (v < values[local] || (v == values[local] && idx < indices[local])) {
+                    values[local] = v;
+                    indices[local] = idx;
+                }
+            }
+            memoryBarrierShared();
+            barrier();
+        }
+
+        int best = values[0];
+        ivec2 bestPos = origin + ivec2(indices[0] % int(gl_WorkGroupSize.x), indices[0] / int(gl_WorkGroupSize.x));
+        if (local == 0u) {
+            candidates[tile * uint(k) + uint(i)] = Candidate(best, bestPos.x, bestPos.y, int(best != NONE));
+        }
+
+        // Suppress the selected cell and its neighborhood
+        ivec2 d = pos - bestPos;
+        if (best != NONE && (d == ivec2(0) || d.x * d.x + d.y * d.y < min_spacing * min_spacing)) {
+            value = NONE;
+        }
+        barrier();
+    }
+}
@@ -30,10 +30,14 @@
 
 #include <gpu_coverage/AbstractTask.h>
 
+#include <algorithm>
+#include <limits>
+#include <time.h>
+
 namespace gpu_coverage {
 
 AbstractTask::AbstractTask(SharedData * const sharedData, const size_t threadNr)
-        : threadNr(threadNr), ready(false), sharedData(sharedData) {
+        : threadNr(threadNr), ready(false), sharedData(sharedData), chunkStartTime(0.), chunkFrames(0) {
     seed = time(NULL) + threadNr;
 }
 
@@ -43,4 +47,52 @@ AbstractTask::~AbstractTask() {
 void AbstractTask::finish() {
 }
 
+bool AbstractTask::nextFrameChunk(size_t& begin, size_t& end) {
+    const double now = getTime();
+
+    pthread_mutex_lock(&sharedData->mutex);
+    if (chunkFrames > 0) {
+        // Update average frame time with the measurement of the previous chunk
+        const double frameTime = (now - chunkStartTime) / chunkFrames;
+        sharedData->frameTime = sharedData->frameTime > 0. ? 0.75 * sharedData->frameTime + 0.25 * frameTime : frameTime;
+    }
+    const size_t numThreads = std::max(sharedData->numThreads, static_cast<size_t>(1));
+    const size_t remaining = sharedData->nextFrame < sharedData->endFrame ? sharedData->endFrame - sharedData->nextFrame : 0;
+    size_t chunk;
+    if (sharedData->frameChunkTime <= 0.) {
+        chunk = (sharedData->endFrame + numThreads - 1) / numThreads;
+    } else {
+        // Never take more than half of a fair share of the remaining frames (guided scheduling)
+        const size_t maxChunk = std::max((remaining + 2 * numThreads - 1) / (2 * numThreads), static_cast<size_t>(1));
+        chunk = 1;
+        if (sharedData->frameTime > 0.) {
+            chunk = static_cast<size_t>(sharedData->frameChunkTime / sharedData->frameTime);
+        }
+        chunk = std::min(std::max(chunk, static_cast<size_t>(1)), maxChunk);
+    }
+    chunk = std::min(chunk, remaining);
+    begin = sharedData->nextFrame;
+    end = begin + chunk;
+    sharedData->nextFrame = end;
+    pthread_mutex_unlock(&sharedData->mutex);
+
+    chunkStartTime = now;
+    chunkFrames = chunk;
+    return chunk > 0;
+}
+
+double AbstractTask::getTime() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) * 1e-9;
+}
+
+double AbstractTask::getSliceEnd(const size_t numSlices) const {
+    if (!hasDeadline()) {
+        return std::numeric_limits<double>::max();
+    }
+    const double now = getTime();
+    return now + std::max(sharedData->deadline - now, 0.) / std::max(numSlices, static_cast<size_t>(1));
+}
+
 } /* namespace gpu_coverage */
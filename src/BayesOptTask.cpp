@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#include <gpu_coverage/BayesOptTask.h>
+#include <gpu_coverage/VisibilityRenderer.h>
+#include <gpu_coverage/Config.h>
+#include <gpu_coverage/Utilities.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sys/mman.h>
+
+namespace gpu_coverage {
+
+double *BayesOptTask::observations = NULL;
+size_t BayesOptTask::observationsSize = 0;
+
+// Observation noise relative to the kernel variance, the renders are deterministic
+static const double surrogateNoise = 1e-6;
+
+BayesOptTask::BayesOptTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData,
+        const size_t numIterations)
+        : CmaEsTask(scene, threadNr, sharedData, numIterations),
+          numRounds(std::max(Config::getInstance().getParam<int>("bayesOptRounds"), 1)),
+          batchSize(std::max(Config::getInstance().getParam<int>("bayesOptBatchSize"), 1)),
+          numCandidates(std::max(Config::getInstance().getParam<int>("bayesOptCandidates"), 1)),
+          lengthScale(Config::getInstance().getParam<float>("bayesOptLengthScale")),
+          surrogate(getDimension(), lengthScale, surrogateNoise)
+{
+}
+
+BayesOptTask::~BayesOptTask() {
+}
+
+void BayesOptTask::propose(std::vector<std::vector<double> >& proposals, const std::vector<double>& bestX,
+        const double best) {
+    GaussianProcess believer(surrogate);
+    std::vector<double> x(getDimension());
+    for (size_t k = 0; k < proposals.size(); ++k) {
+        double bestImprovement = -1.;
+        for (size_t c = 0; c < numCandidates; ++c) {
+            // half of the candidates explore the whole space, half refine the best observation
+            const bool local = c % 2 == 1;
+            for (size_t d = 0; d < x.size(); ++d) {
+                x[d] = local ? std::min(1., std::max(0., bestX[d] + (2. * uniform() - 1.) * lengthScale)) : uniform();
+            }
+            const double improvement = believer.expectedImprovement(x, best);
+            if (improvement > bestImprovement) {
+                bestImprovement = improvement;
+                proposals[k] = x;
+            }
+        }
+        if (k + 1 < proposals.size()) {
+            // pretend the proposal has been evaluated with the predicted value
+            double mean, variance;
+            believer.predict(proposals[k], mean, variance);
+            believer.add(proposals[k], mean);
+        }
+    }
+}
+
+size_t BayesOptTask::search(RobotSceneConfiguration& bestConfiguration, float& bestEval) {
+    const size_t dimension = getDimension();
+    // an observation is a candidate vector followed by its evaluation
+    const size_t stride = dimension + 1;
+    const size_t roundSize = sharedData->numThreads * batchSize;
+    std::vector<std::vector<double> > proposals(batchSize, std::vector<double>(dimension));
+    std::vector<double> x(dimension);
+    std::vector<double> bestX(dimension);
+    std::vector<GLuint> visibilityResults;
+    RobotSceneConfiguration candidate;
+    double bestObserved = -std::numeric_limits<double>::max();
+    size_t numRenders = 0;
+    size_t numSkipped = 0;
+    surrogate.clear();
+
+    for (size_t r = 0; r < numRounds; ++r) {
+        if (r == 0) {
+            for (size_t k = 0; k < batchSize; ++k) {
+                for (size_t d = 0; d < dimension; ++d) {
+                    proposals[k][d] = uniform();
+                }
+            }
+        } else {
+            propose(proposals, bestX, bestObserved);
+        }
+
+        // Render the proposals as one batch, read back once
+        for (size_t k = 0; k < batchSize; ++k) {
+            decode(proposals[k], candidate);
+            candidate.applyToScene(scene);
+            cameraNode->setLocalTransform(candidate.getCameraLocalTransform());
+            visibilityRenderer->display();
+        }
+        visibilityRenderer->getPixelCounts(visibilityResults);
+        double * const ownObservations = observations + ((r * sharedData->numThreads) + threadNr) * batchSize * stride;
+        if (visibilityResults.size() != batchSize) {
+            // The other workers wait for this round, mark its observations as failed instead of returning
+            logError("Visibility results count does not match batch size");
+            taskSharedData->failed = true;
+            for (size_t k = 0; k < batchSize; ++k) {
+                ownObservations[k * stride + dimension] = std::numeric_limits<double>::quiet_NaN();
+            }
+        } else {
+            numRenders += visibilityResults.size();
+            for (size_t k = 0; k < batchSize; ++k) {
+                decode(proposals[k], candidate);
+                candidate.setCount(visibilityResults[k]);
+                const float eval = candidate.getEvaluation(taskSharedData->currentConfiguration);
+                if (eval > bestEval) {
+                    bestEval = eval;
+                    bestConfiguration.set(candidate);
+                }
+                std::copy(proposals[k].begin(), proposals[k].end(), ownObservations + k * stride);
+                ownObservations[k * stride + dimension] = eval;
+            }
+        }
+
+        // Wait for the observations of all workers
+        pthread_barrier_wait(&sharedData->barrier);
+
+        // The observations of a round are not written again, so all workers agree on a failure
+        const double * const roundObservations = observations + r * roundSize * stride;
+        for (size_t s = 0; s < roundSize; ++s) {
+            if (isnan(roundObservations[s * stride + dimension])) {
+                return 0;
+            }
+        }
+        if (r == 0) {
+            // Standardize with the random round, later observations keep this scale so that the update stays incremental
+            double sum = 0., sumSquares = 0.;
+            for (size_t s = 0; s < roundSize; ++s) {
+                const double y = roundObservations[s * stride + dimension];
+                sum += y;
+                sumSquares += y * y;
+            }
+            const double mean = sum / roundSize;
+            surrogate.setPrior(mean, sqrt(std::max(sumSquares / roundSize - mean * mean, 0.)));
+        }
+        // Every worker adds all observations to its own surrogate. This costs O(n^2) per observation,
+        // which is small compared to scoring the candidates in propose(), and that is already split:
+        // each worker scores only the candidates of its own batch.
+        for (size_t s = 0; s < roundSize; ++s) {
+            const double * const observation = roundObservations + s * stride;
+            x.assign(observation, observation + dimension);
+            if (!surrogate.add(x, observation[dimension])) {
+                ++numSkipped;
+            }
+            if (observation[dimension] > bestObserved) {
+                bestObserved = observation[dimension];
+                bestX = x;
+            }
+        }
+    }
+    if (numSkipped > 0) {
+        logInfo("[%zu] %zu duplicate observations not added to the surrogate", threadNr, numSkipped);
+    }
+    return numRenders;
+}
+
+void BayesOptTask::allocateSharedData(const size_t numThreads) {
+    CmaEsTask::allocateSharedData(numThreads);
+    if (!observations) {
+        const size_t numRounds = std::max(Config::getInstance().getParam<int>("bayesOptRounds"), 1);
+        const size_t batchSize = std::max(Config::getInstance().getParam<int>("bayesOptBatchSize"), 1);
+        // an observation is a candidate vector followed by its evaluation
+        const size_t stride = getDimension(RobotSceneConfiguration::numArticulation) + 1;
+        observationsSize = numRounds * numThreads * batchSize * stride * sizeof(double);
+        observations = (double *) mmap(NULL, observationsSize,
+                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    }
+}
+
+void BayesOptTask::freeSharedData() {
+    if (observations) {
+        munmap(observations, observationsSize);
+        observations = NULL;
+    }
+    CmaEsTask::freeSharedData();
+}
+
+} /* namespace gpu_coverage */
@@ -0,0 +1,445 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#include <gpu_coverage/BeamSearchTask.h>
+#include <gpu_coverage/BellmanFordXfbRenderer.h>
+#include <gpu_coverage/CostMapRenderer.h>
+#include <gpu_coverage/VisibilityRenderer.h>
+#include <gpu_coverage/Config.h>
+#include <gpu_coverage/Utilities.h>
+#include <gpu_coverage/Channel.h>
+#include <gpu_coverage/Sampler.h>
+#include <gpu_coverage/CandidateBatch.h>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <sys/mman.h>
+
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS true
+#endif
+#include <glm/gtc/matrix_access.hpp>
+
+namespace gpu_coverage {
+
+namespace {
+
+/**
+ * @brief Expansion of a beam considered by the selection, ordered by descending score.
+ */
+struct Expansion {
+    float score;
+    size_t index;
+    Expansion(const float score, const size_t index) : score(score), index(index) {}
+    bool operator<(const Expansion& other) const {
+        // lower expansion index first on ties, so the selection does not depend on the sort
+        return score != other.score ? score > other.score : index < other.index;
+    }
+};
+
+} /* anonymous namespace */
+
+BeamSearchTask::TaskSharedData *BeamSearchTask::taskSharedData = NULL;
+BeamSearchTask::Selection *BeamSearchTask::selections = NULL;
+GLuint *BeamSearchTask::expansionCounts = NULL;
+float *BeamSearchTask::expansionCosts = NULL;
+size_t BeamSearchTask::sharedDataSize = 0;
+const GLuint BeamSearchTask::notEvaluated;
+
+BeamSearchTask::BeamSearchTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData,
+        const size_t numSteps, const size_t numArticulationConfigs, const size_t numCameraPoses)
+        : AbstractTask(sharedData, threadNr), scene(scene), numSteps(numSteps),
+          numArticulationConfigs(numArticulationConfigs), numCameraPoses(numCameraPoses),
+          numCandidates(numArticulationConfigs * numCameraPoses), numArticulations(scene->getChannels().size()),
+          beamWidth(std::max(Config::getInstance().getParam<int>("beamWidth"), 1)),
+          costmapRenderer(NULL), bellmanFordRenderer(NULL), visibilityRenderer(NULL), cellSize(0.f),
+          candidatePool(numArticulationConfigs * (numCameraPoses + 1)), planPool(beamWidth * numSteps + 1),
+          candidateBatch(numCameraPoses)
+{
+    Node * const projectionPlane = scene->findNode(Config::getInstance().getParam<std::string>("projectionPlane"));
+    if (!projectionPlane) {
+        logError("Could not find projection plane");
+        return;
+    }
+    cameraNode = scene->findNode(Config::getInstance().getParam<std::string>("robotCamera"));
+    if (!cameraNode) {
+        logError("Could not find robot camera");
+        return;
+    }
+
+    costmapRenderer = new CostMapRenderer(scene, projectionPlane, false, false);
+    if (!costmapRenderer->isReady()) {
+        return;
+    }
+    bellmanFordRenderer = new BellmanFordXfbRenderer(scene, costmapRenderer, false, false);
+    if (!bellmanFordRenderer->isReady()) {
+        return;
+    }
+    visibilityRenderer = new VisibilityRenderer(scene, false, true);
+    if (!visibilityRenderer->isReady()) {
+        return;
+    }
+    // The distance map is rendered with an orthographic camera
+    cellSize = 2.f / (costmapRenderer->getCamera()->getProjectionMatrix()[0][0] * costmapRenderer->getTextureWidth());
+
+    std::stringstream targets(Config::getInstance().getParam<std::string>("target"));
+    size_t targetI = 0;
+    while (targets.good()) {
+        std::string targetName;
+        targets >> targetName;
+        if (!targetName.empty()) {
+            const Node * const target = scene->findNode(targetName);
+            targetTexture[targetI] = target->getMeshes().front()->getMaterial()->getTexture()->getTextureObject();
+            ++targetI;
+            targetPoints.push_back(glm::vec3(glm::column(target->getWorldTransform(), 3)));
+        }
+    }
+    numTargetTextures = targetI;
+
+    beamTextures.resize(2 * beamWidth * numTargetTextures);
+    glGenTextures(beamTextures.size(), &beamTextures[0]);
+    for (size_t i = 0; i < beamTextures.size(); ++i) {
+        glBindTexture(GL_TEXTURE_2D, beamTextures[i]);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, visibilityRenderer->getTextureWidth(),
+                visibilityRenderer->getTextureHeight());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    checkGLError();
+
+    if (threadNr == 0) {
+        taskSharedData->numSelected = 0;
+        taskSharedData->finished = false;
+    }
+
+    ready = true;
+}
+
+BeamSearchTask::~BeamSearchTask() {
+    if (!beamTextures.empty()) {
+        glDeleteTextures(beamTextures.size(), &beamTextures[0]);
+    }
+    delete costmapRenderer;
+    delete bellmanFordRenderer;
+    delete visibilityRenderer;
+}
+
+void BeamSearchTask::copyTextures(const GLuint * const source, GLuint * const destination) const {
+    for (size_t t = 0; t < numTargetTextures; ++t) {
+        glCopyImageSubData(source[t], GL_TEXTURE_2D, 0, 0, 0, 0, destination[t], GL_TEXTURE_2D, 0, 0, 0, 0,
+                visibilityRenderer->getTextureWidth(), visibilityRenderer->getTextureHeight(), 1);
+    }
+}
+
+bool BeamSearchTask::getCell(const RobotSceneConfiguration& configuration, size_t& cell) const {
+    glm::vec4 position(glm::column(configuration.getCameraLocalTransform(), 3));
+    if (cameraNode->getParent()) {
+        position = cameraNode->getParent()->getWorldTransform() * position;
+    }
+    return costmapRenderer->getPixel(glm::vec3(position), cell);
+}
+
+void BeamSearchTask::run() {
+    if (!ready) {
+        return;
+    }
+
+    // All workers sample the candidates with the seed of the first worker. The seed is only known
+    // here, because setSeed() is called after construction.
+    if (threadNr == 0) {
+        taskSharedData->candidateSeed = seed;
+    }
+    pthread_barrier_wait(&sharedData->barrier);
+
+    const std::string samplerType = Config::getInstance().getParam<std::string>("sampler");
+    // Upper bound of the number of observed pixels, for bounding the gain of an expansion
+    const float maxCount = static_cast<float>(numTargetTextures) * visibilityRenderer->getTextureWidth()
+            * visibilityRenderer->getTextureHeight();
+
+    // Search tree of the beams, built identically in all workers
+    std::vector<BeamNode> nodes;
+    std::vector<size_t> beams;
+    std::vector<size_t> nextBeams;
+    RobotSceneConfiguration * const root = planPool.acquire();
+    for (size_t a = 0; a < numArticulations; ++a) {
+        root->setArticulation(a, 0.f);
+    }
+    root->setCameraLocalTransform(cameraNode->getLocalTransform());
+    root->setCount(0);
+    nodes.push_back(BeamNode(root, 0, 0, 0.f, 0.f));
+    beams.push_back(0);
+    size_t bestNode = 0;
+    size_t currentSet = 0;
+    copyTextures(targetTexture, &beamTextures[getBeamTexture(currentSet, 0, 0)]);
+
+    std::vector<float> articulationSamples;
+    std::vector<float> cameraSamples;
+    std::vector<RobotSceneConfiguration *> batches;
+    std::vector<RobotSceneConfiguration *> candidates;
+    candidates.reserve(numCandidates);
+    std::vector<GLint> distances;
+    std::vector<bool> reachable;
+    std::vector<size_t> renderedExpansions;
+    std::vector<GLuint> counts;
+    std::vector<Expansion> expansions;
+    size_t numRendered = 0;
+    size_t numUnreachable = 0;
+    size_t numPruned = 0;
+
+    for (size_t step = 0; step < numSteps; ++step) {
+        // Sample the same candidates in all workers, grouped by articulation as in RandomSearchTask
+        unsigned int stepSeed = taskSharedData->candidateSeed + static_cast<unsigned int>(step) * 7919u;
+        Sampler * const articulationSampler = Sampler::create(samplerType, 2, rand_r(&stepSeed));
+        Sampler * const cameraSampler = Sampler::create(samplerType, 4, rand_r(&stepSeed));
+        if (!articulationSampler || !cameraSampler) {
+            // same configuration in all workers, so all of them return here
+            delete articulationSampler;
+            delete cameraSampler;
+            return;
+        }
+        articulationSampler->generate(numArticulationConfigs, articulationSamples);
+        cameraSampler->generate(numCandidates, cameraSamples);
+        batches.clear();
+        candidates.clear();
+        for (size_t a = 0; a < numArticulationConfigs; ++a) {
+            RobotSceneConfiguration * const rsc = candidatePool.acquire();
+            rsc->setArticulationFromSample(&articulationSamples[a * articulationSampler->getDimensions()]);
+            batches.push_back(rsc);
+            for (size_t c = 0; c < numCameraPoses; ++c) {
+                const float * const sample = &cameraSamples[candidates.size() * cameraSampler->getDimensions()];
+                RobotSceneConfiguration * const candidate = candidatePool.acquire();
+                candidate->set(*rsc);
+                candidate->setCameraHeightFromSample(sample[0]);
+                candidate->setCameraPositionFromSample(sample + 1, &targetPoints);
+                candidates.push_back(candidate);
+            }
+        }
+        delete articulationSampler;
+        delete cameraSampler;
+
+        // Expand all beams with the articulation batches of this worker, one batch of renders per beam
+        std::priority_queue<float, std::vector<float>, std::greater<float> > bestScores;
+        for (size_t a = threadNr; a < numArticulationConfigs; a += sharedData->numThreads) {
+            batches[a]->applyToScene(scene);
+            costmapRenderer->display();
+            for (size_t b = 0; b < beams.size(); ++b) {
+                const BeamNode& beam = nodes[beams[b]];
+                RobotSceneConfiguration& previous = *beam.configuration;
+                // the distance map starts at the last view of the beam
+                cameraNode->setLocalTransform(previous.getCameraLocalTransform());
+                bellmanFordRenderer->display();
+                bellmanFordRenderer->getDistances(distances);
+                copyTextures(&beamTextures[getBeamTexture(currentSet, b, 0)], targetTexture);
+                const float maxGain = RobotSceneConfiguration::gainFactor
+                        * (maxCount - static_cast<float>(previous.getCount()));
+
+                // Travel costs of the whole batch from the distance map
+                candidateBatch.clear();
+                reachable.clear();
+                for (size_t candidate = a * numCameraPoses; candidate < (a + 1) * numCameraPoses; ++candidate) {
+                    size_t cell = 0;
+                    reachable.push_back(getCell(*candidates[candidate], cell)
+                            && distances[cell] < BellmanFordXfbRenderer::unreachableDistance);
+                    candidateBatch.add(*candidates[candidate], reachable.back() ? cell : 0);
+                }
+                candidateBatch.lookupPathLengths(distances, cellSize / BellmanFordXfbRenderer::distancePerCell);
+                candidateBatch.evaluate(previous);
+
+                renderedExpansions.clear();
+                for (size_t k = 0; k < numCameraPoses; ++k) {
+                    const size_t candidate = a * numCameraPoses + k;
+                    const RobotSceneConfiguration& c = *candidates[candidate];
+                    const size_t expansion = b * numCandidates + candidate;
+                    expansionCounts[expansion] = notEvaluated;
+                    if (!reachable[k]) {
+                        ++numUnreachable;
+                        continue;
+                    }
+                    expansionCosts[expansion] = candidateBatch.getCost(k);
+                    if (bestScores.size() == beamWidth
+                            && beam.score + maxGain - expansionCosts[expansion] <= bestScores.top()) {
+                        // cannot become a beam even if it observed all remaining pixels
+                        ++numPruned;
+                        continue;
+                    }
+                    cameraNode->setLocalTransform(c.getCameraLocalTransform());
+                    visibilityRenderer->display();
+                    renderedExpansions.push_back(expansion);
+                }
+
+                visibilityRenderer->getPixelCounts(counts);
+                if (counts.size() != renderedExpansions.size()) {
+                    logError("Visibility results count does not match expansions count");
+                    return;
+                }
+                numRendered += counts.size();
+                for (size_t i = 0; i < counts.size(); ++i) {
+                    const size_t expansion = renderedExpansions[i];
+                    expansionCounts[expansion] = counts[i];
+                    if (counts[i] > previous.getCount()) {
+                        bestScores.push(beam.score + RobotSceneConfiguration::gainFactor
+                                * (static_cast<int>(counts[i]) - static_cast<int>(previous.getCount()))
+                                - expansionCosts[expansion]);
+                        if (bestScores.size() > beamWidth) {
+                            bestScores.pop();
+                        }
+                    }
+                }
+            }
+        }
+
+        // Wait for the expansions of all workers
+        pthread_barrier_wait(&sharedData->barrier);
+
+        if (threadNr == 0) {
+            // Only expansions that add coverage become beams
+            expansions.clear();
+            for (size_t b = 0; b < beams.size(); ++b) {
+                const BeamNode& beam = nodes[beams[b]];
+                const GLuint previousCount = beam.configuration->getCount();
+                for (size_t candidate = 0; candidate < numCandidates; ++candidate) {
+                    const size_t expansion = b * numCandidates + candidate;
+                    const GLuint count = expansionCounts[expansion];
+                    if (count != notEvaluated && count > previousCount) {
+                        expansions.push_back(Expansion(beam.score + RobotSceneConfiguration::gainFactor
+                                * (static_cast<int>(count) - static_cast<int>(previousCount))
+                                - expansionCosts[expansion], expansion));
+                    }
+                }
+            }
+            const size_t numSelected = std::min(expansions.size(), beamWidth);
+            std::partial_sort(expansions.begin(), expansions.begin() + numSelected, expansions.end());
+            for (size_t k = 0; k < numSelected; ++k) {
+                selections[k].beam = expansions[k].index / numCandidates;
+                selections[k].candidate = expansions[k].index % numCandidates;
+                selections[k].cost = expansionCosts[expansions[k].index];
+                selections[k].score = expansions[k].score;
+            }
+            taskSharedData->numSelected = numSelected;
+            taskSharedData->finished = numSelected == 0;
+        }
+
+        // Wait for the selection
+        pthread_barrier_wait(&sharedData->barrier);
+        if (taskSharedData->finished) {
+            break;
+        }
+
+        // All workers append the selected views to the tree and render the coverage of the new beams
+        const size_t nextSet = 1 - currentSet;
+        nextBeams.clear();
+        for (size_t k = 0; k < taskSharedData->numSelected; ++k) {
+            const Selection& selection = selections[k];
+            RobotSceneConfiguration * const view = planPool.acquire();
+            view->set(*candidates[selection.candidate]);
+            view->setCount(expansionCounts[selection.beam * numCandidates + selection.candidate]);
+            nodes.push_back(BeamNode(view, beams[selection.beam], step + 1, selection.cost, selection.score));
+            nextBeams.push_back(nodes.size() - 1);
+            if (selection.score > nodes[bestNode].score) {
+                bestNode = nodes.size() - 1;
+            }
+
+            copyTextures(&beamTextures[getBeamTexture(currentSet, selection.beam, 0)], targetTexture);
+            view->applyToScene(scene);
+            cameraNode->setLocalTransform(view->getCameraLocalTransform());
+            visibilityRenderer->display(false);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+            for (size_t t = 0; t < numTargetTextures; ++t) {
+                glCopyImageSubData(visibilityRenderer->getTexture(t), GL_TEXTURE_2D, 0, 0, 0, 0,
+                        beamTextures[getBeamTexture(nextSet, k, t)], GL_TEXTURE_2D, 0, 0, 0, 0,
+                        visibilityRenderer->getTextureWidth(), visibilityRenderer->getTextureHeight(), 1);
+            }
+        }
+        beams.swap(nextBeams);
+        currentSet = nextSet;
+        candidatePool.releaseAll();
+        if (threadNr == 0) {
+            logInfo("Step %zu: %zu beams, best score %f", step + 1, beams.size(), nodes[beams.front()].score);
+        }
+
+        // Wait until the selection has been read before the next one is written
+        pthread_barrier_wait(&sharedData->barrier);
+    }
+
+    logInfo("[%zu] %zu expansions rendered, %zu unreachable, %zu pruned by bounds",
+            threadNr, numRendered, numUnreachable, numPruned);
+
+    if (threadNr == 0) {
+        // Print the best view sequence found in any step
+        std::vector<size_t> plan;
+        for (size_t n = bestNode; n != 0; n = nodes[n].parent) {
+            plan.push_back(n);
+        }
+        std::reverse(plan.begin(), plan.end());
+        std::cout << "#step\tcoverage\tcost\tgain\tscore\tx\ty\tz";
+        for (size_t a = 0; a < numArticulations; ++a) {
+            std::cout << "\t" << scene->getChannels()[a]->getNode()->getName();
+        }
+        std::cout << std::endl;
+        for (size_t p = 0; p < plan.size(); ++p) {
+            const BeamNode& node = nodes[plan[p]];
+            cameraNode->setLocalTransform(node.configuration->getCameraLocalTransform());
+            const glm::vec3 position(glm::column(cameraNode->getWorldTransform(), 3));
+            std::cout << node.step << "\t" << node.configuration->getCount() << "\t" << node.cost << "\t"
+                    << node.configuration->getGain(*nodes[node.parent].configuration) << "\t" << node.score << "\t"
+                    << position.x << "\t" << position.y << "\t" << position.z;
+            for (size_t a = 0; a < numArticulations; ++a) {
+                std::cout << "\t" << node.configuration->getArticulation(a);
+            }
+            std::cout << std::endl;
+        }
+    }
+}
+
+void BeamSearchTask::allocateSharedData(const size_t numCandidates) {
+    if (!taskSharedData) {
+        const size_t beamWidth = std::max(Config::getInstance().getParam<int>("beamWidth"), 1);
+        sharedDataSize = sizeof(TaskSharedData) + beamWidth * sizeof(Selection)
+                + beamWidth * numCandidates * (sizeof(GLuint) + sizeof(float));
+        taskSharedData = (TaskSharedData *) mmap(NULL, sharedDataSize,
+                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        selections = reinterpret_cast<Selection*>(taskSharedData + 1);
+        expansionCounts = reinterpret_cast<GLuint*>(selections + beamWidth);
+        expansionCosts = reinterpret_cast<float*>(expansionCounts + beamWidth * numCandidates);
+    }
+}
+
+void BeamSearchTask::freeSharedData() {
+    if (taskSharedData) {
+        munmap(taskSharedData, sharedDataSize);
+        taskSharedData = NULL;
+        selections = NULL;
+        expansionCounts = NULL;
+        expansionCosts = NULL;
+    }
+}
+
+} /* namespace gpu_coverage */
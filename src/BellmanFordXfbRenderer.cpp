@@ -32,6 +32,7 @@
 #include <gpu_coverage/Utilities.h>
 #include <gpu_coverage/Config.h>
 #include <fstream>
+#include <limits>
 
 #ifndef GLM_FORCE_RADIANS
 #define GLM_FORCE_RADIANS true
@@ -98,6 +99,7 @@ BellmanFordXfbRenderer::BellmanFordXfbRenderer(const Scene * const scene, const
         switch (i) {
         case QUEUED:
         case OUTPUT:
+        case SOURCE:
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
             glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32I, width, height);
@@ -172,19 +174,25 @@ void BellmanFordXfbRenderer::display() {
 
     // Clear output texture
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[OUTPUT], 0);
-    const GLint large[4] = { 10000000, 0, 0, 0 };
+    const GLint large[4] = { unreachableDistance, 0, 0, 0 };
     glClearBufferiv(GL_COLOR, 0, large);
 
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[QUEUED], 0);
     const GLint zero[4] = { 0, 0, 0, 0 };
     glClearBufferiv(GL_COLOR, 0, zero);
 
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[SOURCE], 0);
+    // the largest distance and index, so that the atomic minimum in the step shader replaces it
+    const GLint noSource[4] = { std::numeric_limits<GLint>::max(), 0, 0, 0 };
+    glClearBufferiv(GL_COLOR, 0, noSource);
+
     checkGLError();
 
     // Bind output texture to image unit
     glBindImageTexture(4, costmapRenderer->getTexture(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32I);
     glBindImageTexture(5, textures[OUTPUT], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32I);
     glBindImageTexture(6, textures[QUEUED], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32I);
+    glBindImageTexture(7, textures[SOURCE], 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32I);
 
     int input = 0;
     int output = 1;
@@ -194,13 +202,17 @@ void BellmanFordXfbRenderer::display() {
     progBellmanFordXfbInit.use();
     const glm::mat4 mvp = costmapRenderer->getCamera()->getProjectionMatrix()
             * glm::inverse(costmapRenderer->getCamera()->getNode()->getWorldTransform());
-    const glm::vec4 robotPosition = glm::column(scene->findNode(Config::getInstance().getParam<std::string>("robotCamera"))->getWorldTransform(), 3);
-    const glm::vec4 position = mvp * robotPosition;
-    glm::vec2 uv(position.x / position.w, position.y / position.w);
-    if (uv.x < -1.f || uv.y < -1.f || uv.x > 1 || uv.y > 1) {
-        logWarn("Robot position out of range: (%.2f, %.2f) not in range [-1..1, -1..1]", uv.x, uv.y);
+    std::vector<glm::vec4> startPositions;
+    if (sourcePositions.empty()) {
+        startPositions.push_back(glm::column(scene->findNode(Config::getInstance().getParam<std::string>("robotCamera"))->getWorldTransform(), 3));
+    } else {
+        if (sourcePositions.size() > static_cast<size_t>(maxSources)) {
+            logWarn("Only the first %d of %zu start positions are used", maxSources, sourcePositions.size());
+        }
+        for (size_t s = 0; s < sourcePositions.size() && s < static_cast<size_t>(maxSources); ++s) {
+            startPositions.push_back(glm::vec4(sourcePositions[s], 1.f));
+        }
     }
-    glUniform2f(progBellmanFordXfbInit.locations.robotPosition, uv.x, uv.y);
 
     // source buffer
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
@@ -214,13 +226,23 @@ void BellmanFordXfbRenderer::display() {
     glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, tbo[output]);
     checkGLError();
 
-    // render
+    // render, one point per start position, all of them are queued for the first step
+    // together with their index, which the step shader propagates to the reached cells
     glBeginTransformFeedback(GL_POINTS);
-    glDrawArrays(GL_POINTS, 0, 1);
+    for (size_t s = 0; s < startPositions.size(); ++s) {
+        const glm::vec4 position = mvp * startPositions[s];
+        glm::vec2 uv(position.x / position.w, position.y / position.w);
+        if (uv.x < -1.f || uv.y < -1.f || uv.x > 1 || uv.y > 1) {
+            logWarn("Robot position out of range: (%.2f, %.2f) not in range [-1..1, -1..1]", uv.x, uv.y);
+        }
+        glUniform2f(progBellmanFordXfbInit.locations.robotPosition, uv.x, uv.y);
+        glUniform1i(progBellmanFordXfbInit.locations.source, static_cast<GLint>(s));
+        glDrawArrays(GL_POINTS, 0, 1);
+    }
     glEndTransformFeedback();
     checkGLError();
 
-    GLuint numPrimitives = 1;
+    GLuint numPrimitives = startPositions.size();
     std::swap(input, output);
 
     // =========== STEP ===========
@@ -307,4 +329,29 @@ void BellmanFordXfbRenderer::display() {
 
 }
 
+void BellmanFordXfbRenderer::getDistances(std::vector<GLint>& distances) const {
+    distances.resize(width * height);
+    // the distances are written with image stores
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    glBindTexture(GL_TEXTURE_2D, textures[OUTPUT]);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED_INTEGER, GL_INT, &distances[0]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    checkGLError();
+}
+
+void BellmanFordXfbRenderer::getSources(std::vector<GLint>& sources) const {
+    sources.resize(width * height);
+    // the sources are written with image stores
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    glBindTexture(GL_TEXTURE_2D, textures[SOURCE]);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED_INTEGER, GL_INT, &sources[0]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    checkGLError();
+    // strip the distance in the high bits
+    for (size_t cell = 0; cell < sources.size(); ++cell) {
+        const GLint source = sources[cell] & maxSources;
+        sources[cell] = source == maxSources ? -1 : source;
+    }
+}
+
 } /* namespace gpu_coverage */
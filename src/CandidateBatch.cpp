@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#include <gpu_coverage/CandidateBatch.h>
+#include <gpu_coverage/Utilities.h>
+
+#include <cmath>
+
+namespace gpu_coverage {
+
+CandidateBatch::CandidateBatch(const size_t capacity)
+        : capacity(capacity), numCandidates(0), hasPathLengths(false),
+          x(capacity), y(capacity), z(capacity),
+          articulations(capacity * RobotSceneConfiguration::numArticulation),
+          counts(capacity), cells(capacity), pathLengths(capacity),
+          costs(capacity), gains(capacity), evaluations(capacity) {
+}
+
+CandidateBatch::~CandidateBatch() {
+}
+
+size_t CandidateBatch::add(const RobotSceneConfiguration& configuration, const size_t cell) {
+    if (numCandidates >= capacity) {
+        logError("CandidateBatch full, capacity is %zu", capacity);
+        return numCandidates;
+    }
+    const size_t i = numCandidates;
+    x[i] = configuration.cameraPosition.x;
+    y[i] = configuration.cameraPosition.y;
+    z[i] = configuration.cameraPosition.z;
+    for (size_t a = 0; a < RobotSceneConfiguration::numArticulation; ++a) {
+        articulations[a * capacity + i] = configuration.articulation[a];
+    }
+    counts[i] = static_cast<int>(configuration.count);
+    cells[i] = cell;
+    ++numCandidates;
+    return i;
+}
+
+void CandidateBatch::lookupPathLengths(const std::vector<GLint>& distances, const float scale) {
+    for (size_t i = 0; i < numCandidates; ++i) {
+        pathLengths[i] = scale * static_cast<float>(distances[cells[i]]);
+    }
+    hasPathLengths = true;
+}
+
+void CandidateBatch::evaluate(const RobotSceneConfiguration& previousConfig) {
+    const size_t n = numCandidates;
+    if (n == 0) {
+        return;
+    }
+    // Plain pointers, so that the compiler knows the arrays do not overlap
+    float * __restrict__ const cost = &costs[0];
+    float * __restrict__ const gain = &gains[0];
+    float * __restrict__ const evaluation = &evaluations[0];
+    const float * __restrict__ const px = &x[0];
+    const float * __restrict__ const py = &y[0];
+    const float * __restrict__ const pz = &z[0];
+
+    // distance
+    const float costDistance = RobotSceneConfiguration::costDistance;
+    if (hasPathLengths) {
+        const float * __restrict__ const length = &pathLengths[0];
+        for (size_t i = 0; i < n; ++i) {
+            cost[i] = costDistance * length[i];
+        }
+    } else {
+        const float previousX = previousConfig.cameraPosition.x;
+        const float previousY = previousConfig.cameraPosition.y;
+        for (size_t i = 0; i < n; ++i) {
+            const float dx = px[i] - previousX;
+            const float dy = py[i] - previousY;
+            cost[i] = costDistance * sqrtf(dx * dx + dy * dy);
+        }
+    }
+    // height change
+    const float previousZ = previousConfig.cameraPosition.z;
+    const float costHeight = RobotSceneConfiguration::costCameraHeightChange;
+    for (size_t i = 0; i < n; ++i) {
+        cost[i] += fabsf(previousZ - pz[i]) > 1e-4f ? costHeight : 0.f;
+    }
+    // articulation, one pass per articulated object
+    for (size_t a = 0; a < RobotSceneConfiguration::numArticulation; ++a) {
+        const float * __restrict__ const articulation = &articulations[a * capacity];
+        const float previous = previousConfig.articulation[a];
+        const float constant = RobotSceneConfiguration::costArticulation[a].constant;
+        const float linear = RobotSceneConfiguration::costArticulation[a].linear;
+        for (size_t i = 0; i < n; ++i) {
+            const float delta = fabsf(articulation[i] - previous);
+            cost[i] += delta > 1e-4f ? constant + linear * delta : 0.f;
+        }
+    }
+    // gain and evaluation
+    const int * __restrict__ const count = &counts[0];
+    const int previousCount = static_cast<int>(previousConfig.count);
+    const float gainFactor = RobotSceneConfiguration::gainFactor;
+    for (size_t i = 0; i < n; ++i) {
+        gain[i] = gainFactor * static_cast<float>(count[i] - previousCount);
+        evaluation[i] = gain[i] - cost[i];
+    }
+}
+
+size_t CandidateBatch::getBest() const {
+    size_t best = numCandidates;
+    float bestEvaluation = 0.f;
+    for (size_t i = 0; i < numCandidates; ++i) {
+        if (best == numCandidates || evaluations[i] > bestEvaluation) {
+            best = i;
+            bestEvaluation = evaluations[i];
+        }
+    }
+    return best;
+}
+
+} /* namespace gpu_coverage */
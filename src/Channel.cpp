@@ -140,4 +140,17 @@ void Channel::setFrame(const size_t frame) {
     localTransform = glm::translate(glm::mat4(1.0f), loc) * glm::mat4_cast(rot) * glm::scale(glm::mat4(1.0f), scl);
 }
 
+void Channel::setFramePosition(const float frame) {
+    Locations::const_iterator locLow, locHigh;
+    const float locPos = findFractionalInterval(locations, frame, locLow, locHigh);
+    const glm::vec3 loc = locLow->second * (1.f - locPos) + locHigh->second * locPos;
+    Rotations::const_iterator rotLow, rotHigh;
+    const float rotPos = findFractionalInterval(rotations, frame, rotLow, rotHigh);
+    const glm::quat rot = rotLow == rotHigh ? rotLow->second : glm::slerp(rotLow->second, rotHigh->second, rotPos);
+    Scales::const_iterator sclLow, sclHigh;
+    const float sclPos = findFractionalInterval(scales, frame, sclLow, sclHigh);
+    const glm::vec3 scl = sclLow->second * (1.f - sclPos) + sclHigh->second * sclPos;
+    localTransform = glm::translate(glm::mat4(1.0f), loc) * glm::mat4_cast(rot) * glm::scale(glm::mat4(1.0f), scl);
+}
+
 } /* namespace gpu_coverage */
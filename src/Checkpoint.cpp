@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#include <gpu_coverage/Checkpoint.h>
+#include <gpu_coverage/Utilities.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace gpu_coverage {
+
+const uint32_t Checkpoint::magic;
+const uint32_t Checkpoint::version;
+
+Checkpoint::Checkpoint(const std::string& filename, const std::string& task)
+        : filename(filename), task(task), pendingFence(0), readPosition(0), writing(false) {
+}
+
+Checkpoint::~Checkpoint() {
+    flush();
+    wait();
+    for (size_t i = 0; i < readbacks.size(); ++i) {
+        glDeleteBuffers(1, &readbacks[i].pbo);
+    }
+}
+
+void Checkpoint::begin() {
+    for (size_t i = 0; i < readbacks.size(); ++i) {
+        glDeleteBuffers(1, &readbacks[i].pbo);
+    }
+    readbacks.clear();
+    buffer.clear();
+    put(magic);
+    put(version);
+    const uint32_t length = task.size();
+    put(length);
+    put(task.data(), length);
+}
+
+void Checkpoint::put(const void * const data, const size_t size) {
+    const char * const bytes = static_cast<const char *>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+void Checkpoint::putConfiguration(const RobotSceneConfiguration& configuration) {
+    put(configuration.getCameraLocalTransform());
+    const uint32_t numArticulation = RobotSceneConfiguration::numArticulation;
+    put(numArticulation);
+    for (size_t a = 0; a < numArticulation; ++a) {
+        put(configuration.getArticulation(a));
+    }
+    put(configuration.getCount());
+}
+
+void Checkpoint::putTexture(const GLuint texture, const int width, const int height) {
+    put(width);
+    put(height);
+    Readback readback;
+    readback.offset = buffer.size();
+    readback.size = 4 * width * height;
+    buffer.resize(readback.offset + readback.size);
+    glGenBuffers(1, &readback.pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, readback.size, NULL, GL_STREAM_READ);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    checkGLError();
+    readbacks.push_back(readback);
+}
+
+void Checkpoint::commit() {
+    // The read backs of the previous checkpoint have finished by now
+    flush();
+    if (readbacks.empty()) {
+        startWriter(buffer);
+    } else {
+        pendingBuffer.swap(buffer);
+        pendingReadbacks.swap(readbacks);
+        readbacks.clear();
+        pendingFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    buffer.clear();
+}
+
+void Checkpoint::poll() {
+    if (pendingReadbacks.empty()) {
+        return;
+    }
+    if (pendingFence) {
+        const GLenum status = glClientWaitSync(pendingFence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            return;
+        }
+    }
+    flush();
+}
+
+void Checkpoint::flush() {
+    if (pendingFence) {
+        glDeleteSync(pendingFence);
+        pendingFence = 0;
+    }
+    if (pendingReadbacks.empty()) {
+        return;
+    }
+    bool ok = true;
+    for (size_t i = 0; i < pendingReadbacks.size(); ++i) {
+        const Readback& readback = pendingReadbacks[i];
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        const char * const pixels = (const char *) glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback.size,
+                GL_MAP_READ_BIT);
+        if (pixels) {
+            memcpy(&pendingBuffer[readback.offset], pixels, readback.size);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        } else {
+            ok = false;
+        }
+        glDeleteBuffers(1, &readback.pbo);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    checkGLError();
+    pendingReadbacks.clear();
+    if (!ok) {
+        logError("Could not read back checkpoint textures, not writing %s", filename.c_str());
+        pendingBuffer.clear();
+        return;
+    }
+    startWriter(pendingBuffer);
+}
+
+void Checkpoint::startWriter(std::vector<char>& data) {
+    wait();
+    writeBuffer.swap(data);
+    data.clear();
+    if (pthread_create(&writer, NULL, &Checkpoint::write, this) != 0) {
+        logError("Could not start checkpoint writer, writing %s synchronously", filename.c_str());
+        write(this);
+        return;
+    }
+    writing = true;
+}
+
+void Checkpoint::wait() {
+    if (writing) {
+        pthread_join(writer, NULL);
+        writing = false;
+    }
+}
+
+void * Checkpoint::write(void * checkpoint) {
+    const Checkpoint * const self = static_cast<const Checkpoint *>(checkpoint);
+    const std::string tmpFilename = self->filename + ".tmp";
+    FILE * const file = fopen(tmpFilename.c_str(), "wb");
+    if (!file) {
+        logError("Could not open checkpoint file %s", tmpFilename.c_str());
+        return NULL;
+    }
+    const bool ok = fwrite(&self->writeBuffer[0], 1, self->writeBuffer.size(), file) == self->writeBuffer.size()
+            && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    fclose(file);
+    if (!ok || rename(tmpFilename.c_str(), self->filename.c_str()) != 0) {
+        logError("Could not write checkpoint file %s", self->filename.c_str());
+    }
+    return NULL;
+}
+
+bool Checkpoint::load() {
+    wait();
+    buffer.clear();
+    readPosition = 0;
+    FILE * const file = fopen(filename.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    char chunk[65536];
+    size_t numRead;
+    while ((numRead = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        buffer.insert(buffer.end(), chunk, chunk + numRead);
+    }
+    fclose(file);
+
+    uint32_t fileMagic, fileVersion, length;
+    if (!get(fileMagic) || !get(fileVersion) || fileMagic != magic || fileVersion != version || !get(length)
+            || length > buffer.size() - readPosition) {
+        logWarn("Ignoring invalid checkpoint file %s", filename.c_str());
+        return false;
+    }
+    const std::string fileTask(&buffer[readPosition], length);
+    readPosition += length;
+    if (fileTask != task) {
+        logWarn("Ignoring checkpoint file %s of task %s", filename.c_str(), fileTask.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Checkpoint::get(void * const data, const size_t size) {
+    if (size > buffer.size() - readPosition) {
+        logError("Checkpoint file %s is truncated", filename.c_str());
+        return false;
+    }
+    memcpy(data, &buffer[readPosition], size);
+    readPosition += size;
+    return true;
+}
+
+bool Checkpoint::getConfiguration(RobotSceneConfiguration& configuration) {
+    glm::mat4x4 cameraTransform;
+    uint32_t numArticulation;
+    if (!get(cameraTransform) || !get(numArticulation)) {
+        return false;
+    }
+    if (numArticulation != RobotSceneConfiguration::numArticulation) {
+        logError("Checkpoint has %u articulated objects, the scene has %zu", numArticulation,
+                RobotSceneConfiguration::numArticulation);
+        return false;
+    }
+    configuration.setCameraLocalTransform(cameraTransform);
+    for (size_t a = 0; a < numArticulation; ++a) {
+        float value;
+        if (!get(value)) {
+            return false;
+        }
+        configuration.setArticulation(a, value);
+    }
+    GLuint count;
+    if (!get(count)) {
+        return false;
+    }
+    configuration.setCount(count);
+    return true;
+}
+
+bool Checkpoint::getTexture(const GLuint texture, const int width, const int height) {
+    int fileWidth, fileHeight;
+    if (!get(fileWidth) || !get(fileHeight)) {
+        return false;
+    }
+    if (fileWidth != width || fileHeight != height) {
+        logError("Checkpoint texture has size %dx%d instead of %dx%d", fileWidth, fileHeight, width, height);
+        return false;
+    }
+    const size_t size = 4 * width * height;
+    if (size > buffer.size() - readPosition) {
+        logError("Checkpoint file %s is truncated", filename.c_str());
+        return false;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &buffer[readPosition]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    checkGLError();
+    readPosition += size;
+    return true;
+}
+
+size_t Checkpoint::loadFrames(const std::string& filename, const size_t numFrames, std::vector<bool>& done) {
+    done.assign(numFrames, false);
+    FILE * const file = fopen(filename.c_str(), "rb");
+    if (!file) {
+        return 0;
+    }
+    size_t numDone = 0;
+    uint32_t frame;
+    while (fread(&frame, sizeof(frame), 1, file) == 1) {
+        if (frame < numFrames && !done[frame]) {
+            done[frame] = true;
+            ++numDone;
+        }
+    }
+    fclose(file);
+    return numDone;
+}
+
+void Checkpoint::appendFrame(const std::string& filename, const size_t frame) {
+    const int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        logError("Could not open frame log %s", filename.c_str());
+        return;
+    }
+    // a single small write in append mode is not interleaved with the writes of other workers
+    const uint32_t value = frame;
+    if (::write(fd, &value, sizeof(value)) != sizeof(value)) {
+        logError("Could not write frame log %s", filename.c_str());
+    }
+    close(fd);
+}
+
+} /* namespace gpu_coverage */
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#include <gpu_coverage/CmaEs.h>
+#include <gpu_coverage/Utilities.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace gpu_coverage {
+
+namespace {
+/**
+ * @brief Sorts candidate indices by decreasing fitness.
+ */
+struct ByFitness {
+    const std::vector<double>& fitness;
+    explicit ByFitness(const std::vector<double>& fitness) : fitness(fitness) {}
+    bool operator()(const size_t a, const size_t b) const {
+        return fitness[a] > fitness[b];
+    }
+};
+}  // namespace
+
+CmaEs::CmaEs(const std::vector<double>& mean, const double sigma, const size_t populationSize)
+        : n(mean.size()),
+          lambda(populationSize > 0 ? std::max(populationSize, static_cast<size_t>(2))
+                  : 4 + static_cast<size_t>(3. * log(static_cast<double>(n)))),
+          mu(lambda / 2), mean(mean), sigma(sigma), pc(n, 0.), ps(n, 0.), C(n, Vector(n, 0.)), B(n, Vector(n, 0.)),
+          D(n, 1.), generation(0), population(lambda, Vector(n, 0.)) {
+    if (populationSize == 1) {
+        // mu would be 0 and the recombination weights undefined
+        logWarn("CMA-ES needs at least 2 candidates per generation, using %zu", lambda);
+    }
+    weights.resize(mu);
+    double sum = 0.;
+    for (size_t i = 0; i < mu; ++i) {
+        weights[i] = log(static_cast<double>(lambda) / 2. + 0.5) - log(static_cast<double>(i + 1));
+        sum += weights[i];
+    }
+    double sumSq = 0.;
+    for (size_t i = 0; i < mu; ++i) {
+        weights[i] /= sum;
+        sumSq += weights[i] * weights[i];
+    }
+    mueff = 1. / sumSq;
+
+    const double N = static_cast<double>(n);
+    cc = (4. + mueff / N) / (N + 4. + 2. * mueff / N);
+    cs = (mueff + 2.) / (N + mueff + 5.);
+    c1 = 2. / ((N + 1.3) * (N + 1.3) + mueff);
+    cmu = std::min(1. - c1, 2. * (mueff - 2. + 1. / mueff) / ((N + 2.) * (N + 2.) + mueff));
+    damps = 1. + 2. * std::max(0., sqrt((mueff - 1.) / (N + 1.)) - 1.) + cs;
+    chiN = sqrt(N) * (1. - 1. / (4. * N) + 1. / (21. * N * N));
+
+    for (size_t i = 0; i < n; ++i) {
+        C[i][i] = 1.;
+        B[i][i] = 1.;
+    }
+}
+
+CmaEs::~CmaEs() {
+}
+
+double CmaEs::randomNormal(unsigned int& seed) {
+    // shift by 1 to avoid log(0)
+    const double u1 = (static_cast<double>(rand_r(&seed)) + 1.) / (static_cast<double>(RAND_MAX) + 1.);
+    const double u2 = static_cast<double>(rand_r(&seed)) / (static_cast<double>(RAND_MAX) + 1.);
+    return sqrt(-2. * log(u1)) * cos(2. * M_PI * u2);
+}
+
+void CmaEs::samplePopulation(unsigned int& seed) {
+    Vector z(n);
+    for (size_t k = 0; k < lambda; ++k) {
+        for (size_t i = 0; i < n; ++i) {
+            z[i] = D[i] * randomNormal(seed);
+        }
+        // x = m + sigma * B * D * z
+        for (size_t i = 0; i < n; ++i) {
+            double y = 0.;
+            for (size_t j = 0; j < n; ++j) {
+                y += B[i][j] * z[j];
+            }
+            population[k][i] = mean[i] + sigma * y;
+        }
+    }
+}
+
+void CmaEs::update(const std::vector<double>& fitness) {
+    if (fitness.size() != lambda) {
+        logError("CmaEs::update expected %zu fitness values, got %zu", lambda, fitness.size());
+        return;
+    }
+    std::vector<size_t> order(lambda);
+    for (size_t k = 0; k < lambda; ++k) {
+        order[k] = k;
+    }
+    std::stable_sort(order.begin(), order.end(), ByFitness(fitness));
+
+    // Recombination
+    const Vector oldMean(mean);
+    for (size_t i = 0; i < n; ++i) {
+        mean[i] = 0.;
+        for (size_t k = 0; k < mu; ++k) {
+            mean[i] += weights[k] * population[order[k]][i];
+        }
+    }
+    Vector step(n);
+    for (size_t i = 0; i < n; ++i) {
+        step[i] = (mean[i] - oldMean[i]) / sigma;
+    }
+
+    // Step size path: ps = (1 - cs) ps + sqrt(cs (2 - cs) mueff) C^-1/2 step
+    Vector bTStep(n, 0.);
+    for (size_t j = 0; j < n; ++j) {
+        for (size_t i = 0; i < n; ++i) {
+            bTStep[j] += B[i][j] * step[i];
+        }
+        bTStep[j] /= D[j];
+    }
+    const double csFactor = sqrt(cs * (2. - cs) * mueff);
+    double psNorm = 0.;
+    for (size_t i = 0; i < n; ++i) {
+        double v = 0.;
+        for (size_t j = 0; j < n; ++j) {
+            v += B[i][j] * bTStep[j];
+        }
+        ps[i] = (1. - cs) * ps[i] + csFactor * v;
+        psNorm += ps[i] * ps[i];
+    }
+    psNorm = sqrt(psNorm);
+    ++generation;
+    const double hsig = psNorm / sqrt(1. - pow(1. - cs, 2. * generation)) / chiN < 1.4 + 2. / (n + 1.) ? 1. : 0.;
+
+    // Covariance path
+    const double ccFactor = hsig * sqrt(cc * (2. - cc) * mueff);
+    for (size_t i = 0; i < n; ++i) {
+        pc[i] = (1. - cc) * pc[i] + ccFactor * step[i];
+    }
+
+    // Rank-one and rank-mu update
+    const double oldWeight = 1. - c1 - cmu + (1. - hsig) * c1 * cc * (2. - cc);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j <= i; ++j) {
+            double rankMu = 0.;
+            for (size_t k = 0; k < mu; ++k) {
+                const Vector& x = population[order[k]];
+                rankMu += weights[k] * (x[i] - oldMean[i]) * (x[j] - oldMean[j]);
+            }
+            C[i][j] = oldWeight * C[i][j] + c1 * pc[i] * pc[j] + cmu * rankMu / (sigma * sigma);
+            C[j][i] = C[i][j];
+        }
+    }
+
+    sigma *= exp((cs / damps) * (psNorm / chiN - 1.));
+    decompose();
+}
+
+void CmaEs::decompose() {
+    Matrix a(C);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            B[i][j] = i == j ? 1. : 0.;
+        }
+    }
+    for (size_t sweep = 0; sweep < 50; ++sweep) {
+        double offDiagonal = 0.;
+        for (size_t p = 0; p < n; ++p) {
+            for (size_t q = p + 1; q < n; ++q) {
+                offDiagonal += a[p][q] * a[p][q];
+            }
+        }
+        if (offDiagonal < 1e-24) {
+            break;
+        }
+        for (size_t p = 0; p < n; ++p) {
+            for (size_t q = p + 1; q < n; ++q) {
+                if (fabs(a[p][q]) < std::numeric_limits<double>::min()) {
+                    continue;
+                }
+                // Rotation that annihilates a[p][q]
+                const double theta = (a[q][q] - a[p][p]) / (2. * a[p][q]);
+                const double t = (theta >= 0. ? 1. : -1.) / (fabs(theta) + sqrt(theta * theta + 1.));
+                const double c = 1. / sqrt(t * t + 1.);
+                const double s = t * c;
+                for (size_t k = 0; k < n; ++k) {
+                    const double akp = a[k][p];
+                    const double akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (size_t k = 0; k < n; ++k) {
+                    const double apk = a[p][k];
+                    const double aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (size_t k = 0; k < n; ++k) {
+                    const double bkp = B[k][p];
+                    const double bkq = B[k][q];
+                    B[k][p] = c * bkp - s * bkq;
+                    B[k][q] = s * bkp + c * bkq;
+                }
+            }
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        // Guard against loss of positive definiteness by rounding
+        D[i] = sqrt(std::max(a[i][i], 1e-20));
+    }
+}
+
+} /* namespace gpu_coverage */
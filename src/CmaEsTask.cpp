@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#include <gpu_coverage/CmaEsTask.h>
+#include <gpu_coverage/CmaEs.h>
+#include <gpu_coverage/VisibilityRenderer.h>
+#include <gpu_coverage/Config.h>
+#include <gpu_coverage/Utilities.h>
+#include <gpu_coverage/Channel.h>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <sys/mman.h>
+
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS true
+#endif
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/matrix_access.hpp>
+
+namespace gpu_coverage {
+
+CmaEsTask::TaskSharedData *CmaEsTask::taskSharedData = NULL;
+SharedBest *CmaEsTask::sharedBest = NULL;
+size_t CmaEsTask::sharedDataSize = 0;
+
+// Sampling range of the camera position, same as RobotSceneConfiguration::setRandomCameraPosition()
+static const float positionRange = 10.8f;
+// Camera pitch range, same as in HillclimbingTask
+static const float minPitch = glm::radians(20.f);
+static const float maxPitch = glm::radians(160.f);
+
+CmaEsTask::CmaEsTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData,
+        const size_t numIterations)
+        : AbstractTask(sharedData, threadNr), scene(scene),
+          numIterations(numIterations), numArticulations(scene->getChannels().size()),
+          numGenerations(std::max(Config::getInstance().getParam<int>("cmaesGenerations"), 1)),
+          populationSize(std::max(Config::getInstance().getParam<int>("cmaesPopulation"), 0)),
+          initialSigma(Config::getInstance().getParam<float>("cmaesSigma")),
+          visibilityRenderer(NULL)
+{
+    if (!sharedBest) {
+        // Too many workers for the shared reduction, see SharedBest::create()
+        return;
+    }
+    const float height1 = Config::getInstance().getParam<float>("minCameraHeight");
+    const float height2 = Config::getInstance().getParam<float>("maxCameraHeight");
+    minCameraHeight = std::min(height1, height2);
+    maxCameraHeight = std::max(height1, height2);
+
+    cameraNode = scene->findNode(Config::getInstance().getParam<std::string>("robotCamera"));
+    if (!cameraNode) {
+        logError("Could not find robot camera");
+        return;
+    }
+
+    // Only the visibility is needed to evaluate candidates, see RobotSceneConfiguration::getEvaluation()
+    visibilityRenderer = new VisibilityRenderer(scene, false, true);
+    if (!visibilityRenderer->isReady()) {
+        return;
+    }
+
+    std::stringstream targets(Config::getInstance().getParam<std::string>("target"));
+    size_t targetI = 0;
+    while (targets.good()) {
+        std::string targetName;
+        targets >> targetName;
+        if (!targetName.empty()) {
+            const Node * const target = scene->findNode(targetName);
+            targetTexture[targetI] = target->getMeshes().front()->getMaterial()->getTexture()->getTextureObject();
+            ++targetI;
+        }
+    }
+    numTargetTextures = targetI;
+
+    if (threadNr == 0) {
+        // First thread initializes current robot pose and articulation
+        taskSharedData->bestEval = -std::numeric_limits<float>::max();
+        for (size_t a = 0; a < numArticulations; ++a) {
+            taskSharedData->currentConfiguration.setArticulation(a, 0.f);
+        }
+        taskSharedData->currentConfiguration.setCameraLocalTransform(cameraNode->getLocalTransform());
+        taskSharedData->currentConfiguration.setCount(0);
+        taskSharedData->finished = false;
+        taskSharedData->failed = false;
+    }
+
+    ready = true;
+}
+
+CmaEsTask::~CmaEsTask() {
+    delete visibilityRenderer;
+}
+
+void CmaEsTask::encode(const RobotSceneConfiguration& configuration, std::vector<double>& x) const {
+    x.resize(getDimension());
+    for (size_t a = 0; a < numArticulations; ++a) {
+        x[a] = configuration.getArticulation(a);
+    }
+    const glm::mat4& transform = configuration.getCameraLocalTransform();
+    const glm::vec3 eye(glm::column(transform, 3));
+    // The camera looks along its negative z axis
+    const glm::vec3 look(glm::normalize(-glm::vec3(glm::column(transform, 2))));
+    double yaw = atan2(look.y, look.x);
+    if (yaw < 0.) {
+        yaw += 2. * M_PI;
+    }
+    const double pitch = acos(std::min(1.f, std::max(-1.f, look.z)));
+    x[numArticulations + 0] = eye.x / positionRange + 0.5;
+    x[numArticulations + 1] = eye.y / positionRange + 0.5;
+    x[numArticulations + 2] = maxCameraHeight - minCameraHeight > 1e-4 ?
+            (eye.z - minCameraHeight) / (maxCameraHeight - minCameraHeight) : 0.5;
+    x[numArticulations + 3] = yaw / (2. * M_PI);
+    x[numArticulations + 4] = (pitch - minPitch) / (maxPitch - minPitch);
+    for (size_t i = 0; i < x.size(); ++i) {
+        x[i] = std::min(1., std::max(0., x[i]));
+    }
+}
+
+void CmaEsTask::decode(const std::vector<double>& x, RobotSceneConfiguration& configuration) const {
+    std::vector<float> v(x.size());
+    for (size_t i = 0; i < x.size(); ++i) {
+        v[i] = std::min(1.f, std::max(0.f, static_cast<float>(x[i])));
+    }
+    for (size_t a = 0; a < numArticulations; ++a) {
+        configuration.setArticulation(a, v[a]);
+    }
+    // yaw is periodic and not clamped
+    const float yaw = static_cast<float>(x[numArticulations + 3] - floor(x[numArticulations + 3])) * 2.f * M_PI;
+    const float pitch = minPitch + v[numArticulations + 4] * (maxPitch - minPitch);
+    const glm::vec3 eye((v[numArticulations + 0] - 0.5f) * positionRange,
+            (v[numArticulations + 1] - 0.5f) * positionRange,
+            minCameraHeight + v[numArticulations + 2] * (maxCameraHeight - minCameraHeight));
+    static const glm::vec3 worldUp(0.f, 0.f, -1.f);
+    const glm::vec3 look(sin(pitch) * cos(yaw), sin(pitch) * sin(yaw), cos(pitch));
+    const glm::vec3 right(glm::cross(look, worldUp));
+    const glm::vec3 up(glm::cross(look, right));
+    configuration.setCameraLocalTransform(glm::inverse(glm::lookAt(eye, eye + look, up)));
+}
+
+size_t CmaEsTask::search(RobotSceneConfiguration& bestConfiguration, float& bestEval) {
+    std::vector<double> mean;
+    encode(taskSharedData->currentConfiguration, mean);
+    CmaEs cmaes(mean, initialSigma, populationSize);
+    std::vector<double> fitness(cmaes.getPopulationSize());
+    std::vector<GLuint> visibilityResults;
+    RobotSceneConfiguration candidate;
+    size_t numRenders = 0;
+
+    for (size_t g = 0; g < numGenerations; ++g) {
+        // Render the whole generation as one batch, read back once
+        cmaes.samplePopulation(seed);
+        for (size_t k = 0; k < cmaes.getPopulationSize(); ++k) {
+            decode(cmaes.getCandidate(k), candidate);
+            candidate.applyToScene(scene);
+            cameraNode->setLocalTransform(candidate.getCameraLocalTransform());
+            visibilityRenderer->display();
+        }
+        visibilityRenderer->getPixelCounts(visibilityResults);
+        if (visibilityResults.size() != cmaes.getPopulationSize()) {
+            logError("Visibility results count does not match population size");
+            taskSharedData->failed = true;
+            return 0;
+        }
+        numRenders += visibilityResults.size();
+
+        for (size_t k = 0; k < cmaes.getPopulationSize(); ++k) {
+            decode(cmaes.getCandidate(k), candidate);
+            candidate.setCount(visibilityResults[k]);
+            const float eval = candidate.getEvaluation(taskSharedData->currentConfiguration);
+            fitness[k] = eval;
+            if (eval > bestEval) {
+                bestEval = eval;
+                bestConfiguration.set(candidate);
+            }
+        }
+        cmaes.update(fitness);
+    }
+    return numRenders;
+}
+
+void CmaEsTask::run() {
+    if (!ready) {
+        return;
+    }
+    RobotSceneConfiguration bestConfiguration;
+
+    for (size_t i = 0; i < numIterations; ++i) {
+        float bestEval = -std::numeric_limits<float>::max();
+        const size_t numRenders = search(bestConfiguration, bestEval);
+
+        // Publish best result without taking the mutex
+        if (numRenders > 0) {
+            sharedBest->publish(threadNr, bestConfiguration, bestEval, 0);
+        }
+
+        // Wait for other threads
+        pthread_barrier_wait(&sharedData->barrier);
+
+        // Set best configuration of all threads to the new current configuration
+        if (threadNr == 0) {
+            if (!sharedBest->getBest(taskSharedData->bestConfiguration, taskSharedData->bestEval)) {
+                taskSharedData->bestEval = -std::numeric_limits<float>::max();
+            }
+            if (i == 0) {
+                std::cout << "#iteration\trenders\tcoverage\tcost\tgain\tevaluation\tx\ty\tz";
+                for (size_t a = 0; a < numArticulations; ++a) {
+                    std::cout << "\t" << scene->getChannels()[a]->getNode()->getName();
+                }
+                std::cout << std::endl;
+            }
+            const glm::vec3 position(glm::column(taskSharedData->bestConfiguration.getCameraLocalTransform(), 3));
+            std::cout << i << "\t" << numRenders * sharedData->numThreads << "\t"
+                    << taskSharedData->bestConfiguration.getCount() << "\t"
+                    << taskSharedData->bestConfiguration.getCost(taskSharedData->currentConfiguration) << "\t"
+                    << taskSharedData->bestConfiguration.getGain(taskSharedData->currentConfiguration) << "\t"
+                    << taskSharedData->bestEval << "\t"
+                    << position.x << "\t" << position.y << "\t" << position.z;
+            for (size_t a = 0; a < numArticulations; ++a) {
+                std::cout << "\t" << taskSharedData->bestConfiguration.getArticulation(a);
+            }
+            std::cout << std::endl;
+
+            taskSharedData->currentConfiguration.set(taskSharedData->bestConfiguration);
+            if (taskSharedData->bestEval < 0.f) {
+                taskSharedData->finished = true;
+            }
+            taskSharedData->bestEval = -std::numeric_limits<float>::max();
+            sharedBest->reset();
+        }
+
+        // Wait for other threads
+        pthread_barrier_wait(&sharedData->barrier);
+
+        // A failed worker has still reached the barriers, so all workers stop here together
+        if (taskSharedData->finished || taskSharedData->failed) {
+            break;
+        }
+
+        // Re-render best visibility texture
+        cameraNode->setLocalTransform(taskSharedData->currentConfiguration.getCameraLocalTransform());
+        taskSharedData->currentConfiguration.applyToScene(scene);
+        visibilityRenderer->display();
+        std::vector<GLuint> pixelCounts;
+        visibilityRenderer->getPixelCounts(pixelCounts);
+        if (pixelCounts[0] != taskSharedData->currentConfiguration.getCount()) {
+            logError("Error: pixel count of best configuration differs: %u != %u", pixelCounts[0],
+                    taskSharedData->currentConfiguration.getCount());
+        }
+
+        // Copy to original texture
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        for (size_t t = 0; t < numTargetTextures; ++t) {
+            glCopyImageSubData(visibilityRenderer->getTexture(t), GL_TEXTURE_2D, 0, 0, 0, 0, targetTexture[t], GL_TEXTURE_2D, 0,
+                    0, 0, 0, visibilityRenderer->getTextureWidth(), visibilityRenderer->getTextureHeight(), 1);
+        }
+
+        // Wait for other threads
+        pthread_barrier_wait(&sharedData->barrier);
+    }
+}
+
+size_t CmaEsTask::sharedBestOffset() {
+    // SharedBest contains 64 bit words, align it to 8 bytes
+    const size_t offset = sizeof(TaskSharedData) + 2 * RobotSceneConfiguration::numArticulation * sizeof(float);
+    return (offset + 7) & ~static_cast<size_t>(7);
+}
+
+void CmaEsTask::allocateSharedData(const size_t numThreads) {
+    if (!taskSharedData) {
+        sharedDataSize = sharedBestOffset() + SharedBest::getSize(numThreads);
+        taskSharedData = (TaskSharedData *) mmap(NULL, sharedDataSize,
+                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        taskSharedData->bestConfiguration.articulation = reinterpret_cast<float*>(taskSharedData + 1);
+        taskSharedData->currentConfiguration.articulation = taskSharedData->bestConfiguration.articulation
+                + RobotSceneConfiguration::numArticulation;
+        sharedBest = SharedBest::create(reinterpret_cast<char*>(taskSharedData) + sharedBestOffset(), numThreads);
+    }
+}
+
+void CmaEsTask::freeSharedData() {
+    if (taskSharedData) {
+        munmap(taskSharedData, sharedDataSize);
+        taskSharedData = NULL;
+        sharedBest = NULL;
+    }
+}
+
+} /* namespace gpu_coverage */
@@ -70,6 +70,28 @@ Config::Config(const std::string& filename)
     params["floorProjection"] = new Param<std::string>("floorProjection", "Name of the floor projection node", "floorProjection");
     params["projectionPlane"] = new Param<std::string>("projectionPlane",
             "Name of the plane node onto which the costmap is projected", "Plane");
+    params["bayesOptBatchSize"] = new Param<int>("bayesOptBatchSize",
+            "Number of candidates each worker renders per round of the bayesopt task", 4);
+    params["bayesOptCandidates"] = new Param<int>("bayesOptCandidates",
+            "Number of random candidates scored by the expected improvement for each proposal of the bayesopt task",
+            1000);
+    params["bayesOptLengthScale"] = new Param<float>("bayesOptLengthScale",
+            "Kernel length scale of the bayesopt surrogate in the normalized search space", 0.2f);
+    params["bayesOptRounds"] = new Param<int>("bayesOptRounds",
+            "Number of rounds per iteration of the bayesopt task, including the random first round", 10);
+    params["beamWidth"] = new Param<int>("beamWidth",
+            "Number of partial view sequences kept in every step of the beamsearch task", 4);
+    params["checkpointFile"] = new Param<std::string>("checkpointFile",
+            "File for checkpoints of random search and hillclimbing, with the suffix .frames for the utility map",
+            "checkpoint.bin");
+    params["checkpointInterval"] = new Param<int>("checkpointInterval",
+            "Write a checkpoint every n search iterations and resume from it on start, 0 to disable", 0);
+    params["cmaesGenerations"] = new Param<int>("cmaesGenerations",
+            "Number of CMA-ES generations per iteration of the cmaes task", 20);
+    params["cmaesPopulation"] = new Param<int>("cmaesPopulation",
+            "Number of candidates per CMA-ES generation (at least 2), 0 for the default 4 + 3 ln(n)", 0);
+    params["cmaesSigma"] = new Param<float>("cmaesSigma",
+            "Initial CMA-ES step size in the search space normalized to [0, 1]", 0.3);
     params["costCameraHeightChange"] = new Param<float>("costCameraHeightChange",
             "Costs for changing the camera height above the ground", 0.1);
     params["costDistance"] = new Param<float>("costDistance", "Costs for the robot walking", 0.1);
@@ -77,7 +99,80 @@ Config::Config(const std::string& filename)
     params["maxCameraHeight"] = new Param<float>("minCameraHeight", "Minimum camera height above the ground", 0.6);
     params["gainFactor"] = new Param<float>("gainFactor",
             "Scaling factor for the information gain when evaluating pose", 1e-4);
+    params["frameChunkTime"] = new Param<float>("frameChunkTime",
+            "Target duration in seconds of the frame chunks handed out to the threads, 0 for one chunk per thread", 0.f);
+    params["multiRobotCount"] = new Param<int>("multiRobotCount", "Number of robots of the multi-robot task", 2);
+    params["multiRobotStarts"] = new Param<std::string>("multiRobotStarts",
+            "Start positions \"x y x y ...\" of the robots of the multi-robot task, the other robots start at the robot camera", "");
     params["panoSemantic"] = new Param<bool>("panoSemantic", "Render panorama with semantic colors", true);
+    params["panoEvalFused"] = new Param<bool>("panoEvalFused",
+            "Evaluate panoramas directly from the cube map in a single compute pass per camera", false);
+    params["panoEvalVerify"] = new Param<bool>("panoEvalVerify",
+            "Recompute the gain and utility maps of every panorama pair on the CPU and log the largest difference", false);
+    params["panoIntegralBits"] = new Param<int>("panoIntegralBits",
+            "Bits per channel of the panorama integral images (16 or 32), 16 falls back to 32 if the panorama is too large",
+            16);
+    params["panoOrientationSearch"] = new Param<bool>("panoOrientationSearch",
+            "Score all camera orientations at a position from a single panorama instead of one rendering per orientation",
+            false);
+    params["poseCacheFile"] = new Param<std::string>("poseCacheFile",
+            "File in which the pose evaluation cache is kept between runs of the same scene", "posecache.bin");
+    params["poseCachePersistent"] = new Param<bool>("poseCachePersistent",
+            "Load the pose evaluation cache at start and save it at the end of a run", false);
+    params["poseCacheSize"] = new Param<int>("poseCacheSize",
+            "Number of pixel counts of evaluated poses cached for all workers, 0 to disable. "
+            "Only hit by runs that repeat the views of an earlier run, see poseCachePersistent", 0);
+    params["randomSearchPipelined"] = new Param<bool>("randomSearchPipelined",
+            "Evaluate the candidates of one articulation batch while the next batch is rendered", false);
+    params["randomSearchPruning"] = new Param<bool>("randomSearchPruning",
+            "Discard candidates on cells unreachable for the robot or whose costs exceed any possible gain before rendering them",
+            false);
+    params["reverseDepthResolution"] = new Param<int>("reverseDepthResolution",
+            "Resolution of the depth map rendered from every target patch for reverse visibility", 256);
+    params["reversePatchResolution"] = new Param<int>("reversePatchResolution",
+            "Resolution of the patch atlas for reverse visibility, every covered texel is one target patch", 32);
+    params["sampler"] = new Param<std::string>("sampler",
+            "Sampler for random candidate poses: random, halton, sobol or lhs (Latin hypercube)", "random");
+    params["samplerFreeSpace"] = new Param<bool>("samplerFreeSpace",
+            "Reject candidate poses on obstacles of the cost map before rendering them", false);
+    params["spsaPerturbation"] = new Param<float>("spsaPerturbation",
+            "Initial perturbation of the SPSA task in the normalized search space", 0.02f);
+    params["spsaStarts"] = new Param<int>("spsaStarts",
+            "Number of gradient ascents per worker of the SPSA task, rendered as one batch", 4);
+    params["spsaStepSize"] = new Param<float>("spsaStepSize",
+            "Initial change of every entry per step of the sign-SPSA task in the normalized search space", 0.05f);
+    params["spsaSteps"] = new Param<int>("spsaSteps",
+            "Number of gradient steps per iteration of the SPSA task", 50);
+    params["temperingChains"] = new Param<int>("temperingChains",
+            "Number of chains per worker of the tempering task, rendered as one batch", 4);
+    params["temperingExchangeInterval"] = new Param<int>("temperingExchangeInterval",
+            "Number of sweeps between replica exchanges of the tempering task", 5);
+    params["temperingMaxTemperature"] = new Param<float>("temperingMaxTemperature",
+            "Temperature of the hottest chain of the tempering task, in units of the evaluation", 1.f);
+    params["temperingMinTemperature"] = new Param<float>("temperingMinTemperature",
+            "Temperature of the coldest chain of the tempering task, in units of the evaluation", 0.01f);
+    params["temperingStepSize"] = new Param<float>("temperingStepSize",
+            "Maximum camera pose change of a move of the tempering task in the normalized search space", 0.1f);
+    params["temperingSweeps"] = new Param<int>("temperingSweeps",
+            "Number of sweeps per iteration of the tempering task", 50);
+    params["timeBudget"] = new Param<float>("timeBudget",
+            "Time in seconds after which random search and hillclimbing stop and keep their best plan so far, 0 for no limit", 0.f);
+    params["topUtilities"] = new Param<int>("topUtilities",
+            "Number of best utility map cells per articulation considered as robot positions", 10);
+    params["topUtilitySpacing"] = new Param<int>("topUtilitySpacing",
+            "Minimum distance between the best utility map cells in cells, 0 to disable", 0);
+    params["utilityMapAdaptive"] = new Param<bool>("utilityMapAdaptive",
+            "Render the utility map on a coarse grid, refine it where needed and interpolate the remaining cells", false);
+    params["utilityMapBaseStep"] = new Param<int>("utilityMapBaseStep",
+            "Spacing of the coarse grid of the adaptive utility map in cells", 16);
+    params["utilityMapErrorSamples"] = new Param<int>("utilityMapErrorSamples",
+            "Number of interpolated cells rendered per frame to estimate the error of the adaptive utility map", 64);
+    params["utilityMapGainThreshold"] = new Param<int>("utilityMapGainThreshold",
+            "Refine a cell of the adaptive utility map if the gain utilities of its corners differ by more than this", 20);
+    params["utilityMapReverse"] = new Param<bool>("utilityMapReverse",
+            "Render the utility map gains from the target patches instead of from every cell", false);
+    params["utilityMapValueThreshold"] = new Param<int>("utilityMapValueThreshold",
+            "Refine a cell of the adaptive utility map if the utility at one of its corners exceeds this", 100);
     load();
 }
 
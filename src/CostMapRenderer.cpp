@@ -283,4 +283,24 @@ void CostMapRenderer::display() {
     glPopDebugGroup();
 }
 
+void CostMapRenderer::getCosts(std::vector<GLint>& costs) const {
+    costs.resize(width * height);
+    glBindTexture(GL_TEXTURE_2D, textures[OUTPUT]);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED_INTEGER, GL_INT, &costs[0]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    checkGLError();
+}
+
+bool CostMapRenderer::getPixel(const glm::vec3& position, size_t& index) const {
+    const glm::vec4 ndc = camera->getProjectionMatrix() * glm::inverse(cameraNode->getWorldTransform())
+            * glm::vec4(position, 1.f);
+    const int x = static_cast<int>(floor((ndc.x + 1.f) * 0.5f * width));
+    const int y = static_cast<int>(floor((ndc.y + 1.f) * 0.5f * height));
+    if (x < 0 || x >= width || y < 0 || y >= height) {
+        return false;
+    }
+    index = y * width + x;
+    return true;
+}
+
 } /* namespace gpu_coverage */
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#include <gpu_coverage/GaussianProcess.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace gpu_coverage {
+
+GaussianProcess::GaussianProcess(const size_t dimension, const double lengthScale, const double noise)
+        : dimension(dimension), lengthScale(lengthScale), noise(noise), priorMean(0.), priorScale(1.) {
+}
+
+GaussianProcess::~GaussianProcess() {
+}
+
+void GaussianProcess::clear() {
+    points.clear();
+    values.clear();
+    cholesky.clear();
+    z.clear();
+}
+
+void GaussianProcess::setPrior(const double mean, const double scale) {
+    priorMean = mean;
+    priorScale = scale > 0. ? scale : 1.;
+}
+
+double GaussianProcess::kernel(const double * const a, const double * const b) const {
+    double squaredDistance = 0.;
+    for (size_t d = 0; d < dimension; ++d) {
+        const double delta = a[d] - b[d];
+        squaredDistance += delta * delta;
+    }
+    return exp(-0.5 * squaredDistance / (lengthScale * lengthScale));
+}
+
+void GaussianProcess::solve(const double * const x, std::vector<double>& result) const {
+    // forward substitution, row i of L starts at i * (i + 1) / 2
+    const size_t n = values.size();
+    result.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        const double * const row = &cholesky[i * (i + 1) / 2];
+        double sum = kernel(&points[i * dimension], x);
+        for (size_t j = 0; j < i; ++j) {
+            sum -= row[j] * result[j];
+        }
+        result[i] = sum / row[i];
+    }
+}
+
+bool GaussianProcess::add(const std::vector<double>& x, const double y) {
+    // new row of L: solve L l = k(X, x), diagonal element from the Schur complement
+    std::vector<double> row;
+    solve(&x[0], row);
+    double diagonal = 1. + noise;
+    double zy = (y - priorMean) / priorScale;
+    for (size_t j = 0; j < row.size(); ++j) {
+        diagonal -= row[j] * row[j];
+        zy -= row[j] * z[j];
+    }
+    if (diagonal <= 1e-12) {
+        return false;
+    }
+    diagonal = sqrt(diagonal);
+    cholesky.insert(cholesky.end(), row.begin(), row.end());
+    cholesky.push_back(diagonal);
+    z.push_back(zy / diagonal);
+    points.insert(points.end(), x.begin(), x.end());
+    values.push_back((y - priorMean) / priorScale);
+    return true;
+}
+
+void GaussianProcess::predict(const std::vector<double>& x, double& mean, double& variance) const {
+    solve(&x[0], v);
+    double m = 0.;
+    double var = 1.;
+    for (size_t i = 0; i < v.size(); ++i) {
+        m += v[i] * z[i];
+        var -= v[i] * v[i];
+    }
+    mean = priorMean + priorScale * m;
+    variance = priorScale * priorScale * std::max(var, 0.);
+}
+
+double GaussianProcess::expectedImprovement(const std::vector<double>& x, const double best) const {
+    double mean, variance;
+    predict(x, mean, variance);
+    const double sigma = sqrt(variance);
+    const double improvement = mean - best;
+    if (sigma < 1e-12) {
+        return std::max(improvement, 0.);
+    }
+    const double u = improvement / sigma;
+    const double cdf = 0.5 * erfc(-u / M_SQRT2);
+    const double pdf = exp(-0.5 * u * u) / sqrt(2. * M_PI);
+    return improvement * cdf + sigma * pdf;
+}
+
+} /* namespace gpu_coverage */
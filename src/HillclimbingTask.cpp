@@ -35,9 +35,12 @@
 #include <gpu_coverage/Renderer.h>
 #include <gpu_coverage/PanoRenderer.h>
 #include <gpu_coverage/PanoEvalRenderer.h>
+#include <gpu_coverage/PanoVisibilityRenderer.h>
 #include <gpu_coverage/Config.h>
 #include <gpu_coverage/Utilities.h>
 #include <gpu_coverage/Channel.h>
+#include <gpu_coverage/Checkpoint.h>
+#include <gpu_coverage/PoseCache.h>
 
 #include <vector>
 #include <algorithm>
@@ -59,12 +62,26 @@
 namespace gpu_coverage {
 
 HillclimbingTask::TaskSharedData *HillclimbingTask::taskSharedData = NULL;
+SharedBest *HillclimbingTask::sharedBest = NULL;
+PoseCache *HillclimbingTask::poseCache = NULL;
+HillclimbingTask::Utilities *HillclimbingTask::sharedUtilities = NULL;
+size_t HillclimbingTask::maxSharedUtilities = 0;
+size_t HillclimbingTask::sharedDataSize = 0;
 
 HillclimbingTask::HillclimbingTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData)
         : AbstractTask(sharedData, threadNr), scene(scene),
           numIterations(100),
-          numArticulations(scene->getChannels().size())
+          numArticulations(scene->getChannels().size()),
+          numTopUtilities(Config::getInstance().getParam<int>("topUtilities")),
+          topUtilitySpacing(Config::getInstance().getParam<int>("topUtilitySpacing")),
+          panoVisibilityRenderer(NULL),
+          checkpointInterval(std::max(Config::getInstance().getParam<int>("checkpointInterval"), 0)),
+          checkpoint(NULL), coverageState(0)
 {
+    if (!sharedBest) {
+        // Too many workers for the shared reduction, see SharedBest::create()
+        return;
+    }
     // Get scene nodes
     Node * const projectionPlane = scene->findNode(Config::getInstance().getParam<std::string>("projectionPlane"));
     Material * const costmapMaterial = projectionPlane->getMeshes().front()->getMaterial();
@@ -87,6 +104,25 @@ HillclimbingTask::HillclimbingTask(Scene * const scene, const size_t threadNr, S
     if (!visibilityRenderer->isReady()) {
         return;
     }
+    if (Config::getInstance().getParam<bool>("panoOrientationSearch")) {
+        if (cameraNode->getCameras().empty()) {
+            logError("Robot camera node %s has no camera", cameraNode->getName().c_str());
+            return;
+        }
+        const AbstractCamera * const robotCamera = cameraNode->getCameras()[0];
+        panoVisibilityRenderer = new PanoVisibilityRenderer(scene, scene->makePanoramaCamera(cameraNode), robotCamera);
+        if (!panoVisibilityRenderer->isReady()) {
+            return;
+        }
+        coverageState = PoseCache::getSceneState("hillclimbing", robotCamera->getProjectionMatrix(),
+                panoVisibilityRenderer->getTextureWidth(), panoVisibilityRenderer->getTextureHeight());
+    } else {
+        const CameraPerspective * const robotCamera = scene->findCamera(
+                Config::getInstance().getParam<std::string>("robotCamera"));
+        coverageState = PoseCache::getSceneState("hillclimbing",
+                robotCamera ? robotCamera->getProjectionMatrix() : glm::mat4(),
+                visibilityRenderer->getTextureWidth(), visibilityRenderer->getTextureHeight());
+    }
 #ifdef WRITE_VISUALIZATION_DATA
     renderer = new Renderer(scene, false, true);
     if (!renderer->isReady()) {
@@ -159,70 +195,92 @@ HillclimbingTask::HillclimbingTask(Scene * const scene, const size_t threadNr, S
     if (threadNr == 0) {
         // First thread initializes current robot pose and articulation
         taskSharedData->bestEval = -std::numeric_limits<float>::max();
-        taskSharedData->currentConfiguration.setArticulation(0, 0.f);
+        taskSharedData->numUtilities = 0;
+        for (size_t a = 0; a < numArticulations; ++a) {
+            taskSharedData->currentConfiguration.setArticulation(a, 0.f);
+        }
         taskSharedData->currentConfiguration.setCameraLocalTransform(cameraNode->getLocalTransform());
         taskSharedData->currentConfiguration.setCount(0);
         taskSharedData->finished = false;
     }
+    if (checkpointInterval > 0) {
+        checkpoint = new Checkpoint(Config::getInstance().getParam<std::string>("checkpointFile"), "hillclimbing");
+    }
 
     ready = true;
 }
 
 HillclimbingTask::~HillclimbingTask() {
+    delete checkpoint;
     delete costmapRenderer;
     delete bellmanFordRenderer;
     delete visibilityRenderer;
+    if (panoVisibilityRenderer) {
+        delete panoVisibilityRenderer;
+    }
     delete costmapTexture;
 }
 
-struct Utilities {
-     int a, x, y, utility;
-     Utilities(const int a, const int x, const int y, const int utility) : a(a), x(x), y(y), utility(utility) {}
-     bool operator<(const Utilities& other) const {
-         return utility < other.utility;
-     }
- };
-
 void HillclimbingTask::run() {
     if (!ready) {
         return;
     }
     const int width = bellmanFordRenderer->getTextureWidth();
     const int height = bellmanFordRenderer->getTextureHeight();
-    GLint utilitymap[width * height];
+    std::vector<PanoEvalRenderer::UtilityCell> topUtilities;
     cv::Mat utilitymapCV(height, width, CV_8UC3);
     cv::Mat flipCV(height, width, CV_8UC3);
     struct timespec curTime;
     clock_gettime(CLOCK_MONOTONIC, &curTime);
     double lastTime = static_cast<double>(curTime.tv_sec) + static_cast<double>(curTime.tv_nsec) * 1e-9;;
+    // Measured stage timings for fitting the iterations into the time budget
+    double cellTime = 0.;       // rendering and evaluating all orientations at one utility cell
+    double tailTime = 0.;       // reduction and re-rendering of the best candidate
+
+    size_t firstIteration = 0;
+    if (checkpoint) {
+        if (checkpoint->load()) {
+            if (!resume(firstIteration)) {
+                logError("Could not resume from checkpoint, delete it to start over");
+                return;
+            }
+            logInfo("[%zu] Resuming at iteration %zu", threadNr, firstIteration);
+        }
+        pthread_barrier_wait(&sharedData->barrier);
+    }
 
-    for (size_t i = 0; i < numIterations; ++i) {
+    for (size_t i = firstIteration; i < numIterations; ++i) {
+        const double iterationStart = getTime();
+        if (checkpoint && threadNr == 0) {
+            // Write the last checkpoint as soon as its textures have arrived
+            checkpoint->poll();
+        }
+        const double iterationEnd = getSliceEnd(numIterations - i);
         bellmanFordRenderer->setRobotPosition(taskSharedData->currentConfiguration.getCameraLocalTransform());
         std::vector<RobotSceneConfiguration *> configurations1;
         configurations1.reserve(numArticulations);
-        GLint highestUtility = 100000;
+        const GLint highestUtility = 100000;
         std::vector<Utilities> allUtilities;
+        allUtilities.reserve(numArticulations * numTopUtilities);
         for (size_t a = 0; a < numArticulations; ++a) {
             configurations1.push_back(new RobotSceneConfiguration());
             for (size_t b = 0; b < numArticulations; ++b) {
                 configurations1[a]->setArticulation(b, a == b ? 1. : 0.);
             }
+            if (a % sharedData->numThreads != threadNr) {
+                // utility map of this articulation is computed by another worker
+                continue;
+            }
             configurations1[a]->applyToScene(scene);
             costmapRenderer->display();
             bellmanFordRenderer->display();
             panoEvalRenderer->display();
 
             glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
-            glBindTexture(GL_TEXTURE_2D, panoEvalRenderer->getUtilityMap());
-            glGetTexImage(GL_TEXTURE_2D, 0, GL_RED_INTEGER, GL_INT, utilitymap);
-            {
-                for (int y = 0, i = 0; y < height; ++y) {
-                    for (int x = 0; x < width; ++x, ++i) {
-                        if (utilitymap[i] < 100000) {
-                            allUtilities.push_back(Utilities(a, x, y, utilitymap[i]));
-                        }
-                    }
-                }
+            panoEvalRenderer->getTopUtilities(numTopUtilities, topUtilitySpacing, highestUtility, topUtilities);
+            for (std::vector<PanoEvalRenderer::UtilityCell>::const_iterator it = topUtilities.begin();
+                    it != topUtilities.end(); ++it) {
+                allUtilities.push_back(Utilities(a, it->x, it->y, it->utility));
             }
 #ifdef WRITE_VISUALIZATION_DATA
             char filename[256];
@@ -235,12 +293,45 @@ void HillclimbingTask::run() {
 #endif
         }
 
+        // Gather the top utility cells of all workers
+        const size_t firstUtility = __sync_fetch_and_add(&taskSharedData->numUtilities, allUtilities.size());
+        for (size_t u = 0; u < allUtilities.size() && firstUtility + u < maxSharedUtilities; ++u) {
+            sharedUtilities[firstUtility + u] = allUtilities[u];
+        }
+        pthread_barrier_wait(&sharedData->barrier);
+        if (taskSharedData->numUtilities > maxSharedUtilities) {
+            logWarn("Too many top utility cells, ignoring the rest");
+        }
+        allUtilities.assign(sharedUtilities,
+                sharedUtilities + std::min(static_cast<size_t>(taskSharedData->numUtilities), maxSharedUtilities));
+
         sort(allUtilities.begin(), allUtilities.end());
+
+        // The cells are sorted by utility, with a time budget only the best ones that fit are evaluated
+        const double cellsStart = getTime();
+        size_t maxOwnCells = numTopUtilities;
+        if (hasDeadline() && cellTime > 0.) {
+            const double candidateTime = iterationEnd - tailTime - cellsStart;
+            maxOwnCells = std::max(static_cast<size_t>(std::max(candidateTime, 0.) / cellTime), static_cast<size_t>(1));
+        }
+        size_t numOwnCells = 0;
         std::vector<RobotSceneConfiguration *> configurations2;
+        std::vector<size_t> candidateIndices;
         std::vector<GLuint> visibilityResults;
-        for (size_t u = 0; u < 10; ++u) {
+        // Pixel counts found in the pose cache, notCached for candidates that are rendered
+        const GLuint notCached = std::numeric_limits<GLuint>::max();
+        std::vector<GLuint> cachedCounts;
+        size_t candidateIndex = 0;
+        for (size_t u = 0; u < std::min(numTopUtilities, allUtilities.size()); ++u) {
+            std::vector<glm::mat4> views;
+            size_t numCellMisses = 0;
+            const bool isOwnCell = u % sharedData->numThreads == threadNr && numOwnCells < maxOwnCells;
             for (float pitch = glm::radians(20.); pitch <= glm::radians(160.); pitch += glm::radians(20.) ) {
-                for (float yaw = 0; yaw < glm::radians(360.); yaw += glm::radians(20.)) {
+                for (float yaw = 0; yaw < glm::radians(360.); yaw += glm::radians(20.), ++candidateIndex) {
+                    if (!isOwnCell) {
+                        // candidate is evaluated by another worker
+                        continue;
+                    }
                     RobotSceneConfiguration *c = new RobotSceneConfiguration();
                     const float x = -5.36 + static_cast<float>(std::min(width - 1, std::max(1, allUtilities[u].x))) / static_cast<float>(width)  * 10.98;  // TODO
                     const float y = -6.49 + static_cast<float>(std::min(height - 1, std::max(1, allUtilities[u].y))) / static_cast<float>(height) * 10.98;  // TODO
@@ -253,7 +344,25 @@ void HillclimbingTask::run() {
                     c->setCameraLocalTransform(glm::inverse(glm::lookAt(eye, eye + look, up)));
                     c->applyToScene(scene);
                     configurations2.push_back(c);
+                    candidateIndices.push_back(candidateIndex);
                     cameraNode->setLocalTransform(c->getCameraLocalTransform());
+                    GLuint cachedCount;
+                    // the approximate counts of the panorama orientation search are not cached, see below
+                    if (poseCache && !panoVisibilityRenderer
+                            && poseCache->lookup(PoseCache::getKey(*c, coverageState), cachedCount)) {
+                        cachedCounts.push_back(cachedCount);
+                    } else {
+                        cachedCounts.push_back(notCached);
+                        ++numCellMisses;
+                    }
+                    if (panoVisibilityRenderer) {
+                        // evaluated below for all orientations at once
+                        views.push_back(glm::inverse(cameraNode->getWorldTransform()));
+                        continue;
+                    }
+                    if (cachedCounts.back() != notCached) {
+                        continue;
+                    }
                     visibilityRenderer->display();
 #ifdef WRITE_VISUALIZATION_DATA
                     glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
@@ -311,37 +420,71 @@ void HillclimbingTask::run() {
 #endif
                 }
             }
+            if (isOwnCell) {
+                ++numOwnCells;
+            }
+            if (panoVisibilityRenderer && isOwnCell && numCellMisses > 0) {
+                // Camera node is at the current position, render panorama once and score all orientations
+                std::vector<GLuint> gains;
+                panoVisibilityRenderer->setViews(views);
+                panoVisibilityRenderer->display();
+                panoVisibilityRenderer->getGains(gains);
+                // the gains are newly observed texels, the pixel counts include the coverage so far
+                for (size_t g = 0; g < gains.size(); ++g) {
+                    visibilityResults.push_back(taskSharedData->currentConfiguration.getCount() + gains[g]);
+                }
+            }
         }
 
 #ifndef WRITE_VISUALIZATION_DATA
-        visibilityRenderer->getPixelCounts(visibilityResults);
+        if (!panoVisibilityRenderer) {
+            visibilityRenderer->getPixelCounts(visibilityResults);
+        }
 #endif
-        const size_t numResults = visibilityResults.size();
-        if (numResults != configurations2.size()) {
+        if (visibilityResults.size() != static_cast<size_t>(
+                std::count(cachedCounts.begin(), cachedCounts.end(), notCached))) {
             logError("Visibility results count does not match configurations count");
             return;
         }
+        // Merge the rendered pixel counts into the cached ones, the approximate counts
+        // of the panorama orientation search are not cached
+        for (size_t nc = 0, r = 0; nc < cachedCounts.size(); ++nc) {
+            if (cachedCounts[nc] == notCached) {
+                cachedCounts[nc] = visibilityResults[r++];
+                if (poseCache && !panoVisibilityRenderer) {
+                    poseCache->insert(PoseCache::getKey(*configurations2[nc], coverageState), cachedCounts[nc]);
+                }
+            }
+        }
+        visibilityResults.swap(cachedCounts);
+        const size_t numResults = visibilityResults.size();
+
+        const double candidatesEnd = getTime();
+        if (numOwnCells > 0) {
+            const double measuredCellTime = (candidatesEnd - cellsStart) / numOwnCells;
+            cellTime = cellTime > 0. ? 0.75 * cellTime + 0.25 * measuredCellTime : measuredCellTime;
+        }
 
         // scope for bestConfiguration
         {
             RobotSceneConfiguration * bestConfiguration = NULL;
             float bestEval = -std::numeric_limits<float>::max();
+            size_t bestIndex = std::numeric_limits<size_t>::max();
             for (size_t nc = 0; nc < numResults; ++nc) {
                 configurations2[nc]->setCount(visibilityResults[nc]);
                 const float eval = configurations2[nc]->getEvaluation(taskSharedData->currentConfiguration);
                 if (eval > bestEval) {
                     bestEval = eval;
+                    bestIndex = candidateIndices[nc];
                     bestConfiguration = configurations2[nc];
                 }
             }
 
-            // Publish best result
-            pthread_mutex_lock(&sharedData->mutex);
-            if (bestEval > taskSharedData->bestEval) {
-                taskSharedData->bestConfiguration.set(*bestConfiguration);
-                taskSharedData->bestEval = bestEval;
+            // Publish best result without taking the mutex, ties are resolved by candidate order
+            // to match the single worker result
+            if (bestConfiguration) {
+                sharedBest->publish(threadNr, *bestConfiguration, bestEval, bestIndex);
             }
-            pthread_mutex_unlock(&sharedData->mutex);
         }
 
         // Delete all configurations
@@ -361,6 +504,9 @@ void HillclimbingTask::run() {
 
         // Set best configuration of all threads to the new current configuration
         if (threadNr == 0) {
+            if (!sharedBest->getBest(taskSharedData->bestConfiguration, taskSharedData->bestEval)) {
+                taskSharedData->bestEval = -std::numeric_limits<float>::max();
+            }
             // Debug output
             static bool isFirst = true;
             if (isFirst) {
@@ -431,7 +577,15 @@ void HillclimbingTask::run() {
             if (taskSharedData->bestEval < 0.f) {
                 taskSharedData->finished = true;
             }
+            if (hasDeadline() && !taskSharedData->finished
+                    && getTime() + (cellsStart - iterationStart) + cellTime + tailTime > sharedData->deadline) {
+                // No time for another iteration, the views printed so far are the result
+                logInfo("Time budget used up after %zu iterations", i + 1);
+                taskSharedData->finished = true;
+            }
             taskSharedData->bestEval = -std::numeric_limits<float>::max();
+            taskSharedData->numUtilities = 0;
+            sharedBest->reset();
         }
 
         // Wait for other threads
@@ -440,6 +594,7 @@ void HillclimbingTask::run() {
         if (taskSharedData->finished) {
             break;
         }
+        coverageState = PoseCache::getKey(taskSharedData->currentConfiguration, coverageState);
 
         // Re-render best visibility texture
         cameraNode->setLocalTransform(taskSharedData->currentConfiguration.getCameraLocalTransform());
@@ -450,10 +605,14 @@ void HillclimbingTask::run() {
 
         std::vector<GLuint> pixelCounts;
         visibilityRenderer->getPixelCounts(pixelCounts);
-        if (pixelCounts[0] != taskSharedData->bestConfiguration.getCount()) {
+        if (!panoVisibilityRenderer && pixelCounts[0] != taskSharedData->bestConfiguration.getCount()) {
             logError("Error: pixel count of best configuration differs: %u != %u", pixelCounts[0],
                     taskSharedData->bestConfiguration.getCount());
         }
+        if (threadNr == 0) {
+            // the count of the panorama orientation search is approximate, continue with the rendered one
+            taskSharedData->currentConfiguration.setCount(pixelCounts[0]);
+        }
 
         // Copy to original texture
         glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
@@ -494,8 +653,14 @@ void HillclimbingTask::run() {
         }
 #endif
 
+        if (checkpoint && threadNr == 0 && (i + 1) % checkpointInterval == 0) {
+            saveCheckpoint(i + 1);
+        }
+
         // Wait for other threads
         pthread_barrier_wait(&sharedData->barrier);
+        const double measuredTailTime = getTime() - candidatesEnd;
+        tailTime = tailTime > 0. ? 0.75 * tailTime + 0.25 * measuredTailTime : measuredTailTime;
 
         clock_gettime(CLOCK_MONOTONIC, &curTime);
         double thisTime = static_cast<double>(curTime.tv_sec) + static_cast<double>(curTime.tv_nsec) * 1e-9;
@@ -505,21 +670,96 @@ void HillclimbingTask::run() {
 
 }
 
-void HillclimbingTask::allocateSharedData() {
+void HillclimbingTask::saveCheckpoint(const size_t nextIteration) {
+    checkpoint->begin();
+    checkpoint->put(static_cast<uint64_t>(nextIteration));
+    checkpoint->put(coverageState);
+    checkpoint->putConfiguration(taskSharedData->currentConfiguration);
+    checkpoint->put(static_cast<uint32_t>(targetTextures.size()));
+    for (size_t t = 0; t < targetTextures.size(); ++t) {
+        checkpoint->putTexture(targetTextures[t], visibilityRenderer->getTextureWidth(),
+                visibilityRenderer->getTextureHeight());
+    }
+    checkpoint->commit();
+}
+
+bool HillclimbingTask::resume(size_t& nextIteration) {
+    uint64_t iteration;
+    uint32_t numTextures;
+    RobotSceneConfiguration current;
+    if (!checkpoint->get(iteration) || !checkpoint->get(coverageState) || !checkpoint->getConfiguration(current)
+            || !checkpoint->get(numTextures)) {
+        return false;
+    }
+    if (numTextures != targetTextures.size()) {
+        logError("Checkpoint has %u target textures, the scene has %zu", numTextures, targetTextures.size());
+        return false;
+    }
+    for (size_t t = 0; t < targetTextures.size(); ++t) {
+        if (!checkpoint->getTexture(targetTextures[t], visibilityRenderer->getTextureWidth(),
+                visibilityRenderer->getTextureHeight())) {
+            return false;
+        }
+    }
+    if (threadNr == 0) {
+        taskSharedData->currentConfiguration.set(current);
+    }
+    nextIteration = iteration;
+    return true;
+}
+
+size_t HillclimbingTask::sharedBestOffset() {
+    // SharedBest contains 64 bit words, align it to 8 bytes
+    const size_t offset = sizeof(TaskSharedData) + 2 * RobotSceneConfiguration::numArticulation * sizeof(float)
+            + maxSharedUtilities * sizeof(Utilities);
+    return (offset + 7) & ~static_cast<size_t>(7);
+}
+
+void HillclimbingTask::allocateSharedData(const size_t numThreads) {
     if (!taskSharedData) {
-        taskSharedData = (TaskSharedData *) mmap(NULL,
-                sizeof(TaskSharedData) + 2 * RobotSceneConfiguration::numArticulation * sizeof(float),
+        maxSharedUtilities = RobotSceneConfiguration::numArticulation
+                * std::max(Config::getInstance().getParam<int>("topUtilities"), 0);
+        const size_t poseCacheSize = std::max(Config::getInstance().getParam<int>("poseCacheSize"), 0);
+        sharedDataSize = poseCacheOffset(numThreads) + (poseCacheSize > 0 ? PoseCache::getSize(poseCacheSize) : 0);
+        taskSharedData = (TaskSharedData *) mmap(NULL, sharedDataSize,
                 PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
         taskSharedData->bestConfiguration.articulation = reinterpret_cast<float*>(taskSharedData + 1);
         taskSharedData->currentConfiguration.articulation = taskSharedData->bestConfiguration.articulation
                 + RobotSceneConfiguration::numArticulation;
+        sharedUtilities = reinterpret_cast<Utilities*>(taskSharedData->currentConfiguration.articulation
+                + RobotSceneConfiguration::numArticulation);
+        sharedBest = SharedBest::create(reinterpret_cast<char*>(taskSharedData) + sharedBestOffset(), numThreads);
+        if (poseCacheSize > 0) {
+            poseCache = PoseCache::create(reinterpret_cast<char*>(taskSharedData) + poseCacheOffset(numThreads),
+                    poseCacheSize);
+            if (Config::getInstance().getParam<bool>("poseCachePersistent")) {
+                const std::string filename = Config::getInstance().getParam<std::string>("poseCacheFile");
+                logInfo("Loaded %zu cached pose evaluations from %s", poseCache->load(filename), filename.c_str());
+            }
+        }
     }
 }
 
+size_t HillclimbingTask::poseCacheOffset(const size_t numThreads) {
+    // PoseCache contains 64 bit words as well
+    const size_t offset = sharedBestOffset() + SharedBest::getSize(numThreads);
+    return (offset + 7) & ~static_cast<size_t>(7);
+}
+
 void HillclimbingTask::freeSharedData() {
+    if (poseCache) {
+        logInfo("Pose cache: %lu hits, %lu misses", static_cast<unsigned long>(poseCache->getHits()),
+                static_cast<unsigned long>(poseCache->getMisses()));
+        if (Config::getInstance().getParam<bool>("poseCachePersistent")) {
+            poseCache->save(Config::getInstance().getParam<std::string>("poseCacheFile"));
+        }
+        poseCache = NULL;
+    }
     if (taskSharedData) {
-        munmap(taskSharedData, sizeof(TaskSharedData) + 2 * RobotSceneConfiguration::numArticulation * sizeof(float));
+        munmap(taskSharedData, sharedDataSize);
         taskSharedData = NULL;
+        sharedUtilities = NULL;
+        sharedBest = NULL;
     }
 }
 
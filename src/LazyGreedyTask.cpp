@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#include <gpu_coverage/LazyGreedyTask.h>
+#include <gpu_coverage/VisibilityRenderer.h>
+#include <gpu_coverage/Config.h>
+#include <gpu_coverage/Utilities.h>
+#include <gpu_coverage/Sampler.h>
+
+#include <iostream>
+#include <queue>
+#include <sys/mman.h>
+
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS true
+#endif
+#include <glm/gtc/matrix_access.hpp>
+
+namespace gpu_coverage {
+
+LazyGreedyTask::TaskSharedData *LazyGreedyTask::taskSharedData = NULL;
+GLuint *LazyGreedyTask::candidateCounts = NULL;
+size_t LazyGreedyTask::sharedDataSize = 0;
+
+LazyGreedyTask::LazyGreedyTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData,
+        const size_t numSteps, const size_t numArticulationConfigs, const size_t numCameraPoses)
+        : AbstractTask(sharedData, threadNr), scene(scene), numSteps(numSteps),
+          numArticulationConfigs(numArticulationConfigs), numCameraPoses(numCameraPoses),
+          numCandidates(numArticulationConfigs * numCameraPoses), visibilityRenderer(NULL),
+          candidatePool(numArticulationConfigs * (numCameraPoses + 1))
+{
+    cameraNode = scene->findNode(Config::getInstance().getParam<std::string>("robotCamera"));
+    if (!cameraNode) {
+        logError("Could not find robot camera");
+        return;
+    }
+
+    visibilityRenderer = new VisibilityRenderer(scene, false, true);
+    if (!visibilityRenderer->isReady()) {
+        return;
+    }
+
+    std::stringstream targets(Config::getInstance().getParam<std::string>("target"));
+    size_t targetI = 0;
+    while (targets.good()) {
+        std::string targetName;
+        targets >> targetName;
+        if (!targetName.empty()) {
+            const Node * const target = scene->findNode(targetName);
+            targetTexture[targetI] = target->getMeshes().front()->getMaterial()->getTexture()->getTextureObject();
+            ++targetI;
+            targetPoints.push_back(glm::vec3(glm::column(target->getWorldTransform(), 3)));
+        }
+    }
+    numTargetTextures = targetI;
+
+    if (threadNr == 0) {
+        taskSharedData->selected = 0;
+        taskSharedData->finished = false;
+    }
+
+    ready = true;
+}
+
+LazyGreedyTask::~LazyGreedyTask() {
+    delete visibilityRenderer;
+}
+
+GLuint LazyGreedyTask::evaluate(const RobotSceneConfiguration& candidate) {
+    candidate.applyToScene(scene);
+    cameraNode->setLocalTransform(candidate.getCameraLocalTransform());
+    visibilityRenderer->display();
+    std::vector<GLuint> counts;
+    visibilityRenderer->getPixelCounts(counts);
+    return counts.empty() ? 0 : counts[0];
+}
+
+void LazyGreedyTask::run() {
+    if (!ready) {
+        return;
+    }
+
+    // All workers sample the candidates with the seed of the first worker. The seed is only known
+    // here, because setSeed() is called after construction.
+    if (threadNr == 0) {
+        taskSharedData->candidateSeed = seed;
+    }
+    pthread_barrier_wait(&sharedData->barrier);
+
+    // Sample the same candidates in all workers, grouped by articulation as in RandomSearchTask
+    const std::string samplerType = Config::getInstance().getParam<std::string>("sampler");
+    Sampler * const articulationSampler = Sampler::create(samplerType, 2, taskSharedData->candidateSeed);
+    Sampler * const cameraSampler = Sampler::create(samplerType, 4, taskSharedData->candidateSeed + 1);
+    if (!articulationSampler || !cameraSampler) {
+        delete articulationSampler;
+        delete cameraSampler;
+        return;
+    }
+    std::vector<float> articulationSamples;
+    std::vector<float> cameraSamples;
+    articulationSampler->generate(numArticulationConfigs, articulationSamples);
+    cameraSampler->generate(numCandidates, cameraSamples);
+    std::vector<RobotSceneConfiguration *> candidates;
+    candidates.reserve(numCandidates);
+    for (size_t a = 0; a < numArticulationConfigs; ++a) {
+        RobotSceneConfiguration& rsc = *candidatePool.acquire();
+        rsc.setArticulationFromSample(&articulationSamples[a * articulationSampler->getDimensions()]);
+        for (size_t c = 0; c < numCameraPoses; ++c) {
+            const float * const sample = &cameraSamples[candidates.size() * cameraSampler->getDimensions()];
+            RobotSceneConfiguration * const candidate = candidatePool.acquire();
+            candidate->set(rsc);
+            candidate->setCameraHeightFromSample(sample[0]);
+            candidate->setCameraPositionFromSample(sample + 1, &targetPoints);
+            candidates.push_back(candidate);
+        }
+    }
+    delete articulationSampler;
+    delete cameraSampler;
+
+    // Initial upper bounds: split the candidates across the workers and render them as one batch
+    std::vector<size_t> ownCandidates;
+    for (size_t c = threadNr; c < numCandidates; c += sharedData->numThreads) {
+        candidates[c]->applyToScene(scene);
+        cameraNode->setLocalTransform(candidates[c]->getCameraLocalTransform());
+        visibilityRenderer->display();
+        ownCandidates.push_back(c);
+    }
+    std::vector<GLuint> counts;
+    visibilityRenderer->getPixelCounts(counts);
+    if (counts.size() != ownCandidates.size()) {
+        logError("Visibility results count does not match candidates count");
+        return;
+    }
+    for (size_t i = 0; i < ownCandidates.size(); ++i) {
+        candidateCounts[ownCandidates[i]] = counts[i];
+    }
+    pthread_barrier_wait(&sharedData->barrier);
+
+    // Nothing is covered before the first view, as in the other tasks
+    GLuint coveredCount = 0;
+    std::priority_queue<Bound> bounds;
+    if (threadNr == 0) {
+        for (size_t c = 0; c < numCandidates; ++c) {
+            bounds.push(Bound(static_cast<long>(candidateCounts[c]) - coveredCount, c, 0));
+        }
+        std::cout << "#step\tcandidate\tgain\tcoverage\tre-evaluations" << std::endl;
+    }
+
+    size_t totalEvaluations = numCandidates;
+    for (size_t step = 0; step < numSteps; ++step) {
+        if (threadNr == 0) {
+            size_t evaluations = 0;
+            taskSharedData->finished = true;
+            while (!bounds.empty()) {
+                const Bound top = bounds.top();
+                bounds.pop();
+                if (top.step == step) {
+                    // bound is up to date, by submodularity no other candidate can be better
+                    if (top.gain > 0) {
+                        taskSharedData->selected = top.index;
+                        taskSharedData->finished = false;
+                        std::cout << step << "\t" << top.index << "\t" << top.gain << "\t"
+                                << coveredCount + top.gain << "\t" << evaluations << std::endl;
+                    }
+                    break;
+                }
+                const long gain = static_cast<long>(evaluate(*candidates[top.index])) - coveredCount;
+                ++evaluations;
+                bounds.push(Bound(gain, top.index, step));
+            }
+            totalEvaluations += evaluations;
+        }
+
+        // Wait for the selection
+        pthread_barrier_wait(&sharedData->barrier);
+        if (taskSharedData->finished) {
+            break;
+        }
+
+        // All workers add the selected view to their coverage
+        const GLuint count = evaluate(*candidates[taskSharedData->selected]);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        for (size_t t = 0; t < numTargetTextures; ++t) {
+            glCopyImageSubData(visibilityRenderer->getTexture(t), GL_TEXTURE_2D, 0, 0, 0, 0, targetTexture[t], GL_TEXTURE_2D, 0,
+                    0, 0, 0, visibilityRenderer->getTextureWidth(), visibilityRenderer->getTextureHeight(), 1);
+        }
+        coveredCount = count;
+
+        // Wait until the selection has been read before the next one is written
+        pthread_barrier_wait(&sharedData->barrier);
+    }
+
+    if (threadNr == 0) {
+        std::cout << "# " << totalEvaluations << " renders, full greedy would need up to "
+                << numCandidates * (numSteps + 1) << std::endl;
+    }
+}
+
+void LazyGreedyTask::allocateSharedData(const size_t numCandidates) {
+    if (!taskSharedData) {
+        sharedDataSize = sizeof(TaskSharedData) + numCandidates * sizeof(GLuint);
+        taskSharedData = (TaskSharedData *) mmap(NULL, sharedDataSize,
+                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        candidateCounts = reinterpret_cast<GLuint*>(taskSharedData + 1);
+    }
+}
+
+void LazyGreedyTask::freeSharedData() {
+    if (taskSharedData) {
+        munmap(taskSharedData, sharedDataSize);
+        taskSharedData = NULL;
+        candidateCounts = NULL;
+    }
+}
+
+} /* namespace gpu_coverage */
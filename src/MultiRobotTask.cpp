@@ -0,0 +1,444 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#include <gpu_coverage/MultiRobotTask.h>
+#include <gpu_coverage/BellmanFordXfbRenderer.h>
+#include <gpu_coverage/CostMapRenderer.h>
+#include <gpu_coverage/VisibilityRenderer.h>
+#include <gpu_coverage/Config.h>
+#include <gpu_coverage/Utilities.h>
+#include <gpu_coverage/Channel.h>
+#include <gpu_coverage/Sampler.h>
+#include <gpu_coverage/Checkpoint.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sys/mman.h>
+
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS true
+#endif
+#include <glm/gtc/matrix_access.hpp>
+
+namespace gpu_coverage {
+
+MultiRobotTask::MultiRobotSharedData *MultiRobotTask::multiRobotSharedData = NULL;
+glm::mat4 *MultiRobotTask::robotTransforms = NULL;
+size_t MultiRobotTask::multiRobotSharedDataSize = 0;
+
+MultiRobotTask::MultiRobotTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData,
+        const size_t numIterations, const size_t numArticulationConfigs, const size_t numCameraPoses)
+        : RandomSearchTask(scene, threadNr, sharedData, numIterations, numArticulationConfigs, numCameraPoses),
+          numRobots(std::max(Config::getInstance().getParam<int>("multiRobotCount"), 1)),
+          pathLengthScale(0.f)
+{
+    for (size_t r = 0; r < numRobots; ++r) {
+        robots.push_back(new RobotSceneConfiguration());
+    }
+    if (!ready) {
+        return;
+    }
+    if (checkpoint) {
+        logWarn("Checkpoints are not supported by the multi-robot task");
+        delete checkpoint;
+        checkpoint = NULL;
+    }
+    const float cellSize = 2.f / (costmapRenderer->getCamera()->getProjectionMatrix()[0][0]
+            * costmapRenderer->getTextureWidth());
+    pathLengthScale = cellSize / BellmanFordXfbRenderer::distancePerCell;
+
+    if (threadNr == 0) {
+        // First thread initializes the robot poses
+        std::stringstream starts(Config::getInstance().getParam<std::string>("multiRobotStarts"));
+        for (size_t r = 0; r < numRobots; ++r) {
+            glm::mat4 transform(cameraNode->getLocalTransform());
+            float x, y;
+            if (starts >> x >> y) {
+                transform[3][0] = x;
+                transform[3][1] = y;
+            }
+            robotTransforms[r] = transform;
+        }
+        multiRobotSharedData->selectedRobot = numRobots;
+    }
+}
+
+MultiRobotTask::~MultiRobotTask() {
+    for (size_t r = 0; r < robots.size(); ++r) {
+        delete robots[r];
+    }
+}
+
+GLuint MultiRobotTask::render(const RobotSceneConfiguration& candidate) {
+    candidate.applyToScene(scene);
+    cameraNode->setLocalTransform(candidate.getCameraLocalTransform());
+    visibilityRenderer->display();
+    visibilityRenderer->getPixelCounts(pixelCounts);
+    return pixelCounts.empty() ? 0 : pixelCounts[0];
+}
+
+void MultiRobotTask::updateRobots() {
+    for (size_t r = 0; r < numRobots; ++r) {
+        robots[r]->set(taskSharedData->currentConfiguration);
+        robots[r]->setCameraLocalTransform(robotTransforms[r]);
+    }
+}
+
+size_t MultiRobotTask::getBestRobot(const RobotSceneConfiguration& candidate, const size_t nearestRobot,
+        const float pathLength, const std::vector<bool>& assigned, float& eval) {
+    size_t best = numRobots;
+    eval = -std::numeric_limits<float>::max();
+    if (nearestRobot < numRobots) {
+        // the distance map only contains the path from the nearest robot
+        if (!assigned[nearestRobot]) {
+            RobotSceneConfiguration& robot = *robots[nearestRobot];
+            eval = candidate.getGain(robot) - candidate.getCost(robot, pathLength);
+            best = nearestRobot;
+        }
+        return best;
+    }
+    for (size_t r = 0; r < numRobots; ++r) {
+        if (assigned[r]) {
+            continue;
+        }
+        const float robotEval = candidate.getEvaluation(*robots[r]);
+        if (robotEval > eval) {
+            eval = robotEval;
+            best = r;
+        }
+    }
+    return best;
+}
+
+size_t MultiRobotTask::findNearestRobot(const RobotSceneConfiguration& configuration, float& pathLength) {
+    pathLength = 0.f;
+    if (!pruneCandidates) {
+        return numRobots;
+    }
+    configuration.applyToScene(scene);
+    costmapRenderer->display();
+    bellmanFordRenderer->display();
+    bellmanFordRenderer->getDistances(distances);
+    bellmanFordRenderer->getSources(nearestSources);
+    size_t cell;
+    if (!getCell(configuration, cell) || nearestSources[cell] < 0
+            || static_cast<size_t>(nearestSources[cell]) >= numRobots) {
+        return numRobots;
+    }
+    pathLength = pathLengthScale * static_cast<float>(distances[cell]);
+    return nearestSources[cell];
+}
+
+void MultiRobotTask::run() {
+    if (!ready) {
+        return;
+    }
+    std::vector<RobotSceneConfiguration *> configurations;
+    configurations.reserve(numArticulationConfigs * numCameraPoses);
+    std::vector<Candidate> candidates;
+    candidates.reserve(numArticulationConfigs * numCameraPoses);
+    std::vector<GLuint> visibilityResults;
+    std::vector<float> articulationSamples;
+    std::vector<float> cameraSamples;
+    std::vector<GLint> costs;
+    std::vector<size_t> nearestRobots;
+    std::vector<float> pathLengths;
+    std::vector<unsigned char> allowedCells;
+    std::vector<glm::vec3> sources;
+    std::vector<bool> assigned(numRobots);
+    size_t numRejected = 0;
+    size_t numRenders = 0;
+    size_t numRerenders = 0;
+    size_t numDistanceMaps = 0;
+    // Nothing is covered before the first view, as in the other tasks
+    GLuint coveredCount = taskSharedData->currentConfiguration.getCount();
+
+    if (threadNr == 0) {
+        std::cout << "# iteration\trobot\tcoverage\tcost\tgain\tevaluation\tx\ty\tz";
+        for (size_t a = 0; a < numArticulations; ++a) {
+            std::cout << "\t" << scene->getChannels()[a]->getNode()->getName();
+        }
+        std::cout << std::endl;
+    }
+
+    for (size_t i = 0; i < numIterations; ++i) {
+        Sampler * const articulationSampler = Sampler::create(samplerType, 2, rand_r(&seed));
+        Sampler * const cameraSampler = Sampler::create(samplerType, 4, rand_r(&seed));
+        if (!articulationSampler || !cameraSampler) {
+            // same configuration in all workers, so all of them return here
+            delete articulationSampler;
+            delete cameraSampler;
+            return;
+        }
+        updateRobots();
+
+        // One distance map per articulation configuration, starting at all robots at once
+        sources.clear();
+        for (size_t r = 0; r < numRobots; ++r) {
+            glm::vec4 position(glm::column(robotTransforms[r], 3));
+            if (cameraNode->getParent()) {
+                position = cameraNode->getParent()->getWorldTransform() * position;
+            }
+            sources.push_back(glm::vec3(position));
+        }
+        bellmanFordRenderer->setSourcePositions(sources);
+
+        articulationSampler->generate(numArticulationConfigs, articulationSamples);
+        for (size_t a = 0; a < numArticulationConfigs; ++a) {
+            RobotSceneConfiguration& rsc = *candidatePool.acquire();
+            rsc.setArticulationFromSample(&articulationSamples[a * articulationSampler->getDimensions()]);
+            rsc.applyToScene(scene);
+            costmapRenderer->display();
+            if (pruneCandidates) {
+                bellmanFordRenderer->display();
+                bellmanFordRenderer->getDistances(distances);
+                bellmanFordRenderer->getSources(nearestSources);
+                ++numDistanceMaps;
+            }
+            if (sampleFreeSpace || pruneCandidates) {
+                // CPU-side bitmap of the cells on which candidates may be placed
+                allowedCells.assign(costmapRenderer->getTextureWidth() * costmapRenderer->getTextureHeight(), 1);
+                if (sampleFreeSpace) {
+                    costmapRenderer->getCosts(costs);
+                    for (size_t cell = 0; cell < allowedCells.size(); ++cell) {
+                        allowedCells[cell] &= costs[cell] < CostMapRenderer::obstacleCost;
+                    }
+                }
+                if (pruneCandidates) {
+                    // reachable by at least one robot
+                    for (size_t cell = 0; cell < allowedCells.size(); ++cell) {
+                        allowedCells[cell] &= distances[cell] < BellmanFordXfbRenderer::unreachableDistance;
+                    }
+                }
+            }
+
+            const size_t firstAccepted = configurations.size();
+            size_t numAccepted = 0;
+            RobotSceneConfiguration *c = NULL;
+            for (size_t round = 0; numAccepted < numCameraPoses && round < maxSampleRounds; ++round) {
+                cameraSampler->generate(numCameraPoses - numAccepted, cameraSamples);
+                for (size_t s = 0; s < cameraSamples.size(); s += cameraSampler->getDimensions()) {
+                    if (!c) {
+                        c = candidatePool.acquire();
+                    }
+                    c->set(rsc);
+                    c->setCameraHeightFromSample(cameraSamples[s]);
+                    c->setCameraPositionFromSample(&cameraSamples[s + 1], &targetPoints);
+                    if (!allowedCells.empty() && !isAllowed(allowedCells, *c)) {
+                        ++numRejected;
+                        continue;
+                    }
+                    // c->count will be set later
+                    configurations.push_back(c);
+                    cameraNode->setLocalTransform(c->getCameraLocalTransform());
+                    visibilityRenderer->display();
+                    c = NULL;
+                    ++numAccepted;
+                }
+            }
+
+            if (pruneCandidates) {
+                // Nearest robot and path length of the accepted candidates from the distance map
+                candidateBatch.clear();
+                for (size_t k = firstAccepted; k < configurations.size(); ++k) {
+                    size_t cell = 0;
+                    getCell(*configurations[k], cell);
+                    candidateBatch.add(*configurations[k], cell);
+                    const GLint source = nearestSources[cell];
+                    nearestRobots.push_back(source >= 0 && static_cast<size_t>(source) < numRobots ? source : numRobots);
+                }
+                candidateBatch.lookupPathLengths(distances, pathLengthScale);
+                for (size_t k = 0; k < candidateBatch.size(); ++k) {
+                    pathLengths.push_back(candidateBatch.getPathLength(k));
+                }
+            } else {
+                nearestRobots.resize(configurations.size(), numRobots);
+                pathLengths.resize(configurations.size(), 0.f);
+            }
+        }
+
+        delete articulationSampler;
+        delete cameraSampler;
+
+        // The candidates are rendered once for all robots
+        visibilityRenderer->getPixelCounts(visibilityResults);
+        if (visibilityResults.size() != configurations.size()) {
+            logError("Visibility results count does not match configurations count");
+            break;
+        }
+        numRenders += visibilityResults.size();
+        candidates.clear();
+        for (size_t k = 0; k < configurations.size(); ++k) {
+            configurations[k]->setCount(visibilityResults[k]);
+            candidates.push_back(Candidate(configurations[k],
+                    static_cast<long>(visibilityResults[k]) - static_cast<long>(coveredCount),
+                    nearestRobots[k], pathLengths[k]));
+        }
+
+        // Greedy assignment of one view per robot
+        assigned.assign(numRobots, false);
+        size_t numMoved = 0;
+        for (size_t selection = 0; selection < numRobots; ++selection) {
+            // Upper bounds of the evaluations from the gains at the last render
+            for (size_t k = 0; k < candidates.size(); ++k) {
+                Candidate& candidate = candidates[k];
+                candidate.configuration->setCount(coveredCount + std::max(candidate.gain, 0L));
+                getBestRobot(*candidate.configuration, candidate.robot, candidate.pathLength, assigned,
+                        candidate.bound);
+            }
+            std::stable_sort(candidates.begin(), candidates.end());
+
+            RobotSceneConfiguration * bestConfiguration = NULL;
+            float bestEval = -std::numeric_limits<float>::max();
+            for (size_t k = 0; k < candidates.size() && candidates[k].bound > bestEval; ++k) {
+                Candidate& candidate = candidates[k];
+                if (candidate.selection != selection) {
+                    // rendered before the last selection, re-render against the current coverage
+                    const GLuint count = render(*candidate.configuration);
+                    ++numRerenders;
+                    candidate.gain = static_cast<long>(count) - static_cast<long>(coveredCount);
+                    candidate.selection = selection;
+                    candidate.configuration->setCount(count);
+                }
+                float eval;
+                getBestRobot(*candidate.configuration, candidate.robot, candidate.pathLength, assigned, eval);
+                if (eval > bestEval) {
+                    bestEval = eval;
+                    bestConfiguration = candidate.configuration;
+                }
+            }
+
+            // Publish best result without taking the mutex
+            if (bestConfiguration) {
+                sharedBest->publish(threadNr, *bestConfiguration, bestEval, 0);
+            }
+
+            // Wait for other threads
+            pthread_barrier_wait(&sharedData->barrier);
+
+            if (threadNr == 0) {
+                multiRobotSharedData->selectedRobot = numRobots;
+                if (sharedBest->getBest(taskSharedData->bestConfiguration, taskSharedData->bestEval)
+                        && taskSharedData->bestEval >= 0.f) {
+                    // the robot is not published, find it again from the same robot poses and distance map
+                    float pathLength;
+                    const size_t nearestRobot = findNearestRobot(taskSharedData->bestConfiguration, pathLength);
+                    float eval;
+                    const size_t robot = getBestRobot(taskSharedData->bestConfiguration, nearestRobot, pathLength,
+                            assigned, eval);
+                    if (robot < numRobots) {
+                        const float gain = taskSharedData->bestConfiguration.getGain(*robots[robot]);
+                        cameraNode->setLocalTransform(taskSharedData->bestConfiguration.getCameraLocalTransform());
+                        const glm::vec3 position(glm::column(cameraNode->getWorldTransform(), 3));
+                        std::cout << i << "\t" << robot << "\t" << taskSharedData->bestConfiguration.getCount() << "\t"
+                                << gain - eval << "\t" << gain << "\t" << eval << "\t"
+                                << position.x << "\t" << position.y << "\t" << position.z;
+                        for (size_t a = 0; a < numArticulations; ++a) {
+                            std::cout << "\t" << taskSharedData->bestConfiguration.getArticulation(a);
+                        }
+                        std::cout << std::endl;
+
+                        multiRobotSharedData->selectedRobot = robot;
+                        robotTransforms[robot] = taskSharedData->bestConfiguration.getCameraLocalTransform();
+                        taskSharedData->currentConfiguration.set(taskSharedData->bestConfiguration);
+                    } else {
+                        logError("Could not find the robot of the best configuration");
+                    }
+                }
+                taskSharedData->bestEval = -std::numeric_limits<float>::max();
+                sharedBest->reset();
+            }
+
+            // Wait for other threads
+            pthread_barrier_wait(&sharedData->barrier);
+
+            const size_t robot = multiRobotSharedData->selectedRobot;
+            if (robot >= numRobots) {
+                // none of the remaining robots gains from moving
+                break;
+            }
+            assigned[robot] = true;
+            ++numMoved;
+            updateRobots();
+
+            // All workers add the selected view to their coverage
+            const GLuint count = render(taskSharedData->currentConfiguration);
+            if (count != taskSharedData->currentConfiguration.getCount()) {
+                logError("Error: pixel count of best configuration differs: %u != %u", count,
+                        taskSharedData->currentConfiguration.getCount());
+            }
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+            for (size_t t = 0; t < numTargetTextures; ++t) {
+                glCopyImageSubData(visibilityRenderer->getTexture(t), GL_TEXTURE_2D, 0, 0, 0, 0, targetTexture[t], GL_TEXTURE_2D, 0,
+                        0, 0, 0, visibilityRenderer->getTextureWidth(), visibilityRenderer->getTextureHeight(), 1);
+            }
+            coveredCount = count;
+
+            // Wait until the selection has been read before the next one is written
+            pthread_barrier_wait(&sharedData->barrier);
+        }
+
+        // Release all configurations
+        configurations.clear();
+        nearestRobots.clear();
+        pathLengths.clear();
+        candidatePool.releaseAll();
+
+        if (numMoved == 0) {
+            // the same in all workers
+            break;
+        }
+    }
+
+    logInfo("[%zu] %zu candidates rendered once for %zu robots, %zu re-rendered, %zu distance maps, %zu rejected",
+            threadNr, numRenders, numRobots, numRerenders, numDistanceMaps, numRejected);
+}
+
+void MultiRobotTask::allocateSharedData(const size_t numThreads) {
+    RandomSearchTask::allocateSharedData(numThreads);
+    if (!multiRobotSharedData) {
+        const size_t numRobots = std::max(Config::getInstance().getParam<int>("multiRobotCount"), 1);
+        multiRobotSharedDataSize = sizeof(MultiRobotSharedData) + numRobots * sizeof(glm::mat4);
+        multiRobotSharedData = (MultiRobotSharedData *) mmap(NULL, multiRobotSharedDataSize,
+                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        robotTransforms = reinterpret_cast<glm::mat4*>(multiRobotSharedData + 1);
+    }
+}
+
+void MultiRobotTask::freeSharedData() {
+    if (multiRobotSharedData) {
+        munmap(multiRobotSharedData, multiRobotSharedDataSize);
+        multiRobotSharedData = NULL;
+        robotTransforms = NULL;
+    }
+    RandomSearchTask::freeSharedData();
+}
+
+} /* namespace gpu_coverage */
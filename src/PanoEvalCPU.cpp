@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#include <gpu_coverage/PanoEvalCPU.h>
+#include <gpu_coverage/Utilities.h>
+#include <pthread.h>
+#include <algorithm>
+#include <cmath>
+
+namespace gpu_coverage {
+
+// Must match GAIN_WEIGHT in the utility1 and utility2 shaders
+static const GLint GAIN_WEIGHT = 500;
+// Must match the bounds check in the pano-eval shader
+static const GLint MAX_COORDINATE = 256;
+
+static inline int wrap(const int i, const int n) {
+    return ((i % n) + n) % n;
+}
+
+static inline int clamp(const int i, const int n) {
+    return std::max(0, std::min(n - 1, i));
+}
+
+// Texel index that nearest sampling returns for the texture coordinate of texel i shifted by offset
+static inline int sampleIndex(const int i, const float offset, const int n) {
+    return static_cast<int>(floorf(((i + 0.5f) / n + offset) * n));
+}
+
+// Equivalent to the tl-edge shader, one row per item
+struct PanoEvalCPU::EdgeJob : public PanoEvalCPU::Job {
+    const PanoEvalCPU& owner;
+    const GLubyte * const pano;
+    const int dir;
+    GLint * const integral;
+    EdgeJob(const PanoEvalCPU& owner, const GLubyte * const pano, const bool clockwise, GLint * const integral)
+            : owner(owner), pano(pano), dir(clockwise ? 1 : -1), integral(integral) {
+    }
+    virtual void run(const size_t begin, const size_t end) {
+        const int w = owner.panoWidth;
+        const int h = owner.panoHeight;
+        for (int y = begin; y < static_cast<int>(end); ++y) {
+            const GLubyte * const row = &pano[y * w * 4];
+            const GLubyte * const top = &pano[wrap(y - 3 * dir, h) * w * 4];
+            const GLubyte * const bottom = &pano[wrap(y + 3 * dir, h) * w * 4];
+            GLint * const out = &integral[y * w * 2];
+            for (int x = 0; x < w; ++x) {
+                const GLint isTarget = row[x * 4] / 255.f >= 0.5f;
+                const GLint neighbor0 = row[wrap(x - 3 * dir, w) * 4] / 255.f <= 0.01f;
+                const GLint neighbor1 = (top[x * 4] / 255.f <= 0.01f) | (bottom[x * 4] / 255.f <= 0.01f);
+                out[x * 2] = (neighbor0 * 2 - 1) * isTarget;
+                out[x * 2 + 1] = (neighbor1 * 2 - 1) * isTarget;
+            }
+        }
+    }
+};
+
+// Converged x component of the tl-step shader, one row per item.
+// The x component only depends on the left neighbor, so a single sweep in
+// propagation direction yields the fixed point of the iteration.
+struct PanoEvalCPU::RowRunJob : public PanoEvalCPU::Job {
+    const PanoEvalCPU& owner;
+    const bool clockwise;
+    GLint * const integral;
+    RowRunJob(const PanoEvalCPU& owner, const bool clockwise, GLint * const integral)
+            : owner(owner), clockwise(clockwise), integral(integral) {
+    }
+    virtual void run(const size_t begin, const size_t end) {
+        const int w = owner.panoWidth;
+        const int leftOffset = clockwise ? -1 : 2;
+        for (int y = begin; y < static_cast<int>(end); ++y) {
+            GLint * const row = &integral[y * w * 2];
+            for (int i = 0; i < w; ++i) {
+                const int x = clockwise ? i : w - 1 - i;
+                const GLint value = row[x * 2];
+                const GLint left = row[clamp(x + leftOffset, w) * 2];
+                if (value <= 0 && left >= 1) {
+                    row[x * 2] = left - value;
+                }
+            }
+        }
+    }
+};
+
+// Converged y component of the tl-step shader, one column per item.
+// The y component depends on the top and the bottom neighbor, and the result
+// depends on which one is set first. The iteration is therefore replayed, but
+// each iteration only visits the texels next to the ones changed before.
+struct PanoEvalCPU::ColumnRunJob : public PanoEvalCPU::Job {
+    const PanoEvalCPU& owner;
+    const bool clockwise;
+    GLint * const integral;
+    ColumnRunJob(const PanoEvalCPU& owner, const bool clockwise, GLint * const integral)
+            : owner(owner), clockwise(clockwise), integral(integral) {
+    }
+    virtual void run(const size_t begin, const size_t end) {
+        const int w = owner.panoWidth;
+        const int h = owner.panoHeight;
+        const int topOffset = clockwise ? -1 : 2;
+        const int bottomOffset = clockwise ? 2 : -1;
+        std::vector<GLint> column(h);
+        std::vector<size_t> visited(h);
+        std::vector<int> candidates, nextCandidates;
+        std::vector<std::pair<int, GLint> > updates;
+        for (int x = begin; x < static_cast<int>(end); ++x) {
+            for (int y = 0; y < h; ++y) {
+                column[y] = integral[(y * w + x) * 2 + 1];
+            }
+            candidates.clear();
+            for (int y = 0; y < h; ++y) {
+                candidates.push_back(y);
+            }
+            std::fill(visited.begin(), visited.end(), 0);
+            for (size_t iteration = 1; !candidates.empty(); ++iteration) {
+                updates.clear();
+                for (std::vector<int>::const_iterator it = candidates.begin(); it != candidates.end(); ++it) {
+                    const GLint value = column[*it];
+                    if (value > 0) {
+                        continue;
+                    }
+                    const GLint top = column[clamp(*it + topOffset, h)];
+                    const GLint bottom = column[clamp(*it + bottomOffset, h)];
+                    if (top >= 1) {
+                        updates.push_back(std::make_pair(*it, top - value));
+                    } else if (bottom >= 1) {
+                        updates.push_back(std::make_pair(*it, bottom - value));
+                    }
+                }
+                // Apply after reading all texels, as the shader reads from the previous iteration
+                nextCandidates.clear();
+                for (std::vector<std::pair<int, GLint> >::const_iterator it = updates.begin(); it != updates.end();
+                        ++it) {
+                    column[it->first] = it->second;
+                    for (int y = std::max(0, it->first - 3); y <= std::min(h - 1, it->first + 3); ++y) {
+                        if (visited[y] != iteration) {
+                            visited[y] = iteration;
+                            nextCandidates.push_back(y);
+                        }
+                    }
+                }
+                candidates.swap(nextCandidates);
+            }
+            for (int y = 0; y < h; ++y) {
+                integral[(y * w + x) * 2 + 1] = column[y];
+            }
+        }
+    }
+};
+
+// Equivalent to the pano-eval shader, one panorama row per item
+struct PanoEvalCPU::GainJob : public PanoEvalCPU::Job {
+    const PanoEvalCPU& owner;
+    const GLubyte * const pano;
+    const GLint * const integral;
+    GLint * const gain;
+    pthread_mutex_t mutex;
+    GainJob(const PanoEvalCPU& owner, const GLubyte * const pano, const GLint * const integral, GLint * const gain)
+            : owner(owner), pano(pano), integral(integral), gain(gain) {
+        pthread_mutex_init(&mutex, NULL);
+    }
+    virtual ~GainJob() {
+        pthread_mutex_destroy(&mutex);
+    }
+    virtual void run(const size_t begin, const size_t end) {
+        const int w = owner.panoWidth;
+        const int h = owner.panoHeight;
+        const int mw = std::min(owner.mapWidth, MAX_COORDINATE);
+        const int mh = std::min(owner.mapHeight, MAX_COORDINATE);
+        // Accumulate into a local map to avoid synchronizing every atomic max
+        std::vector<GLint> local(owner.mapWidth * owner.mapHeight, 0);
+        for (int y = begin; y < static_cast<int>(end); ++y) {
+            const GLint * const oppositeRow = &integral[(h - 1 - y) * w * 2];
+            for (int x = 0; x < w; ++x) {
+                const GLubyte * const color = &pano[(y * w + x) * 4];
+                const GLint reachable = (color[3] / 255.f <= 0.6f)
+                        & ((color[0] == 0) | (color[1] == 0) | (color[2] == 0) | (color[3] == 0));
+                const int cx = color[0] << 8 | color[1];
+                const int cy = color[3] << 8 | color[2];
+                const float u = (x + 0.5f) / w;
+                const int ox = clamp(static_cast<int>(floorf((u + (u <= 0.5f ? 0.5f : -0.5f)) * w)), w);
+                const GLint value = oppositeRow[ox * 2] * reachable;
+                if (cx < mw && cy < mh) {
+                    GLint& cell = local[cy * owner.mapWidth + cx];
+                    cell = std::max(cell, value);
+                }
+            }
+        }
+        pthread_mutex_lock(&mutex);
+        for (size_t i = 0; i < local.size(); ++i) {
+            gain[i] = std::max(gain[i], local[i]);
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+};
+
+// Equivalent to the utility1 and utility2 shaders, one map row per item
+struct PanoEvalCPU::UtilityJob : public PanoEvalCPU::Job {
+    const PanoEvalCPU& owner;
+    const GLint * const utility;
+    const GLint * const gain1;
+    const GLint * const gain2;
+    GLint * const result;
+    UtilityJob(const PanoEvalCPU& owner, const GLint * const utility, const GLint * const gain1,
+            const GLint * const gain2, GLint * const result)
+            : owner(owner), utility(utility), gain1(gain1), gain2(gain2), result(result) {
+    }
+    GLint getMax(const GLint * const gain, const int x, const int y) const {
+        // Neighborhood offsets as in the vertex shaders, including the repeated last entry
+        static const int offsets[9][2] = {
+                { -1, -1 }, { -1, 0 }, { -1, 1 }, { 0, -1 }, { 0, 0 }, { 0, 1 }, { 1, -1 }, { 1, 0 }, { 1, -1 } };
+        const int w = owner.mapWidth;
+        const int h = owner.mapHeight;
+        GLint maxValue = gain[clamp(sampleIndex(y, offsets[0][1] / 256.f, h), h) * w
+                + clamp(sampleIndex(x, offsets[0][0] / 256.f, w), w)];
+        GLint count = maxValue >= 1;
+        for (size_t i = 1; i < 9; ++i) {
+            const GLint value = gain[clamp(sampleIndex(y, offsets[i][1] / 256.f, h), h) * w
+                    + clamp(sampleIndex(x, offsets[i][0] / 256.f, w), w)];
+            maxValue = std::max(maxValue, value);
+            count += value >= 1;
+        }
+        return (count >= 3) * maxValue;
+    }
+    virtual void run(const size_t begin, const size_t end) {
+        const int w = owner.mapWidth;
+        for (int y = begin; y < static_cast<int>(end); ++y) {
+            for (int x = 0; x < w; ++x) {
+                const GLint gain = getMax(gain1, x, y) + (gain2 ? getMax(gain2, x, y) : 0);
+                result[y * w + x] = utility[y * w + x] - gain * GAIN_WEIGHT;
+            }
+        }
+    }
+};
+
+PanoEvalCPU::PanoEvalCPU(const int panoWidth, const int panoHeight, const int mapWidth, const int mapHeight,
+        const size_t numThreads)
+        : panoWidth(panoWidth), panoHeight(panoHeight), mapWidth(mapWidth), mapHeight(mapHeight),
+          numThreads(std::max(numThreads, static_cast<size_t>(1))) {
+}
+
+PanoEvalCPU::~PanoEvalCPU() {
+}
+
+struct ThreadArgs {
+    void * job;
+    size_t begin;
+    size_t end;
+};
+
+void PanoEvalCPU::parallelFor(Job& job, const size_t n) const {
+    const size_t numJobs = std::min(numThreads, n);
+    if (numJobs <= 1) {
+        job.run(0, n);
+        return;
+    }
+    std::vector<pthread_t> threads(numJobs);
+    std::vector<ThreadArgs> args(numJobs);
+    std::vector<bool> started(numJobs, false);
+    for (size_t i = 0; i < numJobs; ++i) {
+        args[i].job = &job;
+        args[i].begin = n * i / numJobs;
+        args[i].end = n * (i + 1) / numJobs;
+        // The first range is processed by the calling thread
+        if (i > 0) {
+            started[i] = pthread_create(&threads[i], NULL, &PanoEvalCPU::threadMain, &args[i]) == 0;
+            if (!started[i]) {
+                logWarn("Could not create worker thread, processing range in calling thread");
+            }
+        }
+    }
+    for (size_t i = 0; i < numJobs; ++i) {
+        if (!started[i]) {
+            job.run(args[i].begin, args[i].end);
+        }
+    }
+    for (size_t i = 1; i < numJobs; ++i) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+}
+
+void * PanoEvalCPU::threadMain(void * arg) {
+    const ThreadArgs * const args = static_cast<const ThreadArgs *>(arg);
+    static_cast<Job *>(args->job)->run(args->begin, args->end);
+    return NULL;
+}
+
+void PanoEvalCPU::computeIntegral(const GLubyte * const pano, const bool clockwise,
+        std::vector<GLint>& integral) const {
+    integral.resize(panoWidth * panoHeight * 2);
+    EdgeJob edgeJob(*this, pano, clockwise, &integral[0]);
+    parallelFor(edgeJob, panoHeight);
+    RowRunJob rowRunJob(*this, clockwise, &integral[0]);
+    parallelFor(rowRunJob, panoHeight);
+    ColumnRunJob columnRunJob(*this, clockwise, &integral[0]);
+    parallelFor(columnRunJob, panoWidth);
+}
+
+void PanoEvalCPU::computeGain(const GLubyte * const pano, const std::vector<GLint>& integral,
+        std::vector<GLint>& gain) const {
+    gain.assign(mapWidth * mapHeight, 0);
+    GainJob gainJob(*this, pano, &integral[0], &gain[0]);
+    parallelFor(gainJob, panoHeight);
+}
+
+void PanoEvalCPU::computeUtility(const std::vector<GLint>& utility, const std::vector<GLint>& gain1,
+        const std::vector<GLint> * const gain2, std::vector<GLint>& result) const {
+    result.resize(mapWidth * mapHeight);
+    UtilityJob utilityJob(*this, &utility[0], &gain1[0], gain2 ? &(*gain2)[0] : NULL, &result[0]);
+    parallelFor(utilityJob, mapHeight);
+}
+
+void PanoEvalCPU::evaluatePair(const GLubyte * const first, const GLubyte * const second,
+        std::vector<GLint>& utility) const {
+    std::vector<GLint> integral, gain1, gain2, result;
+    computeIntegral(first, false, integral);
+    computeGain(first, integral, gain1);
+    if (second) {
+        computeIntegral(second, true, integral);
+        computeGain(second, integral, gain2);
+    }
+    computeUtility(utility, gain1, second ? &gain2 : NULL, result);
+    utility.swap(result);
+}
+
+} /* namespace gpu_coverage */
@@ -30,6 +30,7 @@
 
 #include <gpu_coverage/CameraPanorama.h>
 #include <gpu_coverage/PanoEvalRenderer.h>
+#include <gpu_coverage/PanoEvalCPU.h>
 #include <gpu_coverage/Utilities.h>
 #include <gpu_coverage/Config.h>
 
@@ -40,6 +41,8 @@
 #include GL_INCLUDE
 #include GLEXT_INCLUDE
 #include <cstdio>
+#include <algorithm>
+#include <unistd.h>
 #ifndef GLM_FORCE_RADIANS
 #define GLM_FORCE_RADIANS
 #endif
@@ -48,15 +51,19 @@
 
 namespace gpu_coverage {
 
+const int PanoEvalRenderer::maxFusedWidth;
+
 PanoEvalRenderer::PanoEvalRenderer(const Scene * const scene, const bool renderToWindow, const bool renderToTexture,
         PanoRenderer * const panoRenderer, AbstractRenderer * const bellmanFordRenderer)
         : AbstractRenderer(scene, "PanoEvalRenderer"),
                 renderToWindow(renderToWindow), renderToTexture(renderToTexture || renderToWindow),
                 benchmark(false),
                 panoRenderer(panoRenderer), progVisualizeIntTexture(NULL),
-                progShowTexture(NULL),
+                progShowTexture(NULL), progUtilityTopKTile(NULL), progUtilityTopKMerge(NULL), progPanoEvalFused(NULL),
+                cpuReference(NULL),
+                topKCandidateBuffer(0), topKResultBuffer(0), topKCapacity(0),
                 numPbo(sizeof(pbo) / sizeof(pbo[0])), maxIterations(2000),
-                textureToVisualize(UTILITY_MAP_1), curUtilityMap(UTILITY_MAP_1)
+                integralFormat(GL_RG32I), textureToVisualize(UTILITY_MAP_1), curUtilityMap(UTILITY_MAP_1)
 {
     if (!progPanoEval.isReady() || !progTLEdge.isReady() || !progTLStep.isReady()
             || !progCounterToFB.isReady() || !progUtility1.isReady() || !progUtility2.isReady()) {
@@ -74,6 +81,21 @@ PanoEvalRenderer::PanoEvalRenderer(const Scene * const scene, const bool renderT
     bellmanFordWidth = bellmanFordRenderer->getTextureWidth();
     bellmanFordHeight = bellmanFordRenderer->getTextureHeight();
 
+    // The tl-step shader extends runs by at most 2 per pixel, so the run lengths in the
+    // integral image are bounded by the panorama extent and not by the image area.
+    const int integralBits = Config::getInstance().getParam<int>("panoIntegralBits");
+    const long maxIntegralValue = 2L * std::max(panoWidth, panoHeight) + 1;
+    if (integralBits == 16) {
+        if (maxIntegralValue <= 32767) {
+            integralFormat = GL_RG16I;
+        } else {
+            logWarn("Panorama size %d x %d exceeds range of 16 bit integral image, using 32 bit",
+                    panoWidth, panoHeight);
+        }
+    } else if (integralBits != 32) {
+        logWarn("Invalid value %d for panoIntegralBits, must be 16 or 32", integralBits);
+    }
+
     if (renderToTexture) {
         progVisualizeIntTexture = new ProgramVisualizeIntTexture();
         if (!progVisualizeIntTexture->isReady()) {
@@ -116,6 +138,51 @@ PanoEvalRenderer::PanoEvalRenderer(const Scene * const scene, const bool renderT
     glUniform1i(progUtility2.locations.gain1Unit, 10);
     glUniform1i(progUtility2.locations.gain2Unit, 11);
 
+    progUtilityTopKTile = new ProgramUtilityTopKTile();
+    progUtilityTopKMerge = new ProgramUtilityTopKMerge();
+    if (progUtilityTopKTile->isReady() && progUtilityTopKMerge->isReady()) {
+        progUtilityTopKTile->use();
+        glUniform1i(progUtilityTopKTile->locations.utilityUnit, 9);
+    } else {
+        logWarn("Compute shaders not available, falling back to CPU for selecting best utilities");
+    }
+
+    if (Config::getInstance().getParam<bool>("panoEvalFused")) {
+        if (!panoRenderer->hasEquirectangularCubemap()) {
+            logWarn("Fused panorama evaluation requires equirectangular panoramas, using separate passes");
+        } else if (panoWidth > maxFusedWidth) {
+            logWarn("Fused panorama evaluation supports panoramas up to width %d, using separate passes",
+                    maxFusedWidth);
+        } else {
+            progPanoEvalFused = new ProgramPanoEvalFused();
+            if (progPanoEvalFused->isReady()) {
+                progPanoEvalFused->use();
+                glUniform1i(progPanoEvalFused->locations.cubeUnit, 10);
+                glUniform1i(progPanoEvalFused->locations.width, panoWidth);
+                glUniform1i(progPanoEvalFused->locations.height, panoHeight);
+                panoRenderer->setProjectToMap(false);
+            } else {
+                logWarn("Compute shaders not available, using separate passes for panorama evaluation");
+                delete progPanoEvalFused;
+                progPanoEvalFused = NULL;
+            }
+        }
+    }
+
+    if (Config::getInstance().getParam<bool>("panoEvalVerify")) {
+#if HAS_GLES
+        logWarn("Checking the panorama evaluation against the CPU requires reading back textures, disabled");
+#else
+        if (progPanoEvalFused) {
+            // the fused evaluation reads the cube map, there is no panorama to hand to the CPU
+            logWarn("Checking the panorama evaluation against the CPU is not supported with panoEvalFused");
+        } else {
+            cpuReference = new PanoEvalCPU(panoWidth, panoHeight, bellmanFordWidth, bellmanFordHeight,
+                    std::max(sysconf(_SC_NPROCESSORS_ONLN), 1L));
+        }
+#endif
+    }
+
     progPanoEval.use();
     glUniform1i(progPanoEval.locations.textureUnit, 10);
     glUniform1i(progPanoEval.locations.integral, 11);
@@ -142,6 +209,12 @@ PanoEvalRenderer::PanoEvalRenderer(const Scene * const scene, const bool renderT
         glBindTexture(GL_TEXTURE_2D, textures[i]);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        if (progPanoEvalFused && (i == SWAP1 || i == SWAP2 || (i == EVAL && !this->renderToTexture))) {
+            // Not used by the fused evaluation, do not allocate storage. EVAL is still bound by
+            // getTexture() and the window visualization, so it is allocated (and left empty) for them.
+            glBindTexture(GL_TEXTURE_2D, 0);
+            continue;
+        }
         switch (i) {
         case EVAL:
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -156,7 +229,7 @@ PanoEvalRenderer::PanoEvalRenderer(const Scene * const scene, const bool renderT
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-            glTexStorage2D(GL_TEXTURE_2D, 1, GL_RG32I, panoWidth, panoHeight);
+            glTexStorage2D(GL_TEXTURE_2D, 1, integralFormat, panoWidth, panoHeight);
             break;
         case COUNTER:
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -216,6 +289,10 @@ PanoEvalRenderer::PanoEvalRenderer(const Scene * const scene, const bool renderT
 
     checkGLError();
 
+    glGenBuffers(1, &topKCandidateBuffer);
+    glGenBuffers(1, &topKResultBuffer);
+    checkGLError();
+
     glGenBuffers(numPbo, pbo);
     for (size_t i = 0; i < numPbo; ++i) {
         glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[i]);
@@ -238,6 +315,21 @@ PanoEvalRenderer::~PanoEvalRenderer() {
         delete progShowTexture;
         progShowTexture = NULL;
     }
+    if (progUtilityTopKTile) {
+        delete progUtilityTopKTile;
+        progUtilityTopKTile = NULL;
+    }
+    if (progUtilityTopKMerge) {
+        delete progUtilityTopKMerge;
+        progUtilityTopKMerge = NULL;
+    }
+    if (progPanoEvalFused) {
+        delete progPanoEvalFused;
+        progPanoEvalFused = NULL;
+    }
+    delete cpuReference;
+    glDeleteBuffers(1, &topKCandidateBuffer);
+    glDeleteBuffers(1, &topKResultBuffer);
     glDeleteBuffers(1, &vbo);
     glDeleteVertexArrays(1, &vao);
     glDeleteTextures(sizeof(textures) / sizeof(textures[0]), textures);
@@ -263,7 +355,11 @@ void PanoEvalRenderer::display() {
     checkGLError();
 
     glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    std::vector<GLint> verifyUtility;
     for (PanoEdgePairs::const_iterator pairIt = panoEdgePairs.begin(); pairIt != panoEdgePairs.end(); ++pairIt) {
+        if (cpuReference) {
+            readIntTexture(textures[curUtilityMap], verifyUtility);
+        }
         // Clear gain maps
         glViewport(0, 0, bellmanFordWidth, bellmanFordHeight);
         GLint clear[4] = {0, 0, 0, 0};
@@ -283,6 +379,28 @@ void PanoEvalRenderer::display() {
                 panoRenderer->display();
                 checkGLError();
             }
+            if (cpuReference) {
+                verifyPanos[iCam].resize(panoWidth * panoHeight * 4);
+                glBindTexture(GL_TEXTURE_2D, panoTexture);
+                glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, &verifyPanos[iCam][0]);
+                glBindTexture(GL_TEXTURE_2D, 0);
+                checkGLError();
+            }
+
+            if (progPanoEvalFused) {
+                // Integral image and evaluation in one pass, one work group per panorama row
+                glBindImageTexture(7, textures[GAIN1 + iCam], 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32I);
+                glActiveTexture(GL_TEXTURE10);
+                glBindTexture(GL_TEXTURE_CUBE_MAP, panoRenderer->getCubemapTexture());
+                progPanoEvalFused->use();
+                glUniform1i(progPanoEvalFused->locations.clockwise, clockwise);
+                glDispatchCompute(1, panoHeight, 1);
+                glBindImageTexture(7, GL_NONE, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32I);
+                glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+                glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+                checkGLError();
+                continue;
+            }
 
             glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
             glBindVertexArray(vao);
@@ -398,6 +516,10 @@ void PanoEvalRenderer::display() {
         glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
         checkGLError();
         //glPopDebugGroup();
+
+        if (cpuReference) {
+            verifyPair(*pairIt, verifyUtility);
+        }
     }
 
     if (renderToTexture) {
@@ -457,4 +579,149 @@ void PanoEvalRenderer::addCameraPair(CameraPanorama * const first, CameraPanoram
 
 }
 
+void PanoEvalRenderer::getTopUtilities(const size_t k, const int minSpacing, const int maxUtility,
+        std::vector<UtilityCell>& result) {
+    result.clear();
+    if (!ready || k == 0) {
+        return;
+    }
+    if (!progUtilityTopKTile->isReady() || !progUtilityTopKMerge->isReady()) {
+        getTopUtilitiesCPU(k, minSpacing, maxUtility, result);
+        return;
+    }
+
+    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 1, -1, "utility-topk");
+    // Tile size must match the local size of the utility-topk-tile shader
+    static const GLuint tileSize = 8;
+    const GLuint tilesX = (bellmanFordWidth + tileSize - 1) / tileSize;
+    const GLuint tilesY = (bellmanFordHeight + tileSize - 1) / tileSize;
+    const GLint numCandidates = tilesX * tilesY * k;
+    if (k > topKCapacity) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, topKCandidateBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, numCandidates * sizeof(UtilityCell), NULL, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, topKResultBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, k * sizeof(UtilityCell), NULL, GL_DYNAMIC_READ);
+        topKCapacity = k;
+        checkGLError();
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, topKCandidateBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, topKResultBuffer);
+
+    // Select best k cells per tile
+    progUtilityTopKTile->use();
+    glUniform1i(progUtilityTopKTile->locations.k, k);
+    glUniform1i(progUtilityTopKTile->locations.maxUtility, maxUtility);
+    glUniform1i(progUtilityTopKTile->locations.minSpacing, minSpacing);
+    glActiveTexture(GL_TEXTURE9);
+    glBindTexture(GL_TEXTURE_2D, textures[curUtilityMap]);
+    glDispatchCompute(tilesX, tilesY, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    checkGLError();
+
+    // Select best k cells from the tile candidates
+    progUtilityTopKMerge->use();
+    glUniform1i(progUtilityTopKMerge->locations.k, k);
+    glUniform1i(progUtilityTopKMerge->locations.numCandidates, numCandidates);
+    glUniform1i(progUtilityTopKMerge->locations.minSpacing, minSpacing);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    checkGLError();
+
+    // Read back k cells only
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, topKResultBuffer);
+    const UtilityCell * const cells = (const UtilityCell *) glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0,
+            k * sizeof(UtilityCell), GL_MAP_READ_BIT);
+    if (cells != NULL) {
+        for (size_t i = 0; i < k && cells[i].valid; ++i) {
+            result.push_back(cells[i]);
+        }
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+    } else {
+        logError("Could not map buffer");
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    checkGLError();
+    glPopDebugGroup();
+}
+
+void PanoEvalRenderer::readIntTexture(const GLuint texture, std::vector<GLint>& values) const {
+#if !HAS_GLES
+    values.resize(bellmanFordWidth * bellmanFordHeight);
+    // the gain maps are written with image stores
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED_INTEGER, GL_INT, &values[0]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    checkGLError();
+#endif
+}
+
+static GLint maxDifference(const std::vector<GLint>& a, const std::vector<GLint>& b) {
+    GLint result = 0;
+    for (size_t i = 0; i < std::min(a.size(), b.size()); ++i) {
+        result = std::max(result, std::abs(a[i] - b[i]));
+    }
+    return result;
+}
+
+void PanoEvalRenderer::verifyPair(const PanoEdgePair& pair, const std::vector<GLint>& utility) {
+    const bool isPair = pair.second.camera != NULL;
+    std::vector<GLint> integral, gains[2], gpuMap, result;
+    GLint maxGainDifference = 0;
+    for (size_t iCam = 0; iCam < (isPair ? 2 : 1); ++iCam) {
+        const bool clockwise = iCam == 0 ? pair.first.clockwise : pair.second.clockwise;
+        cpuReference->computeIntegral(&verifyPanos[iCam][0], clockwise, integral);
+        cpuReference->computeGain(&verifyPanos[iCam][0], integral, gains[iCam]);
+        readIntTexture(textures[GAIN1 + iCam], gpuMap);
+        maxGainDifference = std::max(maxGainDifference, maxDifference(gains[iCam], gpuMap));
+    }
+    cpuReference->computeUtility(utility, gains[0], isPair ? &gains[1] : NULL, result);
+    readIntTexture(textures[curUtilityMap], gpuMap);
+    logInfo("Panorama evaluation against CPU: largest gain difference %d, largest utility difference %d",
+            maxGainDifference, maxDifference(result, gpuMap));
+}
+
+static bool compareUtility(const PanoEvalRenderer::UtilityCell& a, const PanoEvalRenderer::UtilityCell& b) {
+    return a.utility < b.utility;
+}
+
+void PanoEvalRenderer::getTopUtilitiesCPU(const size_t k, const int minSpacing, const int maxUtility,
+        std::vector<UtilityCell>& result) const {
+#if HAS_GLES
+    logError("Selecting best utilities requires compute shaders");
+#else
+    std::vector<GLint> utilityMap(bellmanFordWidth * bellmanFordHeight);
+    glBindTexture(GL_TEXTURE_2D, textures[curUtilityMap]);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED_INTEGER, GL_INT, &utilityMap[0]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    std::vector<UtilityCell> cells;
+    for (GLuint y = 0, i = 0; y < bellmanFordHeight; ++y) {
+        for (GLuint x = 0; x < bellmanFordWidth; ++x, ++i) {
+            if (utilityMap[i] < maxUtility) {
+                const UtilityCell cell = { utilityMap[i], static_cast<GLint>(x), static_cast<GLint>(y), 1 };
+                cells.push_back(cell);
+            }
+        }
+    }
+    std::stable_sort(cells.begin(), cells.end(), compareUtility);
+
+    // Greedy non-maximum suppression over all cells. The utility-topk shaders give the same cells
+    // for minSpacing 0 (up to the order of equal utilities), see getTopUtilities() for minSpacing > 0
+    const int minSpacingSq = minSpacing * minSpacing;
+    for (std::vector<UtilityCell>::const_iterator it = cells.begin(); it != cells.end() && result.size() < k; ++it) {
+        bool suppressed = false;
+        for (std::vector<UtilityCell>::const_iterator rIt = result.begin(); !suppressed && rIt != result.end(); ++rIt) {
+            const int dx = it->x - rIt->x;
+            const int dy = it->y - rIt->y;
+            suppressed = dx * dx + dy * dy < minSpacingSq;
+        }
+        if (!suppressed) {
+            result.push_back(*it);
+        }
+    }
+#endif
+}
+
 } /* namespace gpu_coverage */
@@ -52,7 +52,7 @@ PanoRenderer::PanoRenderer(const Scene * const scene, const bool renderToWindow,
                 renderToWindow(renderToWindow), renderSemantic(Config::getInstance().getParam<bool>("panoSemantic")),
                 camera(NULL),
                 progPano(NULL), progPanoSemantic(NULL), progCostmapIndex(NULL),
-                cubemapWidth(1024), cubemapHeight(1024), progMapProjection(NULL), mapProjectionVao(0),
+                cubemapWidth(1024), cubemapHeight(1024), projectToMap(true), progMapProjection(NULL), mapProjectionVao(0),
                 mapProjectionVbo(0), debug(false), bellmanFordRenderer(bellmanFordRenderer)
 {
     panoOutputFormat = Config::getInstance().getParam<Config::PanoOutputValue>("panoOutputFormat");
@@ -529,15 +529,19 @@ void PanoRenderer::display() {
     // Project to map
     glDisable(GL_DEPTH_TEST);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, GL_NONE, 0);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[PANO], 0);
-    glViewport(0, 0, panoWidth, panoHeight);
-    checkGLError();
-    progMapProjection->use();
-    glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    glBindVertexArray(mapProjectionVao);
-    glDrawArrays(GL_TRIANGLES, 0, mapProjectionCount);
-    glBindVertexArray(0);
+    if (projectToMap) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[PANO], 0);
+        glViewport(0, 0, panoWidth, panoHeight);
+        checkGLError();
+        progMapProjection->use();
+        glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glBindVertexArray(mapProjectionVao);
+        glDrawArrays(GL_TRIANGLES, 0, mapProjectionCount);
+        glBindVertexArray(0);
+    } else {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, GL_NONE, 0);
+    }
     checkGLError();
 
     glViewport(oldViewport[0], oldViewport[1], oldViewport[2], oldViewport[3]);
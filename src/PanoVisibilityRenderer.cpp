@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#include <gpu_coverage/PanoVisibilityRenderer.h>
+#include <gpu_coverage/CameraPanorama.h>
+#include <gpu_coverage/Utilities.h>
+#include <gpu_coverage/Config.h>
+#include <sstream>
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS true
+#endif
+#include <glm/gtc/type_ptr.hpp>
+
+namespace gpu_coverage {
+
+const size_t PanoVisibilityRenderer::maxViews;
+
+PanoVisibilityRenderer::PanoVisibilityRenderer(const Scene * const scene, CameraPanorama * const panoCamera,
+        const AbstractCamera * const camera)
+        : AbstractRenderer(scene, "PanoVisibilityRenderer"), panoCamera(panoCamera), camera(camera),
+                cubemapWidth(1024), cubemapHeight(1024), textureWidth(1024), textureHeight(1024),
+                numTextures(0), viewBuffer(0), gainBuffer(0), numViews(0)
+{
+    std::string targetNames = Config::getInstance().getParam<std::string>("target");
+    if (targetNames.empty()) {
+        logError("No targets defined");
+        return;
+    }
+    std::istringstream iss(targetNames);
+    std::string targetName;
+    while (iss.good()) {
+        iss >> targetName;
+        if (!targetName.empty()) {
+            Node * targetNode = scene->findNode(targetName);
+            if (!targetNode) {
+                logError("Target node %s not found", targetName.c_str());
+                return;
+            }
+            const Texture * texture = targetNode->getMeshes().front()->getMaterial()->getTexture();
+            if (!texture) {
+                logError("Target %s does not have texture image", targetName.c_str());
+                return;
+            }
+            targets.push_back(targetNode);
+            coverageTextures.push_back(texture->getTextureObject());
+        }
+    }
+    if (targets.size() > sizeof(textures) / sizeof(textures[0])) {
+        logError("Too many targets");
+        return;
+    }
+
+    projectionPlaneNode = scene->findNode(Config::getInstance().getParam<std::string>("projectionPlane"));
+    if (!projectionPlaneNode) {
+        logError("Could not find projection plane");
+        return;
+    }
+    if (!panoCamera || !camera) {
+        logError("Could not find camera");
+        return;
+    }
+
+    if (!progPanoSemantic.isReady() || !progPanoVisibility.isReady() || !progPanoVisibilityGain.isReady()) {
+        return;
+    }
+    progPanoVisibility.use();
+    glUniform1f(progPanoVisibility.locations.resolution, static_cast<float>(textureWidth));
+    progPanoVisibilityGain.use();
+    glUniform1i(progPanoVisibilityGain.locations.coverageUnit, 11);
+    checkGLError();
+
+    // Depth cube map
+    glGenTextures(1, &depthCubeMap);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubeMap);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexStorage2D(GL_TEXTURE_CUBE_MAP, 1, GL_DEPTH_COMPONENT24, cubemapWidth, cubemapHeight);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    checkGLError();
+
+    // Position maps
+    numTextures = targets.size();
+    glGenTextures(numTextures, textures);
+    for (size_t i = 0; i < numTextures; ++i) {
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, textureWidth, textureHeight);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    checkGLError();
+
+    glGenFramebuffers(2, framebuffers);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[0]);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubeMap, 0);
+    GLenum drawBuffer = GL_NONE;
+    glDrawBuffers(1, &drawBuffer);
+    if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        logError("Could not create framebuffer and textures for panorama visibility rendering");
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[1]);
+    drawBuffer = GL_COLOR_ATTACHMENT0;
+    glDrawBuffers(1, &drawBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    checkGLError();
+
+    glGenBuffers(1, &viewBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, viewBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, maxViews * sizeof(glm::mat4), NULL, GL_DYNAMIC_DRAW);
+    glGenBuffers(1, &gainBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gainBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, maxViews * sizeof(GLuint), NULL, GL_DYNAMIC_READ);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    checkGLError();
+
+    ready = true;
+}
+
+PanoVisibilityRenderer::~PanoVisibilityRenderer() {
+    glDeleteBuffers(1, &viewBuffer);
+    glDeleteBuffers(1, &gainBuffer);
+    glDeleteTextures(numTextures, textures);
+    glDeleteTextures(1, &depthCubeMap);
+    glDeleteFramebuffers(2, framebuffers);
+    checkGLError();
+}
+
+void PanoVisibilityRenderer::setViews(const std::vector<glm::mat4>& views) {
+    if (!ready) {
+        return;
+    }
+    if (views.size() > maxViews) {
+        logError("Too many views for panorama visibility rendering: %zu > %zu", views.size(), maxViews);
+        numViews = 0;
+        return;
+    }
+    std::vector<glm::mat4> viewProjections;
+    viewProjections.reserve(views.size());
+    for (std::vector<glm::mat4>::const_iterator it = views.begin(); it != views.end(); ++it) {
+        viewProjections.push_back(camera->getProjectionMatrix() * (*it));
+    }
+    numViews = views.size();
+    if (numViews > 0) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, viewBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, numViews * sizeof(glm::mat4), glm::value_ptr(viewProjections[0]));
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    checkGLError();
+}
+
+void PanoVisibilityRenderer::display() {
+    if (!ready) {
+        return;
+    }
+    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 1, -1, "pano-visibility");
+    GLint oldViewport[4];
+    glGetIntegerv(GL_VIEWPORT, oldViewport);
+    GLboolean oldDepthTest = glIsEnabled(GL_DEPTH_TEST);
+
+    // Clear position maps
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[1]);
+    glViewport(0, 0, textureWidth, textureHeight);
+    const GLfloat clear[4] = { 0.f, 0.f, 0.f, 0.f };
+    for (size_t i = 0; i < numTextures; ++i) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[i], 0);
+        glClearBufferfv(GL_COLOR, 0, clear);
+    }
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, GL_NONE, 0);
+    checkGLError();
+
+    // Render obstacles to depth cube map
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[0]);
+    glViewport(0, 0, cubemapWidth, cubemapHeight);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    progPanoSemantic.use();
+    glUniform1i(progPanoSemantic.locationsMaterial.hasTexture, GL_FALSE);
+    std::vector<bool> targetsVisible;
+    for (Targets::const_iterator targetIt = targets.begin(); targetIt != targets.end(); ++targetIt) {
+        targetsVisible.push_back((*targetIt)->isVisible());
+        (*targetIt)->setVisible(false);
+    }
+    const bool projectionPlaneVisible = projectionPlaneNode->isVisible();
+    projectionPlaneNode->setVisible(false);
+    scene->render(panoCamera, &progPanoSemantic.locationsMVP, NULL, NULL, false);
+    std::vector<bool>::const_iterator tvIt = targetsVisible.begin();
+    for (Targets::const_iterator targetIt = targets.begin(); targetIt != targets.end(); ++targetIt, ++tvIt) {
+        (*targetIt)->setVisible(*tvIt);
+    }
+    projectionPlaneNode->setVisible(projectionPlaneVisible);
+    checkGLError();
+
+    // Reset gains
+    std::vector<GLuint> zeros(maxViews, 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gainBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, maxViews * sizeof(GLuint), &zeros[0]);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, viewBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, gainBuffer);
+
+    size_t targetI = 0;
+    for (Targets::const_iterator targetIt = targets.begin(); targetIt != targets.end(); ++targetIt, ++targetI) {
+        // Render target and store observed positions in position map
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[0]);
+        progPanoVisibility.use();
+        glBindImageTexture(7, textures[targetI], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+        std::vector<glm::mat4> view;
+        panoCamera->setViewProjection(progPanoVisibility.locationsMVP, view);
+        (*targetIt)->render(view, &progPanoVisibility.locationsMVP, NULL, false);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        checkGLError();
+
+        // Count observed texels for each view
+        if (numViews > 0) {
+            progPanoVisibilityGain.use();
+            glUniform1i(progPanoVisibilityGain.locations.numViews, numViews);
+            glBindImageTexture(7, textures[targetI], 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+            glActiveTexture(GL_TEXTURE11);
+            glBindTexture(GL_TEXTURE_2D, coverageTextures[targetI]);
+            glDispatchCompute((textureWidth + 15) / 16, (textureHeight + 15) / 16, 1);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            checkGLError();
+        }
+        glBindImageTexture(7, GL_NONE, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!oldDepthTest) {
+        glDisable(GL_DEPTH_TEST);
+    }
+    glViewport(oldViewport[0], oldViewport[1], oldViewport[2], oldViewport[3]);
+    glPopDebugGroup();
+    checkGLError();
+}
+
+void PanoVisibilityRenderer::getGains(std::vector<GLuint>& gains) {
+    gains.clear();
+    if (!ready || numViews == 0) {
+        return;
+    }
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gainBuffer);
+    const GLuint * const ptr = (const GLuint *) glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0,
+            numViews * sizeof(GLuint), GL_MAP_READ_BIT);
+    if (ptr != NULL) {
+        gains.insert(gains.begin(), ptr, ptr + numViews);
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+    } else {
+        logError("Could not map buffer");
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    checkGLError();
+}
+
+}  // namespace gpu_coverage
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#include <gpu_coverage/ParallelTemperingTask.h>
+#include <gpu_coverage/VisibilityRenderer.h>
+#include <gpu_coverage/Config.h>
+#include <gpu_coverage/Utilities.h>
+
+#include <algorithm>
+#include <cmath>
+#include <sys/mman.h>
+
+namespace gpu_coverage {
+
+double *ParallelTemperingTask::chainStates = NULL;
+size_t ParallelTemperingTask::chainStatesSize = 0;
+
+ParallelTemperingTask::ParallelTemperingTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData,
+        const size_t numIterations)
+        : CmaEsTask(scene, threadNr, sharedData, numIterations),
+          numChains(std::max(Config::getInstance().getParam<int>("temperingChains"), 1)),
+          numSweeps(std::max(Config::getInstance().getParam<int>("temperingSweeps"), 1)),
+          exchangeInterval(std::max(Config::getInstance().getParam<int>("temperingExchangeInterval"), 1)),
+          stepSize(Config::getInstance().getParam<float>("temperingStepSize"))
+{
+    for (size_t k = 0; k < numChains; ++k) {
+        temperatures.push_back(getTemperature(threadNr * numChains + k, sharedData->numThreads * numChains));
+    }
+}
+
+ParallelTemperingTask::~ParallelTemperingTask() {
+}
+
+double ParallelTemperingTask::getTemperature(const size_t chain, const size_t numChains) {
+    const double minTemperature = Config::getInstance().getParam<float>("temperingMinTemperature");
+    const double maxTemperature = Config::getInstance().getParam<float>("temperingMaxTemperature");
+    if (numChains < 2 || minTemperature <= 0.) {
+        return minTemperature;
+    }
+    // geometric ladder, the first chain is the coldest
+    return minTemperature * pow(maxTemperature / minTemperature, static_cast<double>(chain) / (numChains - 1));
+}
+
+void ParallelTemperingTask::propose(const std::vector<double>& x, std::vector<double>& proposal) {
+    proposal = x;
+    if (numArticulations > 0 && uniform() < 0.5) {
+        // one articulated object to a random value, the others to the zero configuration
+        const size_t a = std::min(static_cast<size_t>(uniform() * numArticulations), numArticulations - 1);
+        for (size_t b = 0; b < numArticulations; ++b) {
+            proposal[b] = a == b ? uniform() : 0.;
+        }
+        return;
+    }
+    for (size_t d = numArticulations; d < proposal.size(); ++d) {
+        proposal[d] += (2. * uniform() - 1.) * stepSize;
+    }
+    // yaw is periodic, see decode()
+    double& yaw = proposal[numArticulations + 3];
+    yaw -= floor(yaw);
+    for (size_t d = numArticulations; d < proposal.size(); ++d) {
+        proposal[d] = std::min(1., std::max(0., proposal[d]));
+    }
+}
+
+size_t ParallelTemperingTask::exchangeReplicas(std::vector<std::vector<double> >& states, std::vector<double>& evals,
+        const size_t exchange, bool& failed) {
+    const size_t dimension = getDimension();
+    const size_t stride = dimension + 1;
+    const size_t totalChains = sharedData->numThreads * numChains;
+    for (size_t k = 0; k < numChains; ++k) {
+        double * const state = chainStates + (threadNr * numChains + k) * stride;
+        std::copy(states[k].begin(), states[k].end(), state);
+        state[dimension] = evals[k];
+    }
+
+    // Wait for the states of all workers
+    pthread_barrier_wait(&sharedData->barrier);
+
+    size_t numSwaps = 0;
+    if (threadNr == 0) {
+        for (size_t c = exchange % 2; c + 1 < totalChains; c += 2) {
+            double * const cold = chainStates + c * stride;
+            double * const hot = chainStates + (c + 1) * stride;
+            const double exponent = (hot[dimension] - cold[dimension])
+                    * (1. / getTemperature(c, totalChains) - 1. / getTemperature(c + 1, totalChains));
+            if (exponent >= 0. || uniform() < exp(exponent)) {
+                std::swap_ranges(cold, cold + stride, hot);
+                ++numSwaps;
+            }
+        }
+    }
+
+    // Wait for the swaps
+    pthread_barrier_wait(&sharedData->barrier);
+    // Failures are only published while rendering, never between these barriers, so all workers read the same value
+    failed = failed || taskSharedData->failed;
+    for (size_t k = 0; k < numChains; ++k) {
+        const double * const state = chainStates + (threadNr * numChains + k) * stride;
+        states[k].assign(state, state + dimension);
+        evals[k] = state[dimension];
+    }
+
+    // Wait until all states have been read before the next exchange writes them
+    pthread_barrier_wait(&sharedData->barrier);
+    return numSwaps;
+}
+
+size_t ParallelTemperingTask::search(RobotSceneConfiguration& bestConfiguration, float& bestEval) {
+    // All chains start at the current configuration, which has an evaluation of 0
+    std::vector<double> start;
+    encode(taskSharedData->currentConfiguration, start);
+    std::vector<std::vector<double> > states(numChains, start);
+    std::vector<double> evals(numChains, 0.);
+    std::vector<std::vector<double> > proposals(numChains);
+    std::vector<GLuint> visibilityResults;
+    RobotSceneConfiguration candidate;
+    size_t numRenders = 0;
+    size_t numAccepted = 0;
+    size_t numSwaps = 0;
+    size_t numExchanges = 0;
+    bool failed = false;
+
+    for (size_t sweep = 0; sweep < numSweeps; ++sweep) {
+        // A failed worker skips its sweeps, but still takes part in the exchanges, after which all workers stop
+        if (!failed) {
+            // Render the proposals of all chains of this worker as one batch, read back once
+            for (size_t k = 0; k < numChains; ++k) {
+                propose(states[k], proposals[k]);
+                decode(proposals[k], candidate);
+                candidate.applyToScene(scene);
+                cameraNode->setLocalTransform(candidate.getCameraLocalTransform());
+                visibilityRenderer->display();
+            }
+            visibilityRenderer->getPixelCounts(visibilityResults);
+            if (visibilityResults.size() != numChains) {
+                logError("Visibility results count does not match chains count");
+                taskSharedData->failed = true;
+                failed = true;
+            } else {
+                numRenders += visibilityResults.size();
+                for (size_t k = 0; k < numChains; ++k) {
+                    decode(proposals[k], candidate);
+                    candidate.setCount(visibilityResults[k]);
+                    const float eval = candidate.getEvaluation(taskSharedData->currentConfiguration);
+                    if (eval > bestEval) {
+                        bestEval = eval;
+                        bestConfiguration.set(candidate);
+                    }
+                    // Metropolis acceptance at the temperature of the chain
+                    const double delta = eval - evals[k];
+                    if (delta >= 0. || (temperatures[k] > 0. && uniform() < exp(delta / temperatures[k]))) {
+                        states[k].swap(proposals[k]);
+                        evals[k] = eval;
+                        ++numAccepted;
+                    }
+                }
+            }
+        }
+
+        if ((sweep + 1) % exchangeInterval == 0 && sweep + 1 < numSweeps) {
+            numSwaps += exchangeReplicas(states, evals, numExchanges, failed);
+            ++numExchanges;
+            if (failed) {
+                return 0;
+            }
+        }
+    }
+    if (failed) {
+        return 0;
+    }
+
+    logInfo("[%zu] %zu of %zu moves accepted", threadNr, numAccepted, numRenders);
+    if (threadNr == 0 && numExchanges > 0) {
+        logInfo("%zu replica swaps in %zu exchanges", numSwaps, numExchanges);
+    }
+    return numRenders;
+}
+
+void ParallelTemperingTask::allocateSharedData(const size_t numThreads) {
+    CmaEsTask::allocateSharedData(numThreads);
+    if (!chainStates) {
+        const size_t numChains = std::max(Config::getInstance().getParam<int>("temperingChains"), 1);
+        // a chain state is a candidate vector followed by its evaluation
+        const size_t stride = getDimension(RobotSceneConfiguration::numArticulation) + 1;
+        chainStatesSize = numThreads * numChains * stride * sizeof(double);
+        chainStates = (double *) mmap(NULL, chainStatesSize,
+                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    }
+}
+
+void ParallelTemperingTask::freeSharedData() {
+    if (chainStates) {
+        munmap(chainStates, chainStatesSize);
+        chainStates = NULL;
+    }
+    CmaEsTask::freeSharedData();
+}
+
+} /* namespace gpu_coverage */
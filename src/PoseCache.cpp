@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#include <gpu_coverage/PoseCache.h>
+#include <gpu_coverage/Config.h>
+#include <gpu_coverage/Utilities.h>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+namespace gpu_coverage {
+
+const uint32_t PoseCache::magic;
+const uint32_t PoseCache::version;
+
+size_t PoseCache::getSize(const size_t capacity) {
+    size_t entries = 1;
+    while (entries < capacity) {
+        entries <<= 1;
+    }
+    return sizeof(PoseCache) + entries * sizeof(Entry);
+}
+
+PoseCache * PoseCache::create(void * const memory, const size_t capacity) {
+    PoseCache * const cache = static_cast<PoseCache *>(memory);
+    size_t entries = 1;
+    while (entries < capacity) {
+        entries <<= 1;
+    }
+    cache->mask = entries - 1;
+    cache->hits = 0;
+    cache->misses = 0;
+    Entry * const table = cache->getEntries();
+    for (size_t i = 0; i < entries; ++i) {
+        table[i].key = 0;
+        table[i].value = 0;
+    }
+    return cache;
+}
+
+uint64_t PoseCache::hash(const void * const data, const size_t size, const uint64_t seed) {
+    const unsigned char * const bytes = static_cast<const unsigned char *>(data);
+    uint64_t h = seed;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= bytes[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+uint64_t PoseCache::getSceneState(const std::string& mode, const glm::mat4& projection, const int textureWidth,
+        const int textureHeight) {
+    const Config& config = Config::getInstance();
+    uint64_t state = 0xcbf29ce484222325ull;
+    // include the terminator to separate the strings
+    state = hash(mode.c_str(), mode.size() + 1, state);
+    const char * const params[] = { "file", "target", "robotCamera" };
+    for (size_t p = 0; p < sizeof(params) / sizeof(params[0]); ++p) {
+        const std::string value = config.getParam<std::string>(params[p]);
+        state = hash(value.c_str(), value.size() + 1, state);
+    }
+    const uint8_t panoOrientationSearch = config.getParam<bool>("panoOrientationSearch") ? 1 : 0;
+    state = hash(&panoOrientationSearch, sizeof(panoOrientationSearch), state);
+    const int32_t size[2] = { textureWidth, textureHeight };
+    state = hash(size, sizeof(size), state);
+    state = hash(&projection[0][0], 16 * sizeof(float), state);
+    return state;
+}
+
+uint64_t PoseCache::getKey(const RobotSceneConfiguration& configuration, const uint64_t state) {
+    // Quantize to 0.1 mm and 1e-4 for the rotation and articulation, so that
+    // rounding noise does not prevent hits on the same pose
+    static const float resolution = 1e4f;
+    std::vector<int32_t> quantized;
+    quantized.reserve(16 + RobotSceneConfiguration::numArticulation);
+    const glm::mat4& transform = configuration.getCameraLocalTransform();
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) {
+            quantized.push_back(static_cast<int32_t>(floorf(transform[c][r] * resolution + 0.5f)));
+        }
+    }
+    for (size_t a = 0; a < RobotSceneConfiguration::numArticulation; ++a) {
+        quantized.push_back(static_cast<int32_t>(floorf(configuration.getArticulation(a) * resolution + 0.5f)));
+    }
+    const uint64_t key = hash(&quantized[0], quantized.size() * sizeof(int32_t), state);
+    // 0 marks empty entries
+    return key != 0 ? key : 1;
+}
+
+bool PoseCache::lookup(const uint64_t key, GLuint& count) {
+    const Entry * const table = getEntries();
+    for (size_t p = 0; p < probeLength; ++p) {
+        const Entry& entry = table[(key + p) & mask];
+        if (entry.key == key) {
+            __sync_synchronize();
+            const uint64_t value = entry.value;
+            if ((value & 0xffffffff00000000ull) == (key & 0xffffffff00000000ull) && value != 0) {
+                count = static_cast<GLuint>(value & 0xffffffffu);
+                __sync_fetch_and_add(&hits, 1);
+                return true;
+            }
+            // entry is being written or replaced
+            break;
+        }
+    }
+    __sync_fetch_and_add(&misses, 1);
+    return false;
+}
+
+void PoseCache::insert(const uint64_t key, const GLuint count) {
+    Entry * const table = getEntries();
+    for (size_t p = 0; p < probeLength; ++p) {
+        Entry& entry = table[(key + p) & mask];
+        if (entry.key == key || __sync_bool_compare_and_swap(&entry.key, 0, key)) {
+            __sync_synchronize();
+            entry.value = packValue(key, count);
+            return;
+        }
+    }
+    // All slots taken, replace one of them chosen by the key
+    Entry& entry = table[(key + (key >> 56) % probeLength) & mask];
+    entry.value = 0;
+    __sync_synchronize();
+    entry.key = key;
+    __sync_synchronize();
+    entry.value = packValue(key, count);
+}
+
+size_t PoseCache::load(const std::string& filename) {
+    FILE * const file = fopen(filename.c_str(), "rb");
+    if (!file) {
+        return 0;
+    }
+    uint32_t header[2];
+    uint64_t numEntries;
+    if (fread(header, sizeof(header), 1, file) != 1 || header[0] != magic || header[1] != version
+            || fread(&numEntries, sizeof(numEntries), 1, file) != 1) {
+        logWarn("Ignoring invalid pose cache file %s", filename.c_str());
+        fclose(file);
+        return 0;
+    }
+    size_t numLoaded = 0;
+    Entry entry;
+    for (; numLoaded < numEntries && fread(&entry, sizeof(entry), 1, file) == 1; ++numLoaded) {
+        insert(entry.key, static_cast<GLuint>(entry.value & 0xffffffffu));
+    }
+    fclose(file);
+    return numLoaded;
+}
+
+bool PoseCache::save(const std::string& filename) const {
+    const Entry * const table = getEntries();
+    std::vector<Entry> entries;
+    for (size_t i = 0; i <= mask; ++i) {
+        if (table[i].key != 0 && table[i].value != 0) {
+            entries.push_back(table[i]);
+        }
+    }
+    // Written to a temporary file first, so that an interrupted run keeps the previous cache
+    const std::string tmpFilename = filename + ".tmp";
+    FILE * const file = fopen(tmpFilename.c_str(), "wb");
+    if (!file) {
+        logError("Could not write pose cache file %s", tmpFilename.c_str());
+        return false;
+    }
+    const uint32_t header[2] = { magic, version };
+    const uint64_t numEntries = entries.size();
+    bool success = fwrite(header, sizeof(header), 1, file) == 1
+            && fwrite(&numEntries, sizeof(numEntries), 1, file) == 1
+            && (entries.empty() || fwrite(&entries[0], sizeof(Entry), entries.size(), file) == entries.size());
+    success &= fclose(file) == 0;
+    if (!success || rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+        logError("Could not write pose cache file %s", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+} /* namespace gpu_coverage */
@@ -60,6 +60,8 @@ static struct {
     const int glslCore;
     const int esCore;
 } EXTENSIONS[] = {
+        { "compute_shader", 430, 310 },
+        { "shader_storage_buffer_object", 430, 310 },
         { "shader_image_load_store", 430, 330 },
         { "explicit_attrib_location", 430, 300 },
         { "shader_atomic_counters", 420, 310 },
@@ -1111,6 +1113,7 @@ ProgramBellmanFordXfbInit::ProgramBellmanFordXfbInit() {
 
     locations.resolution = glGetUniformLocation(program, "resolution");
     locations.robotPosition = glGetUniformLocation(program, "robot_position");
+    locations.source = glGetUniformLocation(program, "source");
 
 	checkGLError();
 	ready = true;
@@ -1266,4 +1269,256 @@ ProgramUtility2::~ProgramUtility2() {
 
 }
 
+ProgramUtilityTopKTile::ProgramUtilityTopKTile() {
+    checkGLError();
+    const GLuint computeShader = loadShader(GL_COMPUTE_SHADER, DATADIR "/shaders/utility-topk-tile/compute.shader");
+    if (computeShader == 0) {
+        return;
+    }
+
+    glAttachShader(program, computeShader);
+    const bool isLinked = link("utility-topk-tile");
+    glDeleteShader(computeShader);
+    if (!isLinked) {
+        return;
+    }
+
+    locations.utilityUnit = glGetUniformLocation(program, "utility_unit");
+    locations.k = glGetUniformLocation(program, "k");
+    locations.maxUtility = glGetUniformLocation(program, "max_utility");
+    locations.minSpacing = glGetUniformLocation(program, "min_spacing");
+
+    checkGLError();
+    ready = true;
+}
+
+ProgramUtilityTopKTile::~ProgramUtilityTopKTile() {
+
+}
+
+ProgramUtilityTopKMerge::ProgramUtilityTopKMerge() {
+    checkGLError();
+    const GLuint computeShader = loadShader(GL_COMPUTE_SHADER, DATADIR "/shaders/utility-topk-merge/compute.shader");
+    if (computeShader == 0) {
+        return;
+    }
+
+    glAttachShader(program, computeShader);
+    const bool isLinked = link("utility-topk-merge");
+    glDeleteShader(computeShader);
+    if (!isLinked) {
+        return;
+    }
+
+    locations.k = glGetUniformLocation(program, "k");
+    locations.numCandidates = glGetUniformLocation(program, "num_candidates");
+    locations.minSpacing = glGetUniformLocation(program, "min_spacing");
+
+    checkGLError();
+    ready = true;
+}
+
+ProgramUtilityTopKMerge::~ProgramUtilityTopKMerge() {
+
+}
+
+ProgramPanoVisibility::ProgramPanoVisibility() {
+    checkGLError();
+    const GLuint vertexShader = loadShader(GL_VERTEX_SHADER, DATADIR "/shaders/pano-visibility/vertex.shader");
+    if (vertexShader == 0) {
+        return;
+    }
+    const GLuint geometryShader = loadShader(GL_GEOMETRY_SHADER, DATADIR "/shaders/pano-visibility/geometry.shader");
+    if (geometryShader == 0) {
+        return;
+    }
+    const GLuint fragmentShader = loadShader(GL_FRAGMENT_SHADER, DATADIR "/shaders/pano-visibility/fragment.shader");
+    if (fragmentShader == 0) {
+        return;
+    }
+
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, geometryShader);
+    glAttachShader(program, fragmentShader);
+    const bool isLinked = link("pano-visibility");
+    glDeleteShader(vertexShader);
+    glDeleteShader(geometryShader);
+    glDeleteShader(fragmentShader);
+    if (!isLinked) {
+        return;
+    }
+
+    locations.resolution = glGetUniformLocation(program, "resolution");
+    locationsMVP.modelMatrix = glGetUniformLocation(program, "model_matrix");
+    locationsMVP.projectionMatrix = glGetUniformLocation(program, "projection_matrix");
+    for (size_t i = 0; i < 6; ++i) {
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer), "view_matrix[%zu]", i);
+        locationsMVP.viewMatrix[i] = glGetUniformLocation(program, buffer);
+    }
+
+    checkGLError();
+    ready = true;
+}
+
+ProgramPanoVisibility::~ProgramPanoVisibility() {
+
+}
+
+ProgramPanoVisibilityGain::ProgramPanoVisibilityGain() {
+    checkGLError();
+    const GLuint computeShader = loadShader(GL_COMPUTE_SHADER, DATADIR "/shaders/pano-visibility-gain/compute.shader");
+    if (computeShader == 0) {
+        return;
+    }
+
+    glAttachShader(program, computeShader);
+    const bool isLinked = link("pano-visibility-gain");
+    glDeleteShader(computeShader);
+    if (!isLinked) {
+        return;
+    }
+
+    locations.numViews = glGetUniformLocation(program, "num_views");
+    locations.coverageUnit = glGetUniformLocation(program, "coverage_unit");
+
+    checkGLError();
+    ready = true;
+}
+
+ProgramPanoVisibilityGain::~ProgramPanoVisibilityGain() {
+
+}
+
+ProgramPanoEvalFused::ProgramPanoEvalFused() {
+    checkGLError();
+    const GLuint computeShader = loadShader(GL_COMPUTE_SHADER, DATADIR "/shaders/pano-eval-fused/compute.shader");
+    if (computeShader == 0) {
+        return;
+    }
+
+    glAttachShader(program, computeShader);
+    const bool isLinked = link("pano-eval-fused");
+    glDeleteShader(computeShader);
+    if (!isLinked) {
+        return;
+    }
+
+    locations.cubeUnit = glGetUniformLocation(program, "cube_unit");
+    locations.width = glGetUniformLocation(program, "width");
+    locations.height = glGetUniformLocation(program, "height");
+    locations.clockwise = glGetUniformLocation(program, "clockwise");
+
+    checkGLError();
+    ready = true;
+}
+
+ProgramPanoEvalFused::~ProgramPanoEvalFused() {
+
+}
+
+ProgramReversePatches::ProgramReversePatches() {
+    checkGLError();
+    const GLuint vertexShader = loadShader(GL_VERTEX_SHADER, DATADIR "/shaders/reverse-patches/vertex.shader");
+    if (vertexShader == 0) {
+        return;
+    }
+    const GLuint fragmentShader = loadShader(GL_FRAGMENT_SHADER, DATADIR "/shaders/reverse-patches/fragment.shader");
+    if (fragmentShader == 0) {
+        return;
+    }
+
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    const bool isLinked = link("reverse-patches");
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    if (!isLinked) {
+        return;
+    }
+
+    locationsMVP.modelMatrix = glGetUniformLocation(program, "model_matrix");
+
+    checkGLError();
+    ready = true;
+}
+
+ProgramReversePatches::~ProgramReversePatches() {
+
+}
+
+ProgramReverseDepth::ProgramReverseDepth() {
+    checkGLError();
+    const GLuint vertexShader = loadShader(GL_VERTEX_SHADER, DATADIR "/shaders/reverse-depth/vertex.shader");
+    if (vertexShader == 0) {
+        return;
+    }
+    const GLuint fragmentShader = loadShader(GL_FRAGMENT_SHADER, DATADIR "/shaders/reverse-depth/fragment.shader");
+    if (fragmentShader == 0) {
+        return;
+    }
+
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    const bool isLinked = link("reverse-depth");
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    if (!isLinked) {
+        return;
+    }
+
+    locationsMVP.modelMatrix = glGetUniformLocation(program, "model_matrix");
+    locationsMVP.viewMatrix[0] = glGetUniformLocation(program, "view_matrix");
+    locationsMVP.projectionMatrix = glGetUniformLocation(program, "projection_matrix");
+
+    checkGLError();
+    ready = true;
+}
+
+ProgramReverseDepth::~ProgramReverseDepth() {
+
+}
+
+ProgramReverseGather::ProgramReverseGather() {
+    checkGLError();
+    const GLuint vertexShader = loadShader(GL_VERTEX_SHADER, DATADIR "/shaders/reverse-gather/vertex.shader");
+    if (vertexShader == 0) {
+        return;
+    }
+    const GLuint fragmentShader = loadShader(GL_FRAGMENT_SHADER, DATADIR "/shaders/reverse-gather/fragment.shader");
+    if (fragmentShader == 0) {
+        return;
+    }
+
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    const bool isLinked = link("reverse-gather");
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    if (!isLinked) {
+        return;
+    }
+
+    locations.depthUnit = glGetUniformLocation(program, "depth_unit");
+    locations.patchViewProjection = glGetUniformLocation(program, "patch_view_projection");
+    locations.patchPosition = glGetUniformLocation(program, "patch_position");
+    locations.patchNormal = glGetUniformLocation(program, "patch_normal");
+    locations.clipNear = glGetUniformLocation(program, "clip_near");
+    locations.clipFar = glGetUniformLocation(program, "clip_far");
+    locations.bias = glGetUniformLocation(program, "bias");
+    locations.weight = glGetUniformLocation(program, "weight");
+    locations.gridOrigin = glGetUniformLocation(program, "grid_origin");
+    locations.cellSize = glGetUniformLocation(program, "cell_size");
+    locations.useFrustum = glGetUniformLocation(program, "use_frustum");
+    locations.lookAt = glGetUniformLocation(program, "look_at");
+    locations.cameraProjection = glGetUniformLocation(program, "camera_projection");
+
+    checkGLError();
+    ready = true;
+}
+
+ProgramReverseGather::~ProgramReverseGather() {
+
+}
+
 } /* namespace gpu_coverage */
@@ -36,6 +36,10 @@
 #include <gpu_coverage/Config.h>
 #include <gpu_coverage/Utilities.h>
 #include <gpu_coverage/Channel.h>
+#include <gpu_coverage/Sampler.h>
+#include <gpu_coverage/Checkpoint.h>
+#include <gpu_coverage/PoseCache.h>
+#include <gpu_coverage/CandidateBatch.h>
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
@@ -52,14 +56,29 @@
 namespace gpu_coverage {
 
 RandomSearchTask::TaskSharedData *RandomSearchTask::taskSharedData = NULL;
+SharedBest *RandomSearchTask::sharedBest = NULL;
+PoseCache *RandomSearchTask::poseCache = NULL;
+size_t RandomSearchTask::sharedDataSize = 0;
 
 RandomSearchTask::RandomSearchTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData,
         const size_t numIterations, const size_t numArticulationConfigs, const size_t numCameraPoses)
         : AbstractTask(sharedData, threadNr), scene(scene),
                 numIterations(numIterations), numArticulationConfigs(numArticulationConfigs), numCameraPoses(
                         numCameraPoses), numArticulations(scene->getChannels().size()),
-                costmapRenderer(NULL), bellmanFordRenderer(NULL), visibilityRenderer(NULL)
+                costmapRenderer(NULL), bellmanFordRenderer(NULL), visibilityRenderer(NULL),
+                candidatePool(numArticulationConfigs * (numCameraPoses + 1)),
+                candidateBatch(numArticulationConfigs * numCameraPoses),
+                pipelined(Config::getInstance().getParam<bool>("randomSearchPipelined")),
+                samplerType(Config::getInstance().getParam<std::string>("sampler")),
+                sampleFreeSpace(Config::getInstance().getParam<bool>("samplerFreeSpace")),
+                pruneCandidates(Config::getInstance().getParam<bool>("randomSearchPruning")),
+                checkpointInterval(std::max(Config::getInstance().getParam<int>("checkpointInterval"), 0)),
+                checkpoint(NULL), coverageState(0)
 {
+    if (!sharedBest) {
+        // Too many workers for the shared reduction, see SharedBest::create()
+        return;
+    }
     // Get scene nodes
     Node * const projectionPlane = scene->findNode(Config::getInstance().getParam<std::string>("projectionPlane"));
     Material * const costmapMaterial = projectionPlane->getMeshes().front()->getMaterial();
@@ -82,6 +101,10 @@ RandomSearchTask::RandomSearchTask(Scene * const scene, const size_t threadNr, S
     if (!visibilityRenderer->isReady()) {
         return;
     }
+    const CameraPerspective * const robotCamera = scene->findCamera(
+            Config::getInstance().getParam<std::string>("robotCamera"));
+    coverageState = PoseCache::getSceneState("random", robotCamera ? robotCamera->getProjectionMatrix() : glm::mat4(),
+            visibilityRenderer->getTextureWidth(), visibilityRenderer->getTextureHeight());
     renderer = new Renderer(scene, false, true);
     if (!renderer->isReady()) {
         return;
@@ -108,17 +131,24 @@ RandomSearchTask::RandomSearchTask(Scene * const scene, const size_t threadNr, S
     if (threadNr == 0) {
         // First thread initializes current robot pose and articulation
         taskSharedData->bestEval = -std::numeric_limits<float>::max();
-        taskSharedData->currentConfiguration.setArticulation(0, 0.f);
+        for (size_t a = 0; a < numArticulations; ++a) {
+            taskSharedData->currentConfiguration.setArticulation(a, 0.f);
+        }
         taskSharedData->currentConfiguration.setCameraLocalTransform(cameraNode->getLocalTransform());
         taskSharedData->currentConfiguration.setCount(0);
         taskSharedData->finished = false;
     }
 
+    if (checkpointInterval > 0) {
+        checkpoint = new Checkpoint(Config::getInstance().getParam<std::string>("checkpointFile"), "random");
+    }
+
     ready = true;
 
 }
 
 RandomSearchTask::~RandomSearchTask() {
+    delete checkpoint;
     delete costmapRenderer;
     delete bellmanFordRenderer;
     delete visibilityRenderer;
@@ -130,72 +160,186 @@ void RandomSearchTask::run() {
         return;
     }
     const glm::vec3 worldUp(0.f, 0.f, -1.f);
-
-    for (size_t i = 0; i < numIterations; ++i) {
+    // Reused across iterations to avoid heap allocations in the search loop
+    std::vector<RobotSceneConfiguration *> configurations;
+    configurations.reserve(numArticulationConfigs * numCameraPoses);
+    std::vector<GLuint> visibilityResults;
+    visibilityResults.reserve(numArticulationConfigs * numCameraPoses);
+    std::vector<GLuint> pendingResults;
+    std::vector<RobotSceneConfiguration *> cachedConfigurations;
+
+    // The random numbers of each iteration are derived from the seed at the start of the run,
+    // so that a run resumed from a checkpoint continues with the same candidates
+    size_t firstIteration = 0;
+    unsigned int baseSeed = seed;
+    if (checkpoint) {
+        if (checkpoint->load()) {
+            if (!resume(firstIteration, baseSeed)) {
+                logError("Could not resume from checkpoint, delete it to start over");
+                return;
+            }
+            logInfo("[%zu] Resuming at iteration %zu", threadNr, firstIteration);
+        }
+        pthread_barrier_wait(&sharedData->barrier);
+    }
+    std::vector<float> articulationSamples;
+    std::vector<float> cameraSamples;
+    std::vector<GLint> costs;
+    std::vector<GLint> distances;
+    std::vector<unsigned char> allowedCells;
+    size_t numRejected = 0;
+    size_t numPruned = 0;
+    // Upper bound of the number of observed pixels, for bounding the gain of a candidate
+    const float maxCount = static_cast<float>(numTargetTextures) * visibilityRenderer->getTextureWidth()
+            * visibilityRenderer->getTextureHeight();
+    // Measured stage timings for fitting the iterations into the time budget
+    double batchTime = 0.;      // rendering and evaluating one articulation batch
+    double tailTime = 0.;       // reduction and re-rendering of the best candidate
+
+    for (size_t i = firstIteration; i < numIterations; ++i) {
+        const double iterationStart = getTime();
+        if (checkpoint && threadNr == 0) {
+            // Write the last checkpoint as soon as its textures have arrived
+            checkpoint->poll();
+        }
+        unsigned int iterationSeed = baseSeed + static_cast<unsigned int>(i) * 7919u;
+        Sampler * const articulationSampler = Sampler::create(samplerType, 2, rand_r(&iterationSeed));
+        Sampler * const cameraSampler = Sampler::create(samplerType, 4, rand_r(&iterationSeed));
+        if (!articulationSampler || !cameraSampler) {
+            // same configuration in all workers, so all of them return here
+            delete articulationSampler;
+            delete cameraSampler;
+            return;
+        }
+        size_t numBatches = numArticulationConfigs;
+        if (hasDeadline() && batchTime > 0.) {
+            // As many batches as fit into this iteration's share of the remaining time, at least one
+            const double candidateTime = getSliceEnd(numIterations - i) - tailTime - iterationStart;
+            numBatches = std::min(static_cast<size_t>(std::max(candidateTime, 0.) / batchTime), numArticulationConfigs);
+            numBatches = std::max(numBatches, static_cast<size_t>(1));
+        }
         bellmanFordRenderer->setRobotPosition(taskSharedData->currentConfiguration.getCameraLocalTransform());
-        std::vector<RobotSceneConfiguration *> configurations;
-        configurations.reserve(numArticulationConfigs * numCameraPoses);
-        for (size_t a = 0; a < numArticulationConfigs; ++a) {
-            RobotSceneConfiguration rsc;
-            rsc.setRandomArticulation(seed);
+        RobotSceneConfiguration * bestConfiguration = NULL;
+        float bestEval = -std::numeric_limits<float>::max();
+        size_t numEvaluated = 0;
+        const float maxGain = RobotSceneConfiguration::gainFactor
+                * (maxCount - static_cast<float>(taskSharedData->currentConfiguration.getCount()));
+        articulationSampler->generate(numBatches, articulationSamples);
+        for (size_t a = 0; a < numBatches; ++a) {
+            RobotSceneConfiguration& rsc = *candidatePool.acquire();
+            rsc.setArticulationFromSample(&articulationSamples[a * articulationSampler->getDimensions()]);
             rsc.applyToScene(scene);
+            if (pruneCandidates) {
+                // the distance map starts at the robot camera, which has been moved by the previous batch
+                cameraNode->setLocalTransform(taskSharedData->currentConfiguration.getCameraLocalTransform());
+            }
             costmapRenderer->display();
             bellmanFordRenderer->display();
-
-            for (size_t i = 0; i < numCameraPoses; ++i) {
-                RobotSceneConfiguration *c = new RobotSceneConfiguration();
-                c->set(rsc);
-                c->setRandomCameraHeight(seed);
-                c->setRandomCameraPosition(seed, &targetPoints);
-                // c->count will be set later
-                configurations.push_back(c);
-                cameraNode->setLocalTransform(c->getCameraLocalTransform());
-                visibilityRenderer->display();
+            if (sampleFreeSpace || pruneCandidates) {
+                // CPU-side bitmap of the cells on which candidates may be placed
+                allowedCells.assign(costmapRenderer->getTextureWidth() * costmapRenderer->getTextureHeight(), 1);
+                if (sampleFreeSpace) {
+                    costmapRenderer->getCosts(costs);
+                    for (size_t cell = 0; cell < allowedCells.size(); ++cell) {
+                        allowedCells[cell] &= costs[cell] < CostMapRenderer::obstacleCost;
+                    }
+                }
+                if (pruneCandidates) {
+                    bellmanFordRenderer->getDistances(distances);
+                    for (size_t cell = 0; cell < allowedCells.size(); ++cell) {
+                        allowedCells[cell] &= distances[cell] < BellmanFordXfbRenderer::unreachableDistance;
+                    }
+                }
             }
-        }
 
-        std::vector<GLuint> visibilityResults;
-        visibilityRenderer->getPixelCounts(visibilityResults);
-        const size_t numResults = visibilityResults.size();
-        if (numResults != configurations.size()) {
-            logError("Visibility results count does not match configurations count");
-            return;
-        }
-
-        // scope for bestConfiguration
-        {
-            RobotSceneConfiguration * bestConfiguration = NULL;
-            float bestEval = -std::numeric_limits<float>::max();
-            for (size_t nc = 0; nc < numResults; ++nc) {
-                configurations[nc]->setCount(visibilityResults[nc]);
-                const float eval = configurations[nc]->getEvaluation(taskSharedData->currentConfiguration);
-                if (eval > bestEval) {
-                    bestEval = eval;
-                    bestConfiguration = configurations[nc];
+            // Camera poses are drawn in bulk, rejected poses are replaced by a bounded number of further samples
+            size_t numAccepted = 0;
+            RobotSceneConfiguration *c = NULL;
+            for (size_t round = 0; numAccepted < numCameraPoses && round < maxSampleRounds; ++round) {
+                cameraSampler->generate(numCameraPoses - numAccepted, cameraSamples);
+                for (size_t s = 0; s < cameraSamples.size(); s += cameraSampler->getDimensions()) {
+                    if (!c) {
+                        c = candidatePool.acquire();
+                    }
+                    c->set(rsc);
+                    c->setCameraHeightFromSample(cameraSamples[s]);
+                    c->setCameraPositionFromSample(&cameraSamples[s + 1], &targetPoints);
+                    if (!allowedCells.empty() && !isAllowed(allowedCells, *c)) {
+                        ++numRejected;
+                        continue;
+                    }
+                    if (pruneCandidates && maxGain - c->getCost(taskSharedData->currentConfiguration) <= bestEval) {
+                        // cannot beat the best candidate even if it observed all remaining pixels
+                        ++numPruned;
+                        continue;
+                    }
+                    GLuint cachedCount;
+                    if (poseCache && poseCache->lookup(PoseCache::getKey(*c, coverageState), cachedCount)) {
+                        // evaluated without rendering after the rendered candidates
+                        c->setCount(cachedCount);
+                        cachedConfigurations.push_back(c);
+                        c = NULL;
+                        ++numAccepted;
+                        continue;
+                    }
+                    // c->count will be set later
+                    configurations.push_back(c);
+                    cameraNode->setLocalTransform(c->getCameraLocalTransform());
+                    visibilityRenderer->display();
+                    c = NULL;
+                    ++numAccepted;
                 }
             }
 
-            // Publish best result
-            pthread_mutex_lock(&sharedData->mutex);
-            if (bestEval > taskSharedData->bestEval) {
-                taskSharedData->bestConfiguration.set(*bestConfiguration);
-                taskSharedData->bestEval = bestEval;
+            if (pipelined) {
+                // Evaluate the candidates of previous batches whose counts have left the PBO ring
+                // while the GPU is still busy with the current batch
+                visibilityRenderer->takePixelCounts(visibilityResults);
+                evaluateCandidates(configurations, visibilityResults, numEvaluated, bestConfiguration, bestEval);
             }
-            pthread_mutex_unlock(&sharedData->mutex);
         }
 
-        // Delete all configurations
-        for (std::vector<RobotSceneConfiguration *>::iterator it = configurations.begin(); it != configurations.end();
-                ++it) {
-            delete *it;
+        delete articulationSampler;
+        delete cameraSampler;
+
+        // Flush the pipeline for the candidates still in flight
+        visibilityRenderer->getPixelCounts(pendingResults);
+        visibilityResults.insert(visibilityResults.end(), pendingResults.begin(), pendingResults.end());
+        if (visibilityResults.size() != configurations.size()) {
+            logError("Visibility results count does not match configurations count");
+            break;
+        }
+        evaluateCandidates(configurations, visibilityResults, numEvaluated, bestConfiguration, bestEval);
+        for (size_t k = 0; k < cachedConfigurations.size(); ++k) {
+            const float eval = cachedConfigurations[k]->getEvaluation(taskSharedData->currentConfiguration);
+            if (eval > bestEval) {
+                bestEval = eval;
+                bestConfiguration = cachedConfigurations[k];
+            }
+        }
+        cachedConfigurations.clear();
+        const double candidatesEnd = getTime();
+        const double measuredBatchTime = (candidatesEnd - iterationStart) / numBatches;
+        batchTime = batchTime > 0. ? 0.75 * batchTime + 0.25 * measuredBatchTime : measuredBatchTime;
+
+        // Publish best result without taking the mutex
+        if (bestConfiguration) {
+            sharedBest->publish(threadNr, *bestConfiguration, bestEval, 0);
         }
+
+        // Release all configurations
         configurations.clear();
+        visibilityResults.clear();
+        candidatePool.releaseAll();
 
         // Wait for other threads
         pthread_barrier_wait(&sharedData->barrier);
 
         // Set best configuration of all threads to the new current configuration
         if (threadNr == 0) {
+            if (!sharedBest->getBest(taskSharedData->bestConfiguration, taskSharedData->bestEval)) {
+                taskSharedData->bestEval = -std::numeric_limits<float>::max();
+            }
             // Debug output
             static bool isFirst = true;
             if (isFirst) {
@@ -266,7 +410,14 @@ void RandomSearchTask::run() {
             if (taskSharedData->bestEval < 0.f) {
                 taskSharedData->finished = true;
             }
+            if (hasDeadline() && !taskSharedData->finished
+                    && getTime() + batchTime + tailTime > sharedData->deadline) {
+                // No time for another iteration, the views printed so far are the result
+                logInfo("Time budget used up after %zu iterations", i + 1);
+                taskSharedData->finished = true;
+            }
             taskSharedData->bestEval = -std::numeric_limits<float>::max();
+            sharedBest->reset();
         }
 
         // Wait for other threads
@@ -275,6 +426,7 @@ void RandomSearchTask::run() {
         if (taskSharedData->finished) {
             break;
         }
+        coverageState = PoseCache::getKey(taskSharedData->currentConfiguration, coverageState);
 
         // Re-render best visibility texture
         cameraNode->setLocalTransform(taskSharedData->currentConfiguration.getCameraLocalTransform());
@@ -325,26 +477,145 @@ void RandomSearchTask::run() {
             }
         }
 
+        if (checkpoint && threadNr == 0 && (i + 1) % checkpointInterval == 0) {
+            saveCheckpoint(i + 1, baseSeed);
+        }
+
         // Wait for other threads
         pthread_barrier_wait(&sharedData->barrier);
+        const double measuredTailTime = getTime() - candidatesEnd;
+        tailTime = tailTime > 0. ? 0.75 * tailTime + 0.25 * measuredTailTime : measuredTailTime;
     }
+
+    if (sampleFreeSpace || pruneCandidates) {
+        logInfo("[%zu] %zu camera poses rejected on obstacles or unreachable cells, %zu pruned by costs",
+                threadNr, numRejected, numPruned);
+    }
+}
+
+void RandomSearchTask::saveCheckpoint(const size_t nextIteration, const unsigned int baseSeed) {
+    checkpoint->begin();
+    checkpoint->put(static_cast<uint64_t>(nextIteration));
+    checkpoint->put(static_cast<uint32_t>(baseSeed));
+    checkpoint->put(coverageState);
+    checkpoint->putConfiguration(taskSharedData->currentConfiguration);
+    checkpoint->put(static_cast<uint32_t>(numTargetTextures));
+    for (size_t t = 0; t < numTargetTextures; ++t) {
+        checkpoint->putTexture(targetTexture[t], visibilityRenderer->getTextureWidth(),
+                visibilityRenderer->getTextureHeight());
+    }
+    checkpoint->commit();
+}
+
+bool RandomSearchTask::resume(size_t& nextIteration, unsigned int& baseSeed) {
+    uint64_t iteration;
+    uint32_t firstSeed, numTextures;
+    RobotSceneConfiguration current;
+    if (!checkpoint->get(iteration) || !checkpoint->get(firstSeed) || !checkpoint->get(coverageState)
+            || !checkpoint->getConfiguration(current) || !checkpoint->get(numTextures)) {
+        return false;
+    }
+    if (numTextures != numTargetTextures) {
+        logError("Checkpoint has %u target textures, the scene has %zu", numTextures, numTargetTextures);
+        return false;
+    }
+    for (size_t t = 0; t < numTargetTextures; ++t) {
+        if (!checkpoint->getTexture(targetTexture[t], visibilityRenderer->getTextureWidth(),
+                visibilityRenderer->getTextureHeight())) {
+            return false;
+        }
+    }
+    if (threadNr == 0) {
+        taskSharedData->currentConfiguration.set(current);
+    }
+    nextIteration = iteration;
+    // the checkpoint contains the seed of the first thread, the seeds of the other threads follow it
+    baseSeed = firstSeed + threadNr;
+    return true;
+}
+
+bool RandomSearchTask::isAllowed(const std::vector<unsigned char>& allowedCells,
+        const RobotSceneConfiguration& configuration) const {
+    size_t cell;
+    return getCell(configuration, cell) && cell < allowedCells.size() && allowedCells[cell];
 }
 
-void RandomSearchTask::allocateSharedData() {
+bool RandomSearchTask::getCell(const RobotSceneConfiguration& configuration, size_t& cell) const {
+    glm::vec4 position(glm::column(configuration.getCameraLocalTransform(), 3));
+    if (cameraNode->getParent()) {
+        position = cameraNode->getParent()->getWorldTransform() * position;
+    }
+    return costmapRenderer->getPixel(glm::vec3(position), cell);
+}
+
+void RandomSearchTask::evaluateCandidates(const std::vector<RobotSceneConfiguration *>& configurations,
+        const std::vector<GLuint>& visibilityResults, size_t& numEvaluated,
+        RobotSceneConfiguration *& bestConfiguration, float& bestEval) {
+    // Candidates are evaluated in rendering order, so the result does not depend on the batching
+    candidateBatch.clear();
+    for (size_t k = numEvaluated; k < visibilityResults.size(); ++k) {
+        RobotSceneConfiguration * const c = configurations[k];
+        c->setCount(visibilityResults[k]);
+        if (poseCache) {
+            poseCache->insert(PoseCache::getKey(*c, coverageState), c->getCount());
+        }
+        candidateBatch.add(*c);
+    }
+    candidateBatch.evaluate(taskSharedData->currentConfiguration);
+    const size_t best = candidateBatch.getBest();
+    if (best < candidateBatch.size() && candidateBatch.getEvaluation(best) > bestEval) {
+        bestEval = candidateBatch.getEvaluation(best);
+        bestConfiguration = configurations[numEvaluated + best];
+    }
+    numEvaluated = visibilityResults.size();
+}
+
+size_t RandomSearchTask::sharedBestOffset() {
+    // SharedBest contains 64 bit words, align it to 8 bytes
+    const size_t offset = sizeof(TaskSharedData) + 2 * RobotSceneConfiguration::numArticulation * sizeof(float);
+    return (offset + 7) & ~static_cast<size_t>(7);
+}
+
+void RandomSearchTask::allocateSharedData(const size_t numThreads) {
     if (!taskSharedData) {
-        taskSharedData = (TaskSharedData *) mmap(NULL,
-                sizeof(TaskSharedData) + 2 * RobotSceneConfiguration::numArticulation * sizeof(float),
+        const size_t poseCacheSize = std::max(Config::getInstance().getParam<int>("poseCacheSize"), 0);
+        sharedDataSize = poseCacheOffset(numThreads) + (poseCacheSize > 0 ? PoseCache::getSize(poseCacheSize) : 0);
+        taskSharedData = (TaskSharedData *) mmap(NULL, sharedDataSize,
                 PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
         taskSharedData->bestConfiguration.articulation = reinterpret_cast<float*>(taskSharedData + 1);
         taskSharedData->currentConfiguration.articulation = taskSharedData->bestConfiguration.articulation
                 + RobotSceneConfiguration::numArticulation;
+        sharedBest = SharedBest::create(reinterpret_cast<char*>(taskSharedData) + sharedBestOffset(), numThreads);
+        if (poseCacheSize > 0) {
+            poseCache = PoseCache::create(reinterpret_cast<char*>(taskSharedData) + poseCacheOffset(numThreads),
+                    poseCacheSize);
+            if (Config::getInstance().getParam<bool>("poseCachePersistent")) {
+                const std::string filename = Config::getInstance().getParam<std::string>("poseCacheFile");
+                logInfo("Loaded %zu cached pose evaluations from %s", poseCache->load(filename), filename.c_str());
+            }
+        }
     }
 }
 
+size_t RandomSearchTask::poseCacheOffset(const size_t numThreads) {
+    // PoseCache contains 64 bit words as well
+    const size_t offset = sharedBestOffset() + SharedBest::getSize(numThreads);
+    return (offset + 7) & ~static_cast<size_t>(7);
+}
+
 void RandomSearchTask::freeSharedData() {
+    if (poseCache) {
+        logInfo("Pose cache: %lu hits, %lu misses", static_cast<unsigned long>(poseCache->getHits()),
+                static_cast<unsigned long>(poseCache->getMisses()));
+        if (Config::getInstance().getParam<bool>("poseCachePersistent")) {
+            poseCache->save(Config::getInstance().getParam<std::string>("poseCacheFile"));
+        }
+        poseCache = NULL;
+    }
     if (taskSharedData) {
-        munmap(taskSharedData, sizeof(TaskSharedData) + 2 * RobotSceneConfiguration::numArticulation * sizeof(float));
+        munmap(taskSharedData, sharedDataSize);
         taskSharedData = NULL;
+        sharedBest = NULL;
     }
 }
 
@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#include <gpu_coverage/ReverseVisibilityRenderer.h>
+#include <gpu_coverage/Utilities.h>
+#include <gpu_coverage/Config.h>
+#ifndef GLM_FORCE_RADIANS
+#define GLM_FORCE_RADIANS
+#endif
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <sstream>
+
+namespace gpu_coverage {
+
+const float ReverseVisibilityRenderer::clipNear = 0.01f;
+const float ReverseVisibilityRenderer::clipFar = 100.f;
+const float ReverseVisibilityRenderer::maxFov = glm::radians(160.f);
+
+ReverseVisibilityRenderer::ReverseVisibilityRenderer(const Scene * const scene, const int width, const int height,
+        const int textureWidth, const int textureHeight)
+        : AbstractRenderer(scene, "ReverseVisibilityRenderer"), width(width), height(height),
+          patchResolution(std::max(Config::getInstance().getParam<int>("reversePatchResolution"), 1)),
+          depthResolution(std::max(Config::getInstance().getParam<int>("reverseDepthResolution"), 1)),
+          texelsPerPatch(static_cast<float>(textureWidth) * static_cast<float>(textureHeight)
+                  / static_cast<float>(patchResolution * patchResolution)),
+          gridOrigin(0.f), cellSize(1.f), useFrustum(false), numPatches(0) {
+    if (!progPatches.isReady() || !progDepth.isReady() || !progGather.isReady()) {
+        return;
+    }
+
+    std::stringstream targetNames(Config::getInstance().getParam<std::string>("target"));
+    while (targetNames.good()) {
+        std::string targetName;
+        targetNames >> targetName;
+        if (!targetName.empty()) {
+            Node * const target = scene->findNode(targetName);
+            if (!target) {
+                logError("Could not find target node %s", targetName.c_str());
+                return;
+            }
+            targets.push_back(target);
+        }
+    }
+
+    glGenTextures(4, textures);
+    for (size_t i = 0; i < 4; ++i) {
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        switch (i) {
+        case PATCH_POSITION:
+        case PATCH_NORMAL:
+            glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, patchResolution, patchResolution);
+            break;
+        case DEPTH:
+            glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, depthResolution, depthResolution);
+            break;
+        case GAIN:
+            glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32F, width, height);
+            break;
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    checkGLError();
+
+    glGenFramebuffers(3, framebuffers);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[PATCH_FRAMEBUFFER]);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[PATCH_POSITION], 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, textures[PATCH_NORMAL], 0);
+    const GLenum patchBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, patchBuffers);
+    if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        logError("Could not create framebuffer and textures for the patch atlas");
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[DEPTH_FRAMEBUFFER]);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[DEPTH], 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        logError("Could not create framebuffer and textures for the patch depth maps");
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[GAIN_FRAMEBUFFER]);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[GAIN], 0);
+    GLenum drawBuffer = GL_COLOR_ATTACHMENT0;
+    glDrawBuffers(1, &drawBuffer);
+    if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        logError("Could not create framebuffer and textures for the reverse visibility gain");
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    checkGLError();
+
+    progGather.use();
+    glUniform1i(progGather.locations.depthUnit, 12);
+    glUniform1f(progGather.locations.clipNear, clipNear);
+    glUniform1f(progGather.locations.clipFar, clipFar);
+    glUniform1f(progGather.locations.bias, 0.02f);
+    glUniform1f(progGather.locations.weight, texelsPerPatch);
+    checkGLError();
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    GLfloat vertices[12] = {
+            -1.f, -1.f, 0.f,
+            1.f, -1.f, 0.f,
+            1.f, 1.f, 0.f,
+            -1.f, 1.f, 0.f
+    };
+    glBufferData(GL_ARRAY_BUFFER, 12 * sizeof(GLfloat), vertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    checkGLError();
+
+    ready = true;
+}
+
+ReverseVisibilityRenderer::~ReverseVisibilityRenderer() {
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteTextures(4, textures);
+    glDeleteFramebuffers(3, framebuffers);
+    checkGLError();
+}
+
+void ReverseVisibilityRenderer::setGrid(const glm::vec3& origin, const glm::vec2& cellSize) {
+    gridOrigin = origin;
+    this->cellSize = cellSize;
+}
+
+void ReverseVisibilityRenderer::setLookAt(const glm::vec3& lookAt, const glm::mat4& projection) {
+    useFrustum = true;
+    this->lookAt = lookAt;
+    cameraProjection = projection;
+}
+
+void ReverseVisibilityRenderer::display() {
+    if (!ready) {
+        return;
+    }
+    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 1, -1, "reverse visibility");
+    GLint oldViewport[4];
+    glGetIntegerv(GL_VIEWPORT, oldViewport);
+    const GLboolean oldDepthTest = glIsEnabled(GL_DEPTH_TEST);
+    const GLboolean oldBlend = glIsEnabled(GL_BLEND);
+
+    // Compute animation
+    scene->getRoot()->setFrame();
+
+    // Unwrap the targets into the patch atlas and read the patches back
+    std::vector<glm::vec4> positions, normals;
+    std::vector<glm::vec4> atlasPositions(patchResolution * patchResolution);
+    std::vector<glm::vec4> atlasNormals(patchResolution * patchResolution);
+    const std::vector<glm::mat4> identity(1, glm::mat4(1.f));
+    progPatches.use();
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[PATCH_FRAMEBUFFER]);
+    glViewport(0, 0, patchResolution, patchResolution);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    for (size_t t = 0; t < targets.size(); ++t) {
+        glClearColor(0.f, 0.f, 0.f, 0.f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        targets[t]->render(identity, &progPatches.locationsMVP, NULL, false);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glReadPixels(0, 0, patchResolution, patchResolution, GL_RGBA, GL_FLOAT, &atlasPositions[0]);
+        glReadBuffer(GL_COLOR_ATTACHMENT1);
+        glReadPixels(0, 0, patchResolution, patchResolution, GL_RGBA, GL_FLOAT, &atlasNormals[0]);
+        for (size_t i = 0; i < atlasPositions.size(); ++i) {
+            if (atlasPositions[i].w > 0.5f) {
+                positions.push_back(atlasPositions[i]);
+                normals.push_back(atlasNormals[i]);
+            }
+        }
+    }
+    numPatches = positions.size();
+    checkGLError();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[GAIN_FRAMEBUFFER]);
+    glClearColor(0.f, 0.f, 0.f, 0.f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    progGather.use();
+    glUniform3fv(progGather.locations.gridOrigin, 1, glm::value_ptr(gridOrigin));
+    glUniform2f(progGather.locations.cellSize, cellSize.x, cellSize.y);
+    glUniform1i(progGather.locations.useFrustum, useFrustum ? 1 : 0);
+    glUniform3fv(progGather.locations.lookAt, 1, glm::value_ptr(lookAt));
+    glUniformMatrix4fv(progGather.locations.cameraProjection, 1, GL_FALSE, glm::value_ptr(cameraProjection));
+    glActiveTexture(GL_TEXTURE12);
+    glBindTexture(GL_TEXTURE_2D, textures[DEPTH]);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glBindVertexArray(vao);
+
+    const glm::vec3 gridEnd = gridOrigin
+            + glm::vec3(static_cast<float>(width - 1) * cellSize.x, static_cast<float>(height - 1) * cellSize.y, 0.f);
+    const glm::vec3 corners[4] = {
+        gridOrigin, glm::vec3(gridEnd.x, gridOrigin.y, gridOrigin.z),
+        glm::vec3(gridOrigin.x, gridEnd.y, gridOrigin.z), gridEnd
+    };
+    const glm::vec3 center = 0.5f * (gridOrigin + gridEnd);
+    std::vector<glm::mat4> view(1);
+    for (size_t p = 0; p < numPatches; ++p) {
+        const glm::vec3 normal(normals[p]);
+        // Move the camera off the surface to avoid self-occlusion
+        const glm::vec3 eye = glm::vec3(positions[p]) + 0.01f * normal;
+
+        // Look at the grid with a field of view containing all of it, as far as possible
+        bool facing = false;
+        const glm::vec3 direction = glm::normalize(center - eye);
+        float maxAngle = 0.f;
+        for (size_t c = 0; c < 4; ++c) {
+            facing |= glm::dot(normal, corners[c] - eye) > 0.f;
+            const float cosAngle = glm::dot(direction, glm::normalize(corners[c] - eye));
+            maxAngle = std::max(maxAngle, acosf(std::max(std::min(cosAngle, 1.f), -1.f)));
+        }
+        if (!facing) {
+            // The grid is behind the patch
+            continue;
+        }
+        const float fov = std::min(2.f * maxAngle + glm::radians(2.f), maxFov);
+        const glm::vec3 up = fabsf(direction.z) < 0.99f ? glm::vec3(0.f, 0.f, 1.f) : glm::vec3(0.f, 1.f, 0.f);
+        view[0] = glm::lookAt(eye, center, up);
+        const glm::mat4 projection = glm::perspective(fov, 1.f, clipNear, clipFar);
+
+        // Depth map as seen from the patch
+        progDepth.use();
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[DEPTH_FRAMEBUFFER]);
+        glViewport(0, 0, depthResolution, depthResolution);
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        glUniformMatrix4fv(progDepth.locationsMVP.viewMatrix[0], 1, GL_FALSE, glm::value_ptr(view[0]));
+        glUniformMatrix4fv(progDepth.locationsMVP.projectionMatrix, 1, GL_FALSE, glm::value_ptr(projection));
+        if (scene->getRoot()->isVisible()) {
+            scene->getRoot()->render(view, &progDepth.locationsMVP, NULL, false);
+        }
+
+        // Add the patch texels to all cells seeing the patch
+        progGather.use();
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[GAIN_FRAMEBUFFER]);
+        glViewport(0, 0, width, height);
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glUniformMatrix4fv(progGather.locations.patchViewProjection, 1, GL_FALSE,
+                glm::value_ptr(projection * view[0]));
+        glUniform3fv(progGather.locations.patchPosition, 1, glm::value_ptr(eye));
+        glUniform3fv(progGather.locations.patchNormal, 1, glm::value_ptr(normal));
+        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    }
+    checkGLError();
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(oldViewport[0], oldViewport[1], oldViewport[2], oldViewport[3]);
+    if (oldDepthTest) {
+        glEnable(GL_DEPTH_TEST);
+    } else {
+        glDisable(GL_DEPTH_TEST);
+    }
+    if (oldBlend) {
+        glEnable(GL_BLEND);
+    } else {
+        glDisable(GL_BLEND);
+    }
+    checkGLError();
+    glPopDebugGroup();
+}
+
+void ReverseVisibilityRenderer::getGains(std::vector<GLuint>& gains) const {
+    std::vector<GLfloat> values(width * height);
+    glBindTexture(GL_TEXTURE_2D, textures[GAIN]);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, &values[0]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    checkGLError();
+    gains.resize(width * height);
+    for (size_t i = 0; i < values.size(); ++i) {
+        gains[i] = static_cast<GLuint>(values[i] + 0.5f);
+    }
+}
+
+} /* namespace gpu_coverage */
@@ -38,6 +38,7 @@
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/matrix_access.hpp>
+#include <algorithm>
 
 namespace gpu_coverage {
 
@@ -50,27 +51,43 @@ size_t RobotSceneConfiguration::numArticulation = 0;
 RobotSceneConfiguration::ArticulationCost *RobotSceneConfiguration::costArticulation = NULL;
 
 RobotSceneConfiguration::RobotSceneConfiguration()
-        : count(0) {
+        : count(0), ownsArticulation(true) {
     articulation = (float *) calloc(numArticulation, sizeof(float));
     for (size_t a = 0; a < numArticulation; ++a) {
         articulation[a] = 0.f;
     }
 }
 
-RobotSceneConfiguration::RobotSceneConfiguration(const RobotSceneConfiguration& other) {
+RobotSceneConfiguration::RobotSceneConfiguration(const RobotSceneConfiguration& other)
+        : ownsArticulation(true) {
     articulation = (float *) calloc(numArticulation, sizeof(float));
     set(other);
 }
 
+RobotSceneConfiguration::RobotSceneConfiguration(float * const articulationStorage)
+        : articulation(articulationStorage), count(0), ownsArticulation(false) {
+    for (size_t a = 0; a < numArticulation; ++a) {
+        articulation[a] = 0.f;
+    }
+}
+
 RobotSceneConfiguration::~RobotSceneConfiguration() {
+    if (ownsArticulation) {
+        free(articulation);
+        articulation = NULL;
+    }
 }
 
 float RobotSceneConfiguration::getCost(RobotSceneConfiguration& previousConfig) const {
-    float costs = 0.f;
-    // distance
     const float distance = hypot(cameraPosition.x - previousConfig.cameraPosition.x,
             cameraPosition.y - previousConfig.cameraPosition.y);
-    costs += costDistance * distance;
+    return getCost(previousConfig, distance);
+}
+
+float RobotSceneConfiguration::getCost(RobotSceneConfiguration& previousConfig, const float pathLength) const {
+    float costs = 0.f;
+    // distance
+    costs += costDistance * pathLength;
     // articulation
     for (size_t a = 0; a < numArticulation; ++a) {
         const float delta = fabs(articulation[a] - previousConfig.articulation[a]);
@@ -90,27 +107,47 @@ float RobotSceneConfiguration::getGain(RobotSceneConfiguration& previousConfig)
 }
 
 void RobotSceneConfiguration::setRandomArticulation(unsigned int& seed) {
-    size_t which = rand_r(&seed) * numArticulation / RAND_MAX;
+    float sample[2];
+    sample[0] = static_cast<float>(rand_r(&seed)) / RAND_MAX;
+    sample[1] = static_cast<float>(rand_r(&seed)) / RAND_MAX;
+    setArticulationFromSample(sample);
+}
+
+void RobotSceneConfiguration::setArticulationFromSample(const float * const sample) {
+    const size_t which = std::min(static_cast<size_t>(sample[0] * numArticulation), numArticulation - 1);
     for (size_t a = 0; a < numArticulation; ++a) {
-        setArticulation(a, a == which ? static_cast<float>(rand_r(&seed)) / RAND_MAX : 0);
+        setArticulation(a, a == which ? sample[1] : 0);
     }
 }
 
 void RobotSceneConfiguration::setRandomCameraHeight(unsigned int& seed) {
+    setCameraHeightFromSample(static_cast<float>(rand_r(&seed)) / RAND_MAX);
+}
+
+void RobotSceneConfiguration::setCameraHeightFromSample(const float sample) {
     if (maxCameraHeight - minCameraHeight > 1e-4) {
-        setCameraHeight(
-                minCameraHeight + static_cast<float>(rand_r(&seed)) / RAND_MAX * (maxCameraHeight - minCameraHeight));
+        setCameraHeight(minCameraHeight + sample * (maxCameraHeight - minCameraHeight));
     } else {
         setCameraHeight(minCameraHeight);
     }
 }
 
 void RobotSceneConfiguration::setRandomCameraPosition(unsigned int& seed, const std::vector<glm::vec3> * const targetPoints) {
-    const float x = (static_cast<float>(rand_r(&seed)) / RAND_MAX - 0.5f) * 10.8f; // TODO get sampling range from projection plane
-    const float y = (static_cast<float>(rand_r(&seed)) / RAND_MAX - 0.5f) * 10.8f;
+    float sample[3];
+    for (size_t i = 0; i < 3; ++i) {
+        sample[i] = static_cast<float>(rand_r(&seed)) / RAND_MAX;
+    }
+    setCameraPositionFromSample(sample, targetPoints);
+}
+
+void RobotSceneConfiguration::setCameraPositionFromSample(const float * const sample,
+        const std::vector<glm::vec3> * const targetPoints) {
+    const float x = (sample[0] - 0.5f) * 10.8f; // TODO get sampling range from projection plane
+    const float y = (sample[1] - 0.5f) * 10.8f;
     static const glm::vec3 worldUp(0.f, 0.f, -1.f);
     const glm::vec3 eye(x, y, cameraPosition.z);
-    const glm::vec3 look(glm::normalize(eye - targetPoints->at(rand_r(&seed) * targetPoints->size() / RAND_MAX)));
+    const size_t target = std::min(static_cast<size_t>(sample[2] * targetPoints->size()), targetPoints->size() - 1);
+    const glm::vec3 look(glm::normalize(eye - targetPoints->at(target)));
     const glm::vec3 right(glm::cross(look, worldUp));
     const glm::vec3 up(glm::cross(look, right));
     setCameraLocalTransform(glm::inverse(glm::lookAt(eye, glm::vec3(0., 0., 0.), up)));
@@ -129,14 +166,15 @@ void RobotSceneConfiguration::setCameraLocalTransform(const glm::mat4x4& transfo
 void RobotSceneConfiguration::applyToScene(Scene * const scene) const {
     const Scene::Channels& channels = scene->getChannels();
     for (size_t i = 0; i < channels.size(); ++i) {
-        channels[i]->setFrame(channels[i]->getStartFrame() + articulation[i] * channels[i]->getNumFrames());
+        channels[i]->setFramePosition(channels[i]->getStartFrame() + articulation[i] * channels[i]->getNumFrames());
     }
 }
 
-void RobotSceneConfiguration::loadCosts() {
+void RobotSceneConfiguration::loadCosts(const size_t numArticulation) {
     costCameraHeightChange = Config::getInstance().getParam<float>("costCameraHeightChange");
     costDistance = Config::getInstance().getParam<float>("costDistance");
-    numArticulation = 20;
+    RobotSceneConfiguration::numArticulation = numArticulation;
+    free(costArticulation);
     costArticulation = (ArticulationCost *) calloc(numArticulation, sizeof(ArticulationCost));
     for (size_t i = 0; i < numArticulation; ++i) {
         costArticulation[i] = ArticulationCost(0.5f, 1.0f); // todo: move to config file
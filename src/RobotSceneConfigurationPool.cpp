@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#include <gpu_coverage/RobotSceneConfigurationPool.h>
+#include <gpu_coverage/Utilities.h>
+
+namespace gpu_coverage {
+
+RobotSceneConfigurationPool::RobotSceneConfigurationPool(const size_t capacity)
+        : articulations(capacity * RobotSceneConfiguration::numArticulation), used(0) {
+    slots.reserve(capacity);
+    for (size_t i = 0; i < capacity; ++i) {
+        // Do not take the address of element 0 of an empty vector if there are no articulated objects
+        float * const storage = articulations.empty() ? NULL
+                : &articulations[i * RobotSceneConfiguration::numArticulation];
+        slots.push_back(new RobotSceneConfiguration(storage));
+    }
+}
+
+RobotSceneConfigurationPool::~RobotSceneConfigurationPool() {
+    for (std::vector<RobotSceneConfiguration *>::iterator it = slots.begin(); it != slots.end(); ++it) {
+        delete *it;
+    }
+    slots.clear();
+}
+
+RobotSceneConfiguration * RobotSceneConfigurationPool::acquire() {
+    if (used >= slots.size()) {
+        logError("RobotSceneConfigurationPool exhausted, capacity is %zu", slots.size());
+        return NULL;
+    }
+    RobotSceneConfiguration * const slot = slots[used];
+    ++used;
+    for (size_t a = 0; a < RobotSceneConfiguration::numArticulation; ++a) {
+        slot->setArticulation(a, 0.f);
+    }
+    slot->setCount(0);
+    return slot;
+}
+
+} /* namespace gpu_coverage */
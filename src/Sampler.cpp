@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#include <gpu_coverage/Sampler.h>
+#include <gpu_coverage/Utilities.h>
+#include <stdlib.h>
+#include <algorithm>
+
+namespace gpu_coverage {
+
+namespace {
+
+/// Largest float below 1.0, returned instead of values that round up to 1.0
+const float MAX_SAMPLE = 0.99999994f;
+
+/// Returns a uniform random number in [0,1).
+inline double uniform(unsigned int& seed) {
+    return static_cast<double>(rand_r(&seed)) / (static_cast<double>(RAND_MAX) + 1.);
+}
+
+/// Returns 32 random bits.
+inline uint32_t randomBits(unsigned int& seed) {
+    return (static_cast<uint32_t>(rand_r(&seed)) << 16) ^ static_cast<uint32_t>(rand_r(&seed));
+}
+
+/**
+ * Direction numbers of Joe and Kuo (new-joe-kuo-6.21201) for dimensions 2 to 16:
+ * degree s of the primitive polynomial, its coefficients a, and the initial values m_1 ... m_s.
+ */
+struct SobolPolynomial {
+    unsigned int s;
+    unsigned int a;
+    uint32_t m[6];
+};
+
+const SobolPolynomial sobolPolynomials[SobolSampler::maxDimensions - 1] = {
+    { 1,  0, { 1 } },
+    { 2,  1, { 1, 3 } },
+    { 3,  1, { 1, 3, 1 } },
+    { 3,  2, { 1, 1, 1 } },
+    { 4,  1, { 1, 1, 3, 3 } },
+    { 4,  4, { 1, 3, 5, 13 } },
+    { 5,  2, { 1, 1, 5, 5, 17 } },
+    { 5,  4, { 1, 1, 5, 5, 5 } },
+    { 5,  7, { 1, 1, 7, 11, 19 } },
+    { 5, 11, { 1, 1, 5, 1, 1 } },
+    { 5, 13, { 1, 1, 1, 3, 11 } },
+    { 5, 14, { 1, 3, 5, 5, 31 } },
+    { 6,  1, { 1, 3, 3, 9, 7, 49 } },
+    { 6, 13, { 1, 1, 1, 15, 21, 21 } },
+    { 6, 16, { 1, 3, 1, 13, 27, 49 } }
+};
+
+/// First prime numbers, bases of the Halton sequence
+const uint32_t primes[] = {
+    2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+    59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131
+};
+const size_t numPrimes = sizeof(primes) / sizeof(primes[0]);
+
+} /* anonymous namespace */
+
+Sampler::Sampler(const size_t dimensions)
+        : dimensions(dimensions) {
+}
+
+Sampler::~Sampler() {
+}
+
+Sampler * Sampler::create(const std::string& type, const size_t dimensions, unsigned int seed) {
+    if (type == "random") {
+        return new UniformSampler(dimensions, seed);
+    } else if (type == "halton") {
+        if (dimensions > numPrimes) {
+            logError("Halton sampler supports at most %zu dimensions, got %zu", numPrimes, dimensions);
+            return NULL;
+        }
+        return new HaltonSampler(dimensions, seed);
+    } else if (type == "sobol") {
+        if (dimensions > SobolSampler::maxDimensions) {
+            logError("Sobol sampler supports at most %zu dimensions, got %zu", SobolSampler::maxDimensions, dimensions);
+            return NULL;
+        }
+        return new SobolSampler(dimensions, seed);
+    } else if (type == "lhs") {
+        return new LatinHypercubeSampler(dimensions, seed);
+    }
+    logError("Unknown sampler \"%s\", expected random, halton, sobol or lhs", type.c_str());
+    return NULL;
+}
+
+UniformSampler::UniformSampler(const size_t dimensions, const unsigned int seed)
+        : Sampler(dimensions), seed(seed) {
+}
+
+void UniformSampler::generate(const size_t numSamples, std::vector<float>& samples) {
+    samples.resize(numSamples * dimensions);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] = static_cast<float>(uniform(seed));
+    }
+}
+
+HaltonSampler::HaltonSampler(const size_t dimensions, unsigned int seed)
+        : Sampler(dimensions), index(0), bases(primes, primes + std::min(dimensions, numPrimes)),
+          shift(dimensions) {
+    for (size_t d = 0; d < dimensions; ++d) {
+        shift[d] = static_cast<float>(uniform(seed));
+    }
+}
+
+void HaltonSampler::generate(const size_t numSamples, std::vector<float>& samples) {
+    samples.resize(numSamples * dimensions);
+    float *sample = samples.empty() ? NULL : &samples[0];
+    for (size_t i = 0; i < numSamples; ++i, ++index, sample += dimensions) {
+        for (size_t d = 0; d < dimensions; ++d) {
+            // radical inverse of the index in base b
+            const uint32_t b = bases[d];
+            const double invBase = 1. / b;
+            double factor = invBase;
+            double value = shift[d];
+            for (uint32_t n = index; n > 0; n /= b, factor *= invBase) {
+                value += (n % b) * factor;
+            }
+            value -= static_cast<int>(value);
+            sample[d] = std::min(static_cast<float>(value), MAX_SAMPLE);
+        }
+    }
+}
+
+SobolSampler::SobolSampler(const size_t dimensions, unsigned int seed)
+        : Sampler(dimensions), index(0), directions(dimensions * numBits), state(dimensions) {
+    for (size_t d = 0; d < dimensions; ++d) {
+        uint32_t * const v = &directions[d * numBits];
+        if (d == 0) {
+            for (size_t k = 0; k < numBits; ++k) {
+                v[k] = 1u << (numBits - 1 - k);
+            }
+        } else {
+            const SobolPolynomial& p = sobolPolynomials[std::min(d, maxDimensions - 1) - 1];
+            for (size_t k = 0; k < numBits; ++k) {
+                if (k < p.s) {
+                    v[k] = p.m[k] << (numBits - 1 - k);
+                } else {
+                    v[k] = v[k - p.s] ^ (v[k - p.s] >> p.s);
+                    for (size_t j = 1; j < p.s; ++j) {
+                        if ((p.a >> (p.s - 1 - j)) & 1u) {
+                            v[k] ^= v[k - j];
+                        }
+                    }
+                }
+            }
+        }
+        // the first point of the sequence is 0, shifted by the random digital shift
+        state[d] = randomBits(seed);
+    }
+}
+
+void SobolSampler::generate(const size_t numSamples, std::vector<float>& samples) {
+    samples.resize(numSamples * dimensions);
+    float *sample = samples.empty() ? NULL : &samples[0];
+    uint32_t * const x = state.empty() ? NULL : &state[0];
+    for (size_t i = 0; i < numSamples; ++i, sample += dimensions) {
+        for (size_t d = 0; d < dimensions; ++d) {
+            // keep 24 bits so that the conversion to float cannot round up to 1.0
+            sample[d] = static_cast<float>(x[d] >> 8) * (1.f / 16777216.f);
+        }
+        // Gray code order: the next point differs in the direction of the lowest zero bit of the index
+        size_t c = 0;
+        for (uint32_t n = index; n & 1u; n >>= 1) {
+            ++c;
+        }
+        ++index;
+        if (c >= numBits) {
+            logWarn("Sobol sequence exhausted after %u samples, restarting", index);
+            c = numBits - 1;
+        }
+        const uint32_t * const v = &directions[c];
+        for (size_t d = 0; d < dimensions; ++d) {
+            x[d] ^= v[d * numBits];
+        }
+    }
+}
+
+LatinHypercubeSampler::LatinHypercubeSampler(const size_t dimensions, const unsigned int seed)
+        : Sampler(dimensions), seed(seed) {
+}
+
+void LatinHypercubeSampler::generate(const size_t numSamples, std::vector<float>& samples) {
+    samples.resize(numSamples * dimensions);
+    strata.resize(numSamples);
+    const double stratumSize = 1. / numSamples;
+    for (size_t d = 0; d < dimensions; ++d) {
+        for (size_t i = 0; i < numSamples; ++i) {
+            strata[i] = i;
+        }
+        // Fisher-Yates shuffle
+        for (size_t i = numSamples; i > 1; --i) {
+            std::swap(strata[i - 1], strata[static_cast<size_t>(uniform(seed) * i)]);
+        }
+        for (size_t i = 0; i < numSamples; ++i) {
+            const double value = (strata[i] + uniform(seed)) * stratumSize;
+            samples[i * dimensions + d] = std::min(static_cast<float>(value), MAX_SAMPLE);
+        }
+    }
+}
+
+} /* namespace gpu_coverage */
@@ -100,6 +100,14 @@ Scene::Scene(const aiScene * const aiScene, const std::string& dir)
     root->setFrame();
 }
 
+size_t Scene::countChannels(const aiScene * const aiScene) {
+    size_t numChannels = 0;
+    for (unsigned int i = 0; i < aiScene->mNumAnimations; ++i) {
+        numChannels += aiScene->mAnimations[i]->mNumChannels;
+    }
+    return numChannels;
+}
+
 Scene::~Scene() {
     for (unsigned int i = 0; i < meshes.size(); ++i) {
         delete meshes.at(i);
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#include <gpu_coverage/SharedBest.h>
+#include <gpu_coverage/Utilities.h>
+#include <string.h>
+#include <new>
+
+namespace gpu_coverage {
+
+size_t SharedBest::getSize(const size_t numWorkers) {
+    return sizeof(SharedBest) + numWorkers * (sizeof(Slot) + RobotSceneConfiguration::numArticulation * sizeof(float));
+}
+
+SharedBest * SharedBest::create(void * const memory, const size_t numWorkers) {
+    if (numWorkers > maxWorkers) {
+        logError("%zu workers cannot share the best candidate, at most %zu are supported", numWorkers, maxWorkers);
+        return NULL;
+    }
+    SharedBest * const sharedBest = static_cast<SharedBest *>(memory);
+    sharedBest->numWorkers = numWorkers;
+    Slot * const slots = sharedBest->getSlots();
+    float * articulation = reinterpret_cast<float *>(slots + numWorkers);
+    for (size_t w = 0; w < numWorkers; ++w, articulation += RobotSceneConfiguration::numArticulation) {
+        slots[w].sequence = 0;
+        slots[w].key = 0;
+        new (&slots[w].configuration) RobotSceneConfiguration(articulation);
+    }
+    sharedBest->reset();
+    return sharedBest;
+}
+
+uint64_t SharedBest::packKey(const float eval, const size_t index, const size_t worker) {
+    uint32_t bits;
+    memcpy(&bits, &eval, sizeof(bits));
+    // flip negative values completely and positive values in the sign bit to obtain an unsigned order
+    const uint32_t orderedEval = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    const uint32_t tieBreak = ~static_cast<uint32_t>(((index & 0xffffffu) << 8) | (worker & 0xffu));
+    return (static_cast<uint64_t>(orderedEval) << 32) | tieBreak;
+}
+
+float SharedBest::unpackEval(const uint64_t key) {
+    const uint32_t orderedEval = static_cast<uint32_t>(key >> 32);
+    const uint32_t bits = (orderedEval & 0x80000000u) ? (orderedEval & 0x7fffffffu) : ~orderedEval;
+    float eval;
+    memcpy(&eval, &bits, sizeof(eval));
+    return eval;
+}
+
+bool SharedBest::publish(const size_t worker, const RobotSceneConfiguration& configuration, const float eval,
+        const size_t index) {
+    if (worker >= numWorkers) {
+        logError("Worker %zu out of range, only %zu result slots", worker, numWorkers);
+        return false;
+    }
+    if (index >= maxIndex) {
+        logError("Candidate index %zu out of range, must be less than %zu", index, maxIndex);
+        return false;
+    }
+    const uint64_t key = packKey(eval, index, worker);
+    uint64_t current = best;
+    if (key <= current) {
+        return false;
+    }
+
+    // Only this worker writes its slot. Its previous candidate cannot be the best one any more,
+    // because the new key is larger than the current best key.
+    Slot& slot = getSlots()[worker];
+    __sync_fetch_and_add(&slot.sequence, 1);
+    slot.configuration.set(configuration);
+    slot.key = key;
+    __sync_fetch_and_add(&slot.sequence, 1);
+
+    while (key > current) {
+        const uint64_t previous = __sync_val_compare_and_swap(&best, current, key);
+        if (previous == current) {
+            return true;
+        }
+        current = previous;
+    }
+    return false;
+}
+
+bool SharedBest::getBest(RobotSceneConfiguration& configuration, float& eval) const {
+    for (;;) {
+        const uint64_t key = best;
+        if (key == 0) {
+            return false;
+        }
+        const Slot& slot = getSlots()[(~key) & 0xffu];
+        const uint32_t sequence = slot.sequence;
+        __sync_synchronize();
+        if (sequence & 1u) {
+            continue;
+        }
+        configuration.set(slot.configuration);
+        const uint64_t slotKey = slot.key;
+        __sync_synchronize();
+        if (slot.sequence == sequence && slotKey == key) {
+            eval = unpackEval(key);
+            return true;
+        }
+        // slot was rewritten by a better candidate of the same worker, try again
+    }
+}
+
+void SharedBest::reset() {
+    best = 0;
+    __sync_synchronize();
+}
+
+} /* namespace gpu_coverage */
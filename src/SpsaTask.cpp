@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2018, Stefan Osswald
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * 
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * 
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */ 
+
+#include <gpu_coverage/SpsaTask.h>
+#include <gpu_coverage/VisibilityRenderer.h>
+#include <gpu_coverage/Config.h>
+#include <gpu_coverage/Utilities.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace gpu_coverage {
+
+SpsaTask::SpsaTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData,
+        const size_t numIterations)
+        : CmaEsTask(scene, threadNr, sharedData, numIterations),
+          numStarts(std::max(Config::getInstance().getParam<int>("spsaStarts"), 1)),
+          numSteps(std::max(Config::getInstance().getParam<int>("spsaSteps"), 1)),
+          stepSize(Config::getInstance().getParam<float>("spsaStepSize")),
+          perturbation(Config::getInstance().getParam<float>("spsaPerturbation"))
+{
+}
+
+SpsaTask::~SpsaTask() {
+}
+
+void SpsaTask::clampVector(std::vector<double>& x) const {
+    for (size_t d = 0; d < x.size(); ++d) {
+        if (d == numArticulations + 3) {
+            // yaw is periodic, see decode()
+            x[d] -= floor(x[d]);
+        } else {
+            x[d] = std::min(1., std::max(0., x[d]));
+        }
+    }
+}
+
+size_t SpsaTask::search(RobotSceneConfiguration& bestConfiguration, float& bestEval) {
+    const size_t dimension = getDimension();
+    std::vector<std::vector<double> > thetas(numStarts, std::vector<double>(dimension));
+    std::vector<std::vector<double> > deltas(numStarts, std::vector<double>(dimension));
+    std::vector<std::vector<double> > perturbed(2 * numStarts, std::vector<double>(dimension));
+    std::vector<GLuint> visibilityResults;
+    RobotSceneConfiguration candidate;
+    size_t numRenders = 0;
+
+    for (size_t s = 0; s < numStarts; ++s) {
+        for (size_t d = 0; d < dimension; ++d) {
+            thetas[s][d] = uniform();
+        }
+    }
+
+    const double stability = 0.1 * numSteps;
+    for (size_t k = 0; k < numSteps; ++k) {
+        const double a = stepSize / pow(k + 1 + stability, 0.602);
+        const double c = perturbation / pow(k + 1, 0.101);
+
+        // Render theta + c delta and theta - c delta of all ascents as one batch, read back once
+        for (size_t s = 0; s < numStarts; ++s) {
+            for (size_t d = 0; d < dimension; ++d) {
+                deltas[s][d] = uniform() < 0.5 ? -1. : 1.;
+                perturbed[2 * s][d] = thetas[s][d] + c * deltas[s][d];
+                perturbed[2 * s + 1][d] = thetas[s][d] - c * deltas[s][d];
+            }
+            for (size_t p = 2 * s; p < 2 * s + 2; ++p) {
+                clampVector(perturbed[p]);
+                decode(perturbed[p], candidate);
+                candidate.applyToScene(scene);
+                cameraNode->setLocalTransform(candidate.getCameraLocalTransform());
+                visibilityRenderer->display();
+            }
+        }
+        visibilityRenderer->getPixelCounts(visibilityResults);
+        if (visibilityResults.size() != perturbed.size()) {
+            logError("Visibility results count does not match perturbations count");
+            taskSharedData->failed = true;
+            return 0;
+        }
+        numRenders += visibilityResults.size();
+
+        for (size_t s = 0; s < numStarts; ++s) {
+            float evals[2];
+            for (size_t p = 0; p < 2; ++p) {
+                decode(perturbed[2 * s + p], candidate);
+                candidate.setCount(visibilityResults[2 * s + p]);
+                evals[p] = candidate.getEvaluation(taskSharedData->currentConfiguration);
+                if (evals[p] > bestEval) {
+                    bestEval = evals[p];
+                    bestConfiguration.set(candidate);
+                }
+            }
+            // Sign-SPSA: all entries of the gradient estimate (evals[0] - evals[1]) / (2 c delta_d) have the
+            // same magnitude, so the ascent only uses their signs and moves every entry by a
+            if (evals[0] != evals[1]) {
+                const double direction = evals[0] > evals[1] ? 1. : -1.;
+                for (size_t d = 0; d < dimension; ++d) {
+                    thetas[s][d] += a * direction * deltas[s][d];
+                }
+                clampVector(thetas[s]);
+            }
+        }
+    }
+    return numRenders;
+}
+
+} /* namespace gpu_coverage */
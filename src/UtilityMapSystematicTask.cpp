@@ -33,12 +33,18 @@
 #include <gpu_coverage/UtilityMapSystematicTask.h>
 #include <gpu_coverage/CostMapRenderer.h>
 #include <gpu_coverage/VisibilityRenderer.h>
+#include <gpu_coverage/ReverseVisibilityRenderer.h>
 #include <gpu_coverage/Renderer.h>
 #include <gpu_coverage/Config.h>
+#include <gpu_coverage/Checkpoint.h>
 #include <gpu_coverage/Channel.h>
 #include <gpu_coverage/Utilities.h>
 
 #include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
 
 #ifndef GLM_FORCE_RADIANS
 #define GLM_FORCE_RADIANS true
@@ -49,13 +55,33 @@
 
 namespace gpu_coverage {
 
+namespace {
+
+/// Costs above which a cell is inside the inscribed radius of an obstacle
+const GLuint blockedCost = 5000000;
+
+inline GLint computeUtility(const GLuint gain, const GLuint cost) {
+    return cost > blockedCost ? -cost : (gain / 10 - cost);
+}
+
+} /* anonymous namespace */
+
 UtilityMapSystematicTask::UtilityMapSystematicTask(Scene * const scene, const size_t threadNr,
-        SharedData * const sharedData, const size_t& startFrame, const size_t& endFrame)
+        SharedData * const sharedData)
 : AbstractTask(sharedData, threadNr), scene(scene),
   costmapRenderer(NULL), bellmanFordRenderer(NULL), visibilityRenderer(NULL), renderer(NULL),
-  startFrame(startFrame), endFrame(endFrame),
-  outputVideo(NULL), debug(true)
+  reverseVisibilityRenderer(NULL),
+  outputVideo(NULL), debug(true),
+  adaptive(Config::getInstance().getParam<bool>("utilityMapAdaptive")),
+  baseStep(std::max(Config::getInstance().getParam<int>("utilityMapBaseStep"), 1)),
+  gainThreshold(Config::getInstance().getParam<int>("utilityMapGainThreshold")),
+  valueThreshold(Config::getInstance().getParam<int>("utilityMapValueThreshold")),
+  numErrorSamples(std::max(Config::getInstance().getParam<int>("utilityMapErrorSamples"), 0))
 {
+    if (Config::getInstance().getParam<int>("checkpointInterval") > 0) {
+        framesFile = Config::getInstance().getParam<std::string>("checkpointFile") + ".frames";
+    }
+
     // Get scene nodes
     Node * const projectionPlane = scene->findNode(Config::getInstance().getParam<std::string>("projectionPlane"));
     if (!projectionPlane) {
@@ -77,6 +103,18 @@ UtilityMapSystematicTask::UtilityMapSystematicTask(Scene * const scene, const si
     if (!visibilityRenderer->isReady()) {
         return;
     }
+    if (Config::getInstance().getParam<bool>("utilityMapReverse")) {
+        if (cameraNode->getCameras().empty()) {
+            logError("Robot camera node %s has no camera", cameraNode->getName().c_str());
+            return;
+        }
+        reverseVisibilityRenderer = new ReverseVisibilityRenderer(scene, bellmanFordRenderer->getTextureWidth(),
+                bellmanFordRenderer->getTextureHeight(), visibilityRenderer->getTextureWidth(),
+                visibilityRenderer->getTextureHeight());
+        if (!reverseVisibilityRenderer->isReady()) {
+            return;
+        }
+    }
     if (debug) {
         renderer = new Renderer(scene, false, true);
         if (!renderer->isReady()) {
@@ -86,6 +124,13 @@ UtilityMapSystematicTask::UtilityMapSystematicTask(Scene * const scene, const si
 
     char filename[256];
     snprintf(filename, sizeof(filename), "/tmp/output_%zu.avi", threadNr);
+    if (!framesFile.empty() && access(framesFile.c_str(), F_OK) == 0) {
+        // Resuming: the video of the interrupted run contains the finished frames, do not overwrite it
+        for (unsigned int run = 1; access(filename, F_OK) == 0; ++run) {
+            snprintf(filename, sizeof(filename), "/tmp/output_%zu.%u.avi", threadNr, run);
+        }
+        logInfo("Writing the frames of the resumed run to %s", filename);
+    }
     outputVideo = new cv::VideoWriter(filename, CV_FOURCC('D', 'I', 'V', 'X'), 30.,
             cv::Size(bellmanFordRenderer->getTextureWidth(), bellmanFordRenderer->getTextureHeight()), true);
     if (!outputVideo->isOpened()) {
@@ -110,6 +155,9 @@ UtilityMapSystematicTask::~UtilityMapSystematicTask()
     if (renderer) {
         delete renderer;
     }
+    if (reverseVisibilityRenderer) {
+        delete reverseVisibilityRenderer;
+    }
     if (outputVideo) {
         outputVideo->release();
     }
@@ -139,102 +187,310 @@ void UtilityMapSystematicTask::run() {
     const float dx = (maxX - minX) / width;
     const float dy = (maxY - minY) / width;
 
-    for (size_t frame = startFrame; frame < endFrame; ++frame) {
-        scene->getChannels()[0]->setFrame(frame);
-        costmapRenderer->display();
-        bellmanFordRenderer->display();
-
-        GLuint costmap[width * height] ;
-        glBindTexture(GL_TEXTURE_2D, bellmanFordRenderer->getTexture());
-        glGetTexImage(GL_TEXTURE_2D, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, costmap);
-
-        for (int y = 0; y < height; ++y) {
-            for (int x = 0; x < width; ++x) {
-                static const glm::vec3 worldUp(0.f, 0.f, -1.f);
-                const glm::vec3 eye(minX + x * dx, minY + y * dy, z);
-                const glm::vec3 look(glm::normalize(eye));
-                const glm::vec3 right(glm::cross(look, worldUp));
-                const glm::vec3 up(glm::cross(look, right));
-                cameraNode->setLocalTransform(glm::inverse(glm::lookAt(eye, glm::vec3(0., 0., 0.), up)));
-
-                visibilityRenderer->display();
-
-                //TODO remove debug code
-                /*if (debug) {
-                    {
-                        cv::Mat mat(visibilityRenderer->getTextureHeight(), visibilityRenderer->getTextureWidth(), CV_8UC3);
-                        cv::Mat flip(visibilityRenderer->getTextureHeight(), visibilityRenderer->getTextureWidth(), CV_8UC3);
-                        glBindTexture(GL_TEXTURE_2D, visibilityRenderer->getTexture());
-                        glGetTexImage(GL_TEXTURE_2D, 0, GL_BGR, GL_UNSIGNED_BYTE, mat.data);
-                        cv::flip(mat, flip, 0);
-                        char filename[256];
-                        snprintf(filename, sizeof(filename), "/tmp/utility/visibility-%d-%d.png", x, y);
-                        cv::imwrite(filename, flip);
-                    }
+    // Frames finished by an interrupted run are skipped
+    std::vector<bool> framesDone;
+    if (!framesFile.empty()) {
+        const size_t numDone = Checkpoint::loadFrames(framesFile, sharedData->endFrame, framesDone);
+        if (numDone > 0 && threadNr == 0) {
+            logInfo("Skipping %zu frames already done", numDone);
+        }
+    }
+
+    size_t chunkBegin, chunkEnd;
+    while (nextFrameChunk(chunkBegin, chunkEnd)) {
+        for (size_t frame = chunkBegin; frame < chunkEnd; ++frame) {
+            if (frame < framesDone.size() && framesDone[frame]) {
+                continue;
+            }
+            scene->getChannels()[0]->setFrame(frame);
+            costmapRenderer->display();
+            bellmanFordRenderer->display();
+
+            GLuint costmap[width * height] ;
+            glBindTexture(GL_TEXTURE_2D, bellmanFordRenderer->getTexture());
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, costmap);
+
+            const glm::vec3 origin(minX, minY, z);
+            const glm::vec2 cellSize(dx, dy);
+            std::vector<GLuint> visibility;
+            if (reverseVisibilityRenderer) {
+                // All cameras look at the origin, see renderCell()
+                reverseVisibilityRenderer->setGrid(origin, cellSize);
+                reverseVisibilityRenderer->setLookAt(glm::vec3(0.f, 0.f, 0.f),
+                        cameraNode->getCameras()[0]->getProjectionMatrix());
+                reverseVisibilityRenderer->display();
+                reverseVisibilityRenderer->getGains(visibility);
+                pthread_mutex_lock(&sharedData->mutex);
+                logInfo("[%zu] frame %zu: rendered %zu target patches", threadNr, frame,
+                        reverseVisibilityRenderer->getNumPatches());
+                pthread_mutex_unlock(&sharedData->mutex);
+            } else if (adaptive) {
+                if (!sampleAdaptive(frame, costmap, origin, cellSize, visibility)) {
+                    return;
+                }
+            } else {
+                for (int y = 0; y < height; ++y) {
+                    for (int x = 0; x < width; ++x) {
+                        renderCell(x, y, origin, cellSize);
+
+                        //TODO remove debug code
+                        /*if (debug) {
+                            {
+                                cv::Mat mat(visibilityRenderer->getTextureHeight(), visibilityRenderer->getTextureWidth(), CV_8UC3);
+                                cv::Mat flip(visibilityRenderer->getTextureHeight(), visibilityRenderer->getTextureWidth(), CV_8UC3);
+                                glBindTexture(GL_TEXTURE_2D, visibilityRenderer->getTexture());
+                                glGetTexImage(GL_TEXTURE_2D, 0, GL_BGR, GL_UNSIGNED_BYTE, mat.data);
+                                cv::flip(mat, flip, 0);
+                                char filename[256];
+                                snprintf(filename, sizeof(filename), "/tmp/utility/visibility-%d-%d.png", x, y);
+                                cv::imwrite(filename, flip);
+                            }
 
-                    {
-                        renderer->setFrame(frame);
-                        renderer->display();
-                        cv::Mat mat(renderer->getTextureHeight(), renderer->getTextureWidth(), CV_8UC3);
-                        cv::Mat flip(renderer->getTextureHeight(), renderer->getTextureWidth(), CV_8UC3);
-                        glBindTexture(GL_TEXTURE_2D, renderer->getTexture());
-                        glGetTexImage(GL_TEXTURE_2D, 0, GL_BGR, GL_UNSIGNED_BYTE, mat.data);
-                        cv::flip(mat, flip, 0);
-                        char filename[256];
-                        snprintf(filename, sizeof(filename), "/tmp/utility/renderer-%d-%d.png", x, y);
-                        cv::imwrite(filename, flip);
+                            {
+                                renderer->setFrame(frame);
+                                renderer->display();
+                                cv::Mat mat(renderer->getTextureHeight(), renderer->getTextureWidth(), CV_8UC3);
+                                cv::Mat flip(renderer->getTextureHeight(), renderer->getTextureWidth(), CV_8UC3);
+                                glBindTexture(GL_TEXTURE_2D, renderer->getTexture());
+                                glGetTexImage(GL_TEXTURE_2D, 0, GL_BGR, GL_UNSIGNED_BYTE, mat.data);
+                                cv::flip(mat, flip, 0);
+                                char filename[256];
+                                snprintf(filename, sizeof(filename), "/tmp/utility/renderer-%d-%d.png", x, y);
+                                cv::imwrite(filename, flip);
+                            }
+                        }*/
                     }
-                }*/
+                }
+                visibilityRenderer->getPixelCounts(visibility);
+                if (visibility.size() != static_cast<size_t>(width * height)) {
+                    pthread_mutex_lock(&sharedData->mutex);
+                    logError("Expected %d visibility counts, but got %zu", width * height, visibility.size());
+                    pthread_mutex_unlock(&sharedData->mutex);
+                    return;
+                }
             }
-        }
-        std::vector<GLuint> visibility;
-        visibilityRenderer->getPixelCounts(visibility);
-        if (visibility.size() != static_cast<size_t>(width * height)) {
+            cv::Mat mat(height, width, CV_8UC3);
+            for (int y = 0, i = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x, ++i) {
+                    const GLuint gain = visibility[i];
+                    const GLuint cost = costmap[i];
+                    const GLint utility = computeUtility(gain, cost);
+                    float value = (static_cast<float>(utility) - static_cast<float>(minUtility))
+                            / static_cast<float>(maxUtility - minUtility);
+                    if (value < 0.) {
+                        value = 0.;
+                    }
+                    if (value > 1.) {
+                        value = 1.;
+                    }
+                    mat.at<cv::Vec3b>(y, x) = cost > 15000000 ? OBSTACLE : (
+                                              cost > 5000000 ? INSCRIBED : (
+                                              value < 0.5 ? LOW * (1. - 2. * value) + MID * (2. * value)
+                                                          : MID * (1. - 2. * (value - 0.5)) + HIGH * (2. * (value - 0.5))));
+                    if (debug) {
+                        static FILE *debugoutput = fopen("/tmp/utility-map-debug.txt", "w");
+                        fprintf(debugoutput, "%zu\t%d\t%d\t%d\t%d\t%d\t%.5f\n", frame, x, y, gain, cost, utility, value);
+                    }
+                }
+            }
+            cv::Mat flip(height, width, CV_8UC3);
+            cv::flip(mat, flip, 0);
+            outputVideo->write(flip);
             pthread_mutex_lock(&sharedData->mutex);
-            logError("Expected %d visibility counts, but got %zu", width * height, visibility.size());
+            printf("[%zu] frame %zu done, %.0f%% handed out\n", threadNr, frame,
+                    static_cast<double>(sharedData->nextFrame) / static_cast<double>(sharedData->endFrame) * 100.);
             pthread_mutex_unlock(&sharedData->mutex);
-            return;
+
+            char filename[256];
+            snprintf(filename, sizeof(filename), "/tmp/utility-%03zu.png", frame);
+            cv::imwrite(filename, flip);
+            if (!framesFile.empty()) {
+                Checkpoint::appendFrame(framesFile, frame);
+            }
+
+            if (debug) {
+                return;
+            }
+        }
+    }
+}
+
+void UtilityMapSystematicTask::renderCell(const int x, const int y, const glm::vec3& origin, const glm::vec2& cellSize) {
+    static const glm::vec3 worldUp(0.f, 0.f, -1.f);
+    const glm::vec3 eye(origin.x + x * cellSize.x, origin.y + y * cellSize.y, origin.z);
+    const glm::vec3 look(glm::normalize(eye));
+    const glm::vec3 right(glm::cross(look, worldUp));
+    const glm::vec3 up(glm::cross(look, right));
+    cameraNode->setLocalTransform(glm::inverse(glm::lookAt(eye, glm::vec3(0., 0., 0.), up)));
+
+    visibilityRenderer->display();
+}
+
+bool UtilityMapSystematicTask::renderCells(std::vector<int>& cells, const glm::vec3& origin,
+        const glm::vec2& cellSize, std::vector<GLuint>& gains) {
+    if (cells.empty()) {
+        return true;
+    }
+    const int width = bellmanFordRenderer->getTextureWidth();
+    for (size_t i = 0; i < cells.size(); ++i) {
+        renderCell(cells[i] % width, cells[i] / width, origin, cellSize);
+    }
+    // One pipeline flush for all cells of a refinement level
+    std::vector<GLuint> counts;
+    visibilityRenderer->getPixelCounts(counts);
+    if (counts.size() != cells.size()) {
+        pthread_mutex_lock(&sharedData->mutex);
+        logError("Expected %zu visibility counts, but got %zu", cells.size(), counts.size());
+        pthread_mutex_unlock(&sharedData->mutex);
+        return false;
+    }
+    for (size_t i = 0; i < cells.size(); ++i) {
+        gains[cells[i]] = counts[i];
+    }
+    cells.clear();
+    return true;
+}
+
+bool UtilityMapSystematicTask::sampleAdaptive(const size_t frame, const GLuint * const costmap,
+        const glm::vec3& origin, const glm::vec2& cellSize, std::vector<GLuint>& gains) {
+    const int width = bellmanFordRenderer->getTextureWidth();
+    const int height = bellmanFordRenderer->getTextureHeight();
+    enum State {
+        UNKNOWN, INTERPOLATED, RENDERED
+    };
+    std::vector<unsigned char> state(width * height, UNKNOWN);
+    gains.assign(width * height, 0);
+    std::vector<int> pending;
+    size_t numRendered = 0;
+
+    // Coarse grid, the last row and column of quads may be smaller
+    std::vector<Quad> quads, nextQuads;
+    for (int y0 = 0; y0 < std::max(height - 1, 1); y0 += baseStep) {
+        for (int x0 = 0; x0 < std::max(width - 1, 1); x0 += baseStep) {
+            quads.push_back(Quad(x0, y0, std::min(x0 + baseStep, width - 1), std::min(y0 + baseStep, height - 1)));
+        }
+    }
+
+    while (!quads.empty()) {
+        // Render the corners of all quads of this level at once
+        for (size_t q = 0; q < quads.size(); ++q) {
+            const int corners[4] = {
+                quads[q].y0 * width + quads[q].x0, quads[q].y0 * width + quads[q].x1,
+                quads[q].y1 * width + quads[q].x0, quads[q].y1 * width + quads[q].x1
+            };
+            for (size_t c = 0; c < 4; ++c) {
+                if (state[corners[c]] != RENDERED) {
+                    state[corners[c]] = RENDERED;
+                    pending.push_back(corners[c]);
+                }
+            }
+        }
+        numRendered += pending.size();
+        if (!renderCells(pending, origin, cellSize, gains)) {
+            return false;
         }
-        cv::Mat mat(height, width, CV_8UC3);
-        for (int y = 0, i = 0; y < height; ++y) {
-            for (int x = 0; x < width; ++x, ++i) {
-                const GLuint gain = visibility[i];
-                const GLuint cost = costmap[i];
-                const GLint utility = cost > 5000000 ? -cost : (gain / 10 - cost);
-                float value = (static_cast<float>(utility) - static_cast<float>(minUtility))
-                        / static_cast<float>(maxUtility - minUtility);
-                if (value < 0.) {
-                    value = 0.;
+
+        nextQuads.clear();
+        for (size_t q = 0; q < quads.size(); ++q) {
+            const Quad& quad = quads[q];
+            if (quad.x1 - quad.x0 <= 1 && quad.y1 - quad.y0 <= 1) {
+                // All cells are corners
+                continue;
+            }
+            const int corners[4] = {
+                quad.y0 * width + quad.x0, quad.y0 * width + quad.x1,
+                quad.y1 * width + quad.x0, quad.y1 * width + quad.x1
+            };
+            GLint minGain = std::numeric_limits<GLint>::max();
+            GLint maxGain = std::numeric_limits<GLint>::min();
+            GLint maxUtility = std::numeric_limits<GLint>::min();
+            size_t numBlocked = 0;
+            for (size_t c = 0; c < 4; ++c) {
+                const GLint gain = gains[corners[c]] / 10;
+                minGain = std::min(minGain, gain);
+                maxGain = std::max(maxGain, gain);
+                maxUtility = std::max(maxUtility, computeUtility(gains[corners[c]], costmap[corners[c]]));
+                if (costmap[corners[c]] > blockedCost) {
+                    ++numBlocked;
+                }
+            }
+
+            if (maxGain - minGain > gainThreshold || maxUtility > valueThreshold
+                    || (numBlocked > 0 && numBlocked < 4)) {
+                // Split in four, or in two if the quad is only one cell wide
+                const int xm = quad.x1 - quad.x0 > 1 ? (quad.x0 + quad.x1) / 2 : quad.x1;
+                const int ym = quad.y1 - quad.y0 > 1 ? (quad.y0 + quad.y1) / 2 : quad.y1;
+                nextQuads.push_back(Quad(quad.x0, quad.y0, xm, ym));
+                if (xm != quad.x1) {
+                    nextQuads.push_back(Quad(xm, quad.y0, quad.x1, ym));
                 }
-                if (value > 1.) {
-                    value = 1.;
+                if (ym != quad.y1) {
+                    nextQuads.push_back(Quad(quad.x0, ym, xm, quad.y1));
+                    if (xm != quad.x1) {
+                        nextQuads.push_back(Quad(xm, ym, quad.x1, quad.y1));
+                    }
                 }
-                mat.at<cv::Vec3b>(y, x) = cost > 15000000 ? OBSTACLE : (
-                                          cost > 5000000 ? INSCRIBED : (
-                                          value < 0.5 ? LOW * (1. - 2. * value) + MID * (2. * value)
-                                                      : MID * (1. - 2. * (value - 0.5)) + HIGH * (2. * (value - 0.5))));
-                if (debug) {
-                    static FILE *debugoutput = fopen("/tmp/utility-map-debug.txt", "w");
-                    fprintf(debugoutput, "%zu\t%d\t%d\t%d\t%d\t%d\t%.5f\n", frame, x, y, gain, cost, utility, value);
+            } else {
+                // Bilinear interpolation, cells rendered for neighbouring quads are kept
+                const float w = static_cast<float>(quad.x1 - quad.x0);
+                const float h = static_cast<float>(quad.y1 - quad.y0);
+                for (int y = quad.y0; y <= quad.y1; ++y) {
+                    const float v = h > 0.f ? static_cast<float>(y - quad.y0) / h : 0.f;
+                    for (int x = quad.x0; x <= quad.x1; ++x) {
+                        const int i = y * width + x;
+                        if (state[i] != UNKNOWN) {
+                            continue;
+                        }
+                        const float u = w > 0.f ? static_cast<float>(x - quad.x0) / w : 0.f;
+                        const float gain = (1.f - v) * ((1.f - u) * gains[corners[0]] + u * gains[corners[1]])
+                                + v * ((1.f - u) * gains[corners[2]] + u * gains[corners[3]]);
+                        gains[i] = static_cast<GLuint>(gain + 0.5f);
+                        state[i] = INTERPOLATED;
+                    }
                 }
             }
         }
-        cv::Mat flip(height, width, CV_8UC3);
-        cv::flip(mat, flip, 0);
-        outputVideo->write(flip);
-        pthread_mutex_lock(&sharedData->mutex);
-        printf("[%zu] %.0f%% done\n", threadNr, static_cast<double>(frame - startFrame) / static_cast<float>(endFrame - startFrame) * 100.f);
-        pthread_mutex_unlock(&sharedData->mutex);
-
-        char filename[256];
-        snprintf(filename, sizeof(filename), "/tmp/utility-%03zu.png", frame);
-        cv::imwrite(filename, flip);
+        quads.swap(nextQuads);
+    }
 
-        if (debug) {
-            break;
+    // Estimate the interpolation error by rendering some of the interpolated free cells
+    std::vector<int> interpolated;
+    for (int i = 0; i < width * height; ++i) {
+        if (state[i] == INTERPOLATED && costmap[i] <= blockedCost) {
+            interpolated.push_back(i);
         }
     }
-}
+    unsigned int seed = static_cast<unsigned int>(frame * 7919 + threadNr);
+    const size_t numSamples = std::min(numErrorSamples, interpolated.size());
+    for (size_t i = 0; i < numSamples; ++i) {
+        // Partial Fisher-Yates shuffle
+        std::swap(interpolated[i], interpolated[i + rand_r(&seed) % (interpolated.size() - i)]);
+    }
+    interpolated.resize(numSamples);
+    std::vector<GLuint> estimates(numSamples);
+    for (size_t i = 0; i < numSamples; ++i) {
+        estimates[i] = gains[interpolated[i]];
+    }
+    pending = interpolated;
+    numRendered += pending.size();
+    if (!renderCells(pending, origin, cellSize, gains)) {
+        return false;
+    }
+    double sumError = 0.;
+    GLint maxError = 0;
+    for (size_t i = 0; i < numSamples; ++i) {
+        // The costs are exact, so the utility error is the error of the gain term
+        const GLint error = std::abs(static_cast<GLint>(gains[interpolated[i]] / 10) - static_cast<GLint>(estimates[i] / 10));
+        sumError += error;
+        maxError = std::max(maxError, error);
+    }
 
+    pthread_mutex_lock(&sharedData->mutex);
+    logInfo("[%zu] frame %zu: rendered %zu of %d cells, utility error of interpolated cells %.1f mean, %d max (%zu samples)",
+            threadNr, frame, numRendered, width * height, numSamples > 0 ? sumError / numSamples : 0., maxError,
+            numSamples);
+    pthread_mutex_unlock(&sharedData->mutex);
+    return true;
+}
 
 } /* namespace gpu_coverage */
@@ -37,13 +37,12 @@
 #include <gpu_coverage/Utilities.h>
 #include <gpu_coverage/Config.h>
 
+#include <limits>
+
 namespace gpu_coverage {
 
-VideoTask::VideoTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData, const size_t startFrame,
-        const size_t endFrame)
-        : AbstractTask(sharedData, threadNr), scene(scene), startFrame(startFrame), endFrame(endFrame), captureFrame(
-                (startFrame + endFrame) / 2),
-                writeVideo(true), costmapTexture(NULL), outputVideo(NULL), outputCubemapVideo(NULL)
+VideoTask::VideoTask(Scene * const scene, const size_t threadNr, SharedData * const sharedData)
+        : AbstractTask(sharedData, threadNr), scene(scene), writeVideo(true), costmapTexture(NULL), outputVideo(NULL), outputCubemapVideo(NULL)
 {
     // Add pano camera to scene
     scene->makePanoramaCamera(scene->findCamera(Config::getInstance().getParam<std::string>("panoCamera"))->getNode());
@@ -88,38 +87,51 @@ VideoTask::VideoTask(Scene * const scene, const size_t threadNr, SharedData * co
     flip = cv::Mat(pbufferHeight, pbufferWidth, CV_8UC3);
     panoMat = cv::Mat(panoHeight, panoWidth, CV_8UC3);
     panoFlip = cv::Mat(panoHeight, panoWidth, CV_8UC3);
-    if (writeVideo) {
-        char filename[256];
-        snprintf(filename, sizeof(filename), "/tmp/output_%zu.avi", threadNr);
-        outputVideo = new cv::VideoWriter(filename, CV_FOURCC('D', 'I', 'V', 'X'), 30.,
-                cv::Size(pbufferWidth, pbufferHeight), true);
-        if (!outputVideo->isOpened()) {
-            fprintf(stderr, "Could not open output video file\n");
-            return;
-        }
-        snprintf(filename, sizeof(filename), "/tmp/cubemap_%zu.avi", threadNr);
-        outputCubemapVideo = new cv::VideoWriter(filename, CV_FOURCC('D', 'I', 'V', 'X'), 30.,
-                cv::Size(panoWidth, panoHeight), true);
-        if (!outputCubemapVideo->isOpened()) {
-            fprintf(stderr, "Could not open cubemap output video file\n");
-            return;
-        }
-    }
     ready = true;
 }
 
 VideoTask::~VideoTask() {
+    closeVideos();
+    for (Renderers::const_iterator rendererIt = renderers.begin(); rendererIt != renderers.end(); ++rendererIt) {
+        delete *rendererIt;
+    }
+    renderers.clear();
+    delete costmapTexture;
+}
+
+bool VideoTask::openVideos(const size_t firstFrame) {
+    closeVideos();
+    // Workers take frame chunks in any order, so every chunk gets its own files named by its first frame;
+    // concatenating the files in name order gives the frames in order.
+    char filename[256];
+    snprintf(filename, sizeof(filename), "/tmp/output_%06zu.avi", firstFrame);
+    outputVideo = new cv::VideoWriter(filename, CV_FOURCC('D', 'I', 'V', 'X'), 30.,
+            cv::Size(pbufferWidth, pbufferHeight), true);
+    if (!outputVideo->isOpened()) {
+        fprintf(stderr, "Could not open output video file\n");
+        return false;
+    }
+    snprintf(filename, sizeof(filename), "/tmp/cubemap_%06zu.avi", firstFrame);
+    outputCubemapVideo = new cv::VideoWriter(filename, CV_FOURCC('D', 'I', 'V', 'X'), 30.,
+            cv::Size(panoWidth, panoHeight), true);
+    if (!outputCubemapVideo->isOpened()) {
+        fprintf(stderr, "Could not open cubemap output video file\n");
+        return false;
+    }
+    return true;
+}
+
+void VideoTask::closeVideos() {
     if (outputVideo) {
         outputVideo->release();
+        delete outputVideo;
+        outputVideo = NULL;
     }
     if (outputCubemapVideo) {
         outputCubemapVideo->release();
+        delete outputCubemapVideo;
+        outputCubemapVideo = NULL;
     }
-    for (Renderers::const_iterator rendererIt = renderers.begin(); rendererIt != renderers.end(); ++rendererIt) {
-        delete *rendererIt;
-    }
-    renderers.clear();
-    delete costmapTexture;
 }
 
 void VideoTask::run() {
@@ -127,37 +139,49 @@ void VideoTask::run() {
         return;
     }
     char filename[256];
-    for (size_t curFrame = startFrame; curFrame < endFrame; ++curFrame) {
-        for (Renderers::const_iterator rendererIt = renderers.begin(); rendererIt != renderers.end(); ++rendererIt) {
-            //TODO set channels
-            (*rendererIt)->display();
+    size_t chunkBegin, chunkEnd;
+    // Capture the middle of the first chunk of each worker, which is its whole slice with frameChunkTime 0
+    size_t captureFrame = std::numeric_limits<size_t>::max();
+    while (nextFrameChunk(chunkBegin, chunkEnd)) {
+        if (captureFrame == std::numeric_limits<size_t>::max()) {
+            captureFrame = (chunkBegin + chunkEnd) / 2;
         }
-        glFlush();
-        if (writeVideo) {
-            glReadPixels(0, 0, pbufferWidth, pbufferHeight, GL_BGR, GL_UNSIGNED_BYTE, mat.data);
-            cv::flip(mat, flip, 0);
-            outputVideo->write(flip);
-
-            glActiveTexture(GL_TEXTURE10);
-            glBindTexture(GL_TEXTURE_2D, panoTexture);
-            glGetTexImage(GL_TEXTURE_2D, 0, GL_BGR, GL_UNSIGNED_BYTE, panoMat.data);
-            cv::flip(panoMat, panoFlip, 0);
-            outputCubemapVideo->write(panoFlip);
+        if (writeVideo && !openVideos(chunkBegin)) {
+            return;
         }
-        if (curFrame == captureFrame) {
-            snprintf(filename, sizeof(filename), "/tmp/output_%zu.png", threadNr);
-            glReadPixels(0, 0, pbufferWidth, pbufferHeight, GL_BGR, GL_UNSIGNED_BYTE, mat.data);
-            cv::flip(mat, flip, 0);
-            cv::imwrite(filename, flip);
-
-            snprintf(filename, sizeof(filename), "/tmp/cubemap_%zu.png", threadNr);
-            glActiveTexture(GL_TEXTURE10);
-            glBindTexture(GL_TEXTURE_2D, panoTexture);
-            glGetTexImage(GL_TEXTURE_2D, 0, GL_BGR, GL_UNSIGNED_BYTE, panoMat.data);
-            cv::flip(panoMat, panoFlip, 0);
-            cv::imwrite(filename, panoFlip);
+        for (size_t curFrame = chunkBegin; curFrame < chunkEnd; ++curFrame) {
+            for (Renderers::const_iterator rendererIt = renderers.begin(); rendererIt != renderers.end(); ++rendererIt) {
+                //TODO set channels
+                (*rendererIt)->display();
+            }
+            glFlush();
+            if (writeVideo) {
+                glReadPixels(0, 0, pbufferWidth, pbufferHeight, GL_BGR, GL_UNSIGNED_BYTE, mat.data);
+                cv::flip(mat, flip, 0);
+                outputVideo->write(flip);
+
+                glActiveTexture(GL_TEXTURE10);
+                glBindTexture(GL_TEXTURE_2D, panoTexture);
+                glGetTexImage(GL_TEXTURE_2D, 0, GL_BGR, GL_UNSIGNED_BYTE, panoMat.data);
+                cv::flip(panoMat, panoFlip, 0);
+                outputCubemapVideo->write(panoFlip);
+            }
+            if (curFrame == captureFrame) {
+                snprintf(filename, sizeof(filename), "/tmp/output_%zu.png", threadNr);
+                glReadPixels(0, 0, pbufferWidth, pbufferHeight, GL_BGR, GL_UNSIGNED_BYTE, mat.data);
+                cv::flip(mat, flip, 0);
+                cv::imwrite(filename, flip);
+
+                snprintf(filename, sizeof(filename), "/tmp/cubemap_%zu.png", threadNr);
+                glActiveTexture(GL_TEXTURE10);
+                glBindTexture(GL_TEXTURE_2D, panoTexture);
+                glGetTexImage(GL_TEXTURE_2D, 0, GL_BGR, GL_UNSIGNED_BYTE, panoMat.data);
+                cv::flip(panoMat, panoFlip, 0);
+                cv::imwrite(filename, panoFlip);
+            }
         }
     }
+    closeVideos();
 }
 
 } /* namespace gpu_coverage */
@@ -50,7 +50,7 @@ VisibilityRenderer::VisibilityRenderer(const Scene * const scene, const bool ren
                 progShowTexture(NULL), progPixelCounter(NULL),
                 width(1280), height(960), textureWidth(1024), textureHeight(1024)
                         #ifndef GET_BUFFER_DIRECT
-                        , progCounterToFB(NULL), numPbo(sizeof(pbo) / sizeof(pbo[0])), curPbo(0), run(0)
+                        , progCounterToFB(NULL), numPbo(sizeof(pbo) / sizeof(pbo[0])), curPbo(0), run(0), numTaken(0)
 #endif
 {
     std::string targetNames = Config::getInstance().getParam<std::string>("target");
@@ -418,14 +418,15 @@ void VisibilityRenderer::getPixelCounts(std::vector<GLuint>& counts) {
     if (run < numPbo) {
         curPbo = 0;
     }
-    while (pixelCounts.size() < run) {
+    while (numTaken + pixelCounts.size() < run) {
         glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[curPbo]);
         readBack();
-        curPbo = (curPbo + 1) & numPbo;
+        curPbo = (curPbo + 1) % numPbo;
     }
     glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
     run = 0;
     curPbo = 0;
+    numTaken = 0;
 #endif
     counts.clear();
     counts.reserve(pixelCounts.size());
@@ -433,6 +434,19 @@ void VisibilityRenderer::getPixelCounts(std::vector<GLuint>& counts) {
     pixelCounts.clear();
 }
 
+size_t VisibilityRenderer::takePixelCounts(std::vector<GLuint>& counts) {
+    if (!countPixels) {
+        throw std::invalid_argument(std::string("Called takePixelCounts() although counting pixels is disabled"));
+    }
+    const size_t numAvailable = pixelCounts.size();
+    counts.insert(counts.end(), pixelCounts.begin(), pixelCounts.end());
+    pixelCounts.clear();
+#ifndef GET_BUFFER_DIRECT
+    numTaken += numAvailable;
+#endif
+    return numAvailable;
+}
+
 #ifndef GET_BUFFER_DIRECT
 void VisibilityRenderer::readBack() {
     unsigned int *ptr = (unsigned int *) glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, 4, GL_MAP_READ_BIT);
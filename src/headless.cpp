@@ -31,6 +31,13 @@
 #include <gpu_coverage/VideoTask.h>
 #include <gpu_coverage/RandomSearchTask.h>
 #include <gpu_coverage/HillclimbingTask.h>
+#include <gpu_coverage/CmaEsTask.h>
+#include <gpu_coverage/BayesOptTask.h>
+#include <gpu_coverage/ParallelTemperingTask.h>
+#include <gpu_coverage/SpsaTask.h>
+#include <gpu_coverage/MultiRobotTask.h>
+#include <gpu_coverage/LazyGreedyTask.h>
+#include <gpu_coverage/BeamSearchTask.h>
 #include <gpu_coverage/BenchmarkTask.h>
 #include <gpu_coverage/UtilityMapSystematicTask.h>
 #include <gpu_coverage/UtilityAnimationTask.h>
@@ -83,6 +90,13 @@ enum Command {
     VIDEO,
     RANDOM,
     HILLCLIMBING,
+    CMAES,
+    BAYESOPT,
+    TEMPERING,
+    SPSA,
+    MULTIROBOT,
+    LAZY_GREEDY,
+    BEAM_SEARCH,
     BENCHMARK,
     UTILITY_MAP_SYSTEMATIC,
     UTILITY_ANIMATION,
@@ -271,13 +285,12 @@ void *doWork(void * voidptr) {
         AbstractProgram::setOpenGLVersion();
         Scene * const scene = new Scene(configData.ai_scene, DATADIR "/models");
 
-        const size_t framePart = scene->getNumFrames() / configData.numDevices;
-        const size_t startFrame = data->threadNr * framePart;
-        const size_t endFrame = startFrame + framePart;
+        // All threads load the same scene, frames are handed out by AbstractTask::nextFrameChunk()
+        sharedData->endFrame = scene->getNumFrames();
 
         switch(configData.task) {
         case VIDEO:
-            task = new VideoTask(scene, data->threadNr, sharedData, startFrame, endFrame);
+            task = new VideoTask(scene, data->threadNr, sharedData);
             break;
         case RANDOM:
             task = new RandomSearchTask(scene, data->threadNr, sharedData, configData.randomIterations,
@@ -286,11 +299,35 @@ void *doWork(void * voidptr) {
         case HILLCLIMBING:
             task = new HillclimbingTask(scene, data->threadNr, sharedData);
             break;
+        case CMAES:
+            task = new CmaEsTask(scene, data->threadNr, sharedData, configData.randomIterations);
+            break;
+        case BAYESOPT:
+            task = new BayesOptTask(scene, data->threadNr, sharedData, configData.randomIterations);
+            break;
+        case TEMPERING:
+            task = new ParallelTemperingTask(scene, data->threadNr, sharedData, configData.randomIterations);
+            break;
+        case SPSA:
+            task = new SpsaTask(scene, data->threadNr, sharedData, configData.randomIterations);
+            break;
+        case MULTIROBOT:
+            task = new MultiRobotTask(scene, data->threadNr, sharedData, configData.randomIterations,
+                    configData.randomArticulationConfigs, configData.randomCameraPoses);
+            break;
+        case LAZY_GREEDY:
+            task = new LazyGreedyTask(scene, data->threadNr, sharedData, configData.randomIterations,
+                    configData.randomArticulationConfigs, configData.randomCameraPoses);
+            break;
+        case BEAM_SEARCH:
+            task = new BeamSearchTask(scene, data->threadNr, sharedData, configData.randomIterations,
+                    configData.randomArticulationConfigs, configData.randomCameraPoses);
+            break;
         case BENCHMARK:
             task = new BenchmarkTask(scene, data->threadNr, sharedData);
             break;
         case UTILITY_MAP_SYSTEMATIC:
-            task = new UtilityMapSystematicTask(scene, data->threadNr, sharedData, startFrame, endFrame);
+            task = new UtilityMapSystematicTask(scene, data->threadNr, sharedData);
             break;
         case UTILITY_ANIMATION:
             task = new UtilityAnimationTask(scene, data->threadNr, sharedData);
@@ -304,6 +341,12 @@ void *doWork(void * voidptr) {
         }
     }
 
+    // The time budget starts when all workers are ready, i.e. when the last worker gets here
+    const float timeBudget = Config::getInstance().getParam<float>("timeBudget");
+    if (timeBudget > 0.f) {
+        sharedData->deadline = AbstractTask::getTime() + timeBudget;
+    }
+
     pthread_mutex_unlock(&sharedData->mutex);
     pthread_barrier_wait(&sharedData->barrier);
 
@@ -369,6 +412,20 @@ int main(int argc, char *argv[]) {
             configData.task = RANDOM;
         } else if (strcmp(argv[i], "hillclimbing") == 0) {
             configData.task = HILLCLIMBING;
+        } else if (strcmp(argv[i], "cmaes") == 0) {
+            configData.task = CMAES;
+        } else if (strcmp(argv[i], "bayesopt") == 0) {
+            configData.task = BAYESOPT;
+        } else if (strcmp(argv[i], "tempering") == 0) {
+            configData.task = TEMPERING;
+        } else if (strcmp(argv[i], "spsa") == 0) {
+            configData.task = SPSA;
+        } else if (strcmp(argv[i], "multirobot") == 0) {
+            configData.task = MULTIROBOT;
+        } else if (strcmp(argv[i], "lazygreedy") == 0) {
+            configData.task = LAZY_GREEDY;
+        } else if (strcmp(argv[i], "beamsearch") == 0) {
+            configData.task = BEAM_SEARCH;
         } else if (strcmp(argv[i], "benchmark") == 0) {
             configData.task = BENCHMARK;
         } else if (strcmp(argv[i], "utility") == 0) {
@@ -503,6 +560,13 @@ int main(int argc, char *argv[]) {
                         "  * video:              Render video of external camera and panorama to /tmp/\n"
                         "  * hillclimbing:       Run hillclimbing algorithm\n"
                         "  * random:             Run random (brute-force) algorithm\n"
+                        "  * cmaes:              Run CMA-ES over articulation and camera pose\n"
+                        "  * bayesopt:           Run Bayesian optimization over articulation and camera pose\n"
+                        "  * tempering:          Run parallel tempering over articulation and camera pose\n"
+                        "  * spsa:               Run SPSA gradient ascent over continuous articulation and camera pose\n"
+                        "  * lazygreedy:         Run lazy greedy coverage over random candidate views\n"
+                        "  * beamsearch:         Plan a view sequence with beam search over random candidate views\n"
+                        "  * multirobot:         Plan views for several robots jointly with shared coverage\n"
                         "  * utility:            Compute true utility map through systematic sampling\n"
                         "  * utilityanimation:   Utility animation for video\n"
                         "  * benchmark:          Benchmark the GPU algorithms\n"
@@ -515,7 +579,7 @@ int main(int argc, char *argv[]) {
                 "  * --articulations, -a NUM: Use NUM random articulation configurations (default: %zu)\n"
                 "  * --config, -c FILE:       Use config file (default: config/config.txt))\n"
                 "  * --devices, -d DEV:       Use the given GPU device numbers (0-n) separated by comma\n"
-                "  * --iterations, -i NUM:    Use NUM random interations (default: %zu)\n"
+                "  * --iterations, -i NUM:    Use NUM iterations in all search tasks except hillclimbing (default: %zu)\n"
                 "  * --help, -h:              Show this help\n"
                 "  * --seed, -s SEED:         Set the random seed (default: random)\n"
                 "  * --threads:               Use threads instead of processes for workers\n"
@@ -632,14 +696,40 @@ int main(int argc, char *argv[]) {
     pthread_mutex_init(&sharedData->mutex, &mutexAttr);
 
     sharedData->numThreads = configData.numDevices;
-    RobotSceneConfiguration::loadCosts();
+    sharedData->nextFrame = 0;
+    sharedData->endFrame = 0;
+    sharedData->frameTime = 0.;
+    sharedData->frameChunkTime = Config::getInstance().getParam<float>("frameChunkTime");
+    sharedData->deadline = 0.;
+    RobotSceneConfiguration::loadCosts(Scene::countChannels(configData.ai_scene));
 
     switch (configData.task) {
     case RANDOM:
-        RandomSearchTask::allocateSharedData();
+        RandomSearchTask::allocateSharedData(configData.numDevices);
         break;
     case HILLCLIMBING:
-        HillclimbingTask::allocateSharedData();
+        HillclimbingTask::allocateSharedData(configData.numDevices);
+        break;
+    case CMAES:
+        CmaEsTask::allocateSharedData(configData.numDevices);
+        break;
+    case BAYESOPT:
+        BayesOptTask::allocateSharedData(configData.numDevices);
+        break;
+    case TEMPERING:
+        ParallelTemperingTask::allocateSharedData(configData.numDevices);
+        break;
+    case SPSA:
+        SpsaTask::allocateSharedData(configData.numDevices);
+        break;
+    case MULTIROBOT:
+        MultiRobotTask::allocateSharedData(configData.numDevices);
+        break;
+    case LAZY_GREEDY:
+        LazyGreedyTask::allocateSharedData(configData.randomArticulationConfigs * configData.randomCameraPoses);
+        break;
+    case BEAM_SEARCH:
+        BeamSearchTask::allocateSharedData(configData.randomArticulationConfigs * configData.randomCameraPoses);
         break;
     case BENCHMARK:
         BenchmarkTask::allocateSharedData();
@@ -695,6 +785,27 @@ int main(int argc, char *argv[]) {
     case HILLCLIMBING:
         HillclimbingTask::freeSharedData();
         break;
+    case CMAES:
+        CmaEsTask::freeSharedData();
+        break;
+    case BAYESOPT:
+        BayesOptTask::freeSharedData();
+        break;
+    case TEMPERING:
+        ParallelTemperingTask::freeSharedData();
+        break;
+    case SPSA:
+        SpsaTask::freeSharedData();
+        break;
+    case MULTIROBOT:
+        MultiRobotTask::freeSharedData();
+        break;
+    case LAZY_GREEDY:
+        LazyGreedyTask::freeSharedData();
+        break;
+    case BEAM_SEARCH:
+        BeamSearchTask::freeSharedData();
+        break;
     default:
         break;
     }